@@ -219,8 +219,6 @@ static int 	grid = 0;
 static int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
 
 boolean    	automapactive = false;
-static int 	finit_width = SCREENWIDTH;
-static int 	finit_height = SCREENHEIGHT - 32;
 
 // location of window on screen
 static int 	f_x;
@@ -538,9 +536,10 @@ void AM_LevelInit(void)
 {
     leveljuststarted = 0;
 
+    // the whole screen above the status bar
     f_x = f_y = 0;
-    f_w = finit_width;
-    f_h = finit_height;
+    f_w = SCREENWIDTH;
+    f_h = vscaley[ST_Y];
 
     AM_clearMarks();
 
@@ -1314,9 +1313,10 @@ void AM_drawMarks(void)
 	    //      h = SHORT(marknums[i]->height);
 	    w = 5; // because something's wrong with the wad, i guess
 	    h = 6; // because something's wrong with the wad, i guess
-	    fx = CXMTOF(markpoints[i].x);
-	    fy = CYMTOF(markpoints[i].y);
-	    if (fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
+	    // the patch goes on in BASE_WIDTH by BASE_HEIGHT units
+	    fx = CXMTOF(markpoints[i].x) * BASE_WIDTH / SCREENWIDTH;
+	    fy = CYMTOF(markpoints[i].y) * BASE_HEIGHT / SCREENHEIGHT;
+	    if (fx >= 0 && fx <= BASE_WIDTH - w && fy >= 0 && fy <= ST_Y - h)
 		V_DrawPatch(fx, fy, FB, marknums[i]);
 	}
     }
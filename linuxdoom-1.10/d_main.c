@@ -68,6 +68,7 @@ static const char rcsid[] = "$Id: d_main.c,v 1.8 1997/02/03 22:45:09 b1 Exp $";
 #include "m_argv.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_fhash.h"
 
 #include "i_system.h"
 #include "i_sound.h"
@@ -81,7 +82,9 @@ static const char rcsid[] = "$Id: d_main.c,v 1.8 1997/02/03 22:45:09 b1 Exp $";
 #include "am_map.h"
 
 #include "p_setup.h"
+#include "p_tick.h"
 #include "r_local.h"
+#include "r_bench.h"
 #ifdef _WIN32
 #include "win_platform.h"
 #endif
@@ -110,6 +113,8 @@ boolean         fastparm;	// checkparm of -fast
 boolean         drone;
 
 boolean		singletics = false; // debug flag to cancel adaptiveness
+boolean		uncapped;	// checkparm of -uncapped
+int		framebudget;	// ms per frame from -framebudget, 0 for none
 
 
 
@@ -200,6 +205,72 @@ extern  boolean setsizeneeded;
 extern  int             showMessages;
 void R_ExecuteSetViewSize (void);
 
+//
+// D_FractionalTic
+// How far the display is from the last tic
+//  towards the next one. With -uncapped, frames
+//  are drawn in between and the view is interpolated.
+//
+fixed_t D_FractionalTic (void)
+{
+    int		elapsed;
+
+    if (!uncapped || singletics)
+	return FRACUNIT;
+
+    elapsed = (I_GetTimeMS () - lasttictime) * TICRATE;
+    if (elapsed >= 1000)
+	return FRACUNIT;
+    if (elapsed < 0)
+	return 0;
+    return elapsed * FRACUNIT / 1000;
+}
+
+//
+// D_GovernFrame
+// With -framebudget, the view is rendered smaller
+//  while D_Display takes longer than the budget,
+//  and stretched to its window; it grows back when
+//  the next size up would fit with room to spare.
+//
+#define GOVERNHOLD	8	// frames to settle after a change
+
+static int	frameaverage;	// in 1/16 ms
+
+void D_GovernFrame (int ms)
+{
+    static int	hold;
+    int		budget;
+    int		scale;
+
+    if (!framebudget || gamestate != GS_LEVEL || automapactive)
+	return;
+
+    // running average over roughly the last 8 frames
+    frameaverage += (ms*16 - frameaverage) / 8;
+    if (hold)
+    {
+	hold--;
+	return;
+    }
+
+    // the view is most of the cost, and it goes
+    //  with the square of the scale
+    budget = framebudget*16;
+    scale = renderscale;
+    if (frameaverage > budget)
+	scale--;
+    else if (frameaverage*(scale+1)*(scale+1)*8 < budget*scale*scale*7)
+	scale++;
+
+    if (scale < MINRENDERSCALE || scale > FULLRENDERSCALE
+	|| scale == renderscale)
+	return;
+
+    R_SetRenderScale (scale);
+    hold = GOVERNHOLD;
+}
+
 void D_Display (void)
 {
     static  boolean		viewactivestate = false;
@@ -212,6 +283,7 @@ void D_Display (void)
     int				tics;
     int				wipestart;
     int				y;
+    int				starttime;
     boolean			done;
     boolean			wipe;
     boolean			redrawsbar;
@@ -219,6 +291,7 @@ void D_Display (void)
     if (nodrawers)
 	return;                    // for comparative timing / profiling
 		
+    starttime = I_GetTimeMS ();
     redrawsbar = false;
     
     // change the view size if needed
@@ -249,12 +322,12 @@ void D_Display (void)
 	    break;
 	if (automapactive)
 	    AM_Drawer ();
-	if (wipe || (viewheight != 200 && fullscreen) )
+	if (wipe || (viewwindowheight != SCREENHEIGHT && fullscreen) )
 	    redrawsbar = true;
 	if (inhelpscreensstate && !inhelpscreens)
 	    redrawsbar = true;              // just put away the help screen
-	ST_Drawer (viewheight == 200, redrawsbar );
-	fullscreen = viewheight == 200;
+	ST_Drawer (viewwindowheight == SCREENHEIGHT, redrawsbar );
+	fullscreen = viewwindowheight == SCREENHEIGHT;
 	break;
 
       case GS_INTERMISSION:
@@ -275,7 +348,12 @@ void D_Display (void)
     
     // draw the view directly
     if (gamestate == GS_LEVEL && !automapactive && gametic)
+    {
+	fractionaltic = D_FractionalTic ();
 	R_RenderPlayerView (&players[displayplayer]);
+	V_MarkRect (viewwindowx, viewwindowy,
+		    viewwindowwidth, viewwindowheight);
+    }
 
     if (gamestate == GS_LEVEL && gametic)
 	HU_Drawer ();
@@ -292,7 +370,7 @@ void D_Display (void)
     }
 
     // see if the border needs to be updated to the screen
-    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
+    if (gamestate == GS_LEVEL && !automapactive && viewwindowwidth != SCREENWIDTH)
     {
 	if (menuactive || menuactivestate || !viewactivestate)
 	    borderdrawcount = 3;
@@ -312,11 +390,12 @@ void D_Display (void)
     // draw pause pic
     if (paused)
     {
+	// the view is always centered across
 	if (automapactive)
 	    y = 4;
 	else
-	    y = viewwindowy+4;
-	V_DrawPatchDirect(viewwindowx+(scaledviewwidth-68)/2,
+	    y = (viewwindowy*BASE_HEIGHT + SCREENHEIGHT-1)/SCREENHEIGHT + 4;
+	V_DrawPatchDirect((BASE_WIDTH-68)/2,
 			  y,0,W_CacheLumpName ("M_PAUSE", PU_CACHE));
     }
 
@@ -329,7 +408,10 @@ void D_Display (void)
     // normal update
     if (!wipe)
     {
-	I_FinishUpdate ();              // page flip or blit buffer
+	// -timedemo with -noblit times the drawing alone
+	if (!noblit)
+	    I_FinishUpdate ();          // page flip or blit buffer
+	D_GovernFrame (I_GetTimeMS () - starttime);
 	return;
     }
     
@@ -350,7 +432,8 @@ void D_Display (void)
 			       , 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
 	I_UpdateNoBlit ();
 	M_Drawer ();                            // menu is drawn even on top of wipes
-	I_FinishUpdate ();                      // page flip or blit buffer
+	if (!noblit)
+	    I_FinishUpdate ();                  // page flip or blit buffer
     } while (!done);
 }
 
@@ -400,13 +483,14 @@ void D_DoomLoop (void)
 	}
 	else
 	{
-	    TryRunTics (); // will run at least one tic
+	    TryRunTics (); // will run at least one tic, unless -uncapped
 	}
 		
 	S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
 
 	// Update display, next frame, with current state.
 	D_Display ();
+	M_FrameHash ();
 
 #ifndef SNDSERV
 	// Sound mixing for the buffer is snychronous.
@@ -892,6 +976,10 @@ void D_DoomMain (void)
     respawnparm = M_CheckParm ("-respawn");
     fastparm = M_CheckParm ("-fast");
     devparm = M_CheckParm ("-devparm");
+    uncapped = M_CheckParm ("-uncapped");
+    p = M_CheckParm ("-framebudget");
+    if (p && p < myargc-1)
+	framebudget = atoi (myargv[p+1]);
     if (M_CheckParm ("-altdeath"))
         deathmatch = 2;
     else if (M_CheckParm ("-deathmatch"))
@@ -1156,6 +1244,13 @@ void D_DoomMain (void)
     printf ("R_Init: Init DOOM refresh daemon - ");
     R_Init ();
 
+    // -drawbench times the drawers and quits
+    if (M_CheckParm ("-drawbench"))
+    {
+	R_BenchDrawers ();
+	exit (0);
+    }
+
     printf ("\nP_Init: Init Playloop state.\n");
     P_Init ();
 
@@ -1174,6 +1269,9 @@ void D_DoomMain (void)
     printf ("ST_Init: Init status bar.\n");
     ST_Init ();
 
+    // -framehash / -framecmp for demo playback
+    M_InitFrameHash ();
+
     // check for a driver that wants intermission stats
     p = M_CheckParm ("-statcopy");
     if (p && p<myargc-1)
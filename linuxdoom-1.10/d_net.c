@@ -373,6 +373,10 @@ void NetUpdate (void)
     int				realstart;
     int				gameticdiv;
     
+    // no game running, as with the frame server
+    if (!netbuffer)
+	return;
+
     // check time
     nowtime = I_GetTime ()/ticdup;
     newtics = nowtime - gametime;
@@ -663,6 +667,12 @@ void TryRunTics (void)
 		lowtic = nettics[i];
 	}
     }
+
+    // with -uncapped, go draw another frame
+    //  instead of waiting for the next tic
+    if (uncapped && lowtic < gametic/ticdup + 1)
+	return;
+
     availabletics = lowtic - gametic/ticdup;
     
     // decide how many tics to run
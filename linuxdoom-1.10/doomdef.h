@@ -87,6 +87,15 @@ typedef enum
 //#define SNDINTR  1
 
 
+// Storage class for renderer state that every render
+//  thread keeps its own copy of (see R_RenderPlayerView).
+#ifdef _MSC_VER
+#define THREADLOCAL	__declspec(thread)
+#else
+#define THREADLOCAL	__thread
+#endif
+
+
 // This one switches between MIT SHM (no proper mouse)
 // and XFree86 DGA (mickey sampling). The original
 // linuxdoom used SHM, which is default.
@@ -94,10 +103,24 @@ typedef enum
 
 
 //
-// For resize of screen, at start of game.
-// It will not work dynamically, see visplanes.
+// The screen size is picked at startup (see V_Init),
+//  anywhere from the original 320x200 up to MAXWIDTH
+//  by MAXHEIGHT. Everything in the 2D code (status bar,
+//  menus, intermission, automap marks) is still laid out
+//  in BASE_WIDTH by BASE_HEIGHT units and scaled by V_*.
 //
 #define	BASE_WIDTH		320
+#define	BASE_HEIGHT		200
+
+// Upper bound for the screen size, and the size of the
+//  static per-column and per-row arrays in the renderer.
+// Override from the compiler command line.
+#ifndef MAXWIDTH
+#define	MAXWIDTH		1120
+#endif
+#ifndef MAXHEIGHT
+#define	MAXHEIGHT		832
+#endif
 
 // It is educational but futile to change this
 //  scaling e.g. to 2. Drawing of status bar,
@@ -109,10 +132,11 @@ typedef enum
 // Defines suck. C sucks.
 // C++ might sucks for OOP, but it sure is a better C.
 // So there.
-#define SCREENWIDTH  320
-//SCREEN_MUL*BASE_WIDTH //320
-#define SCREENHEIGHT 200
-//(int)(SCREEN_MUL*BASE_WIDTH*INV_ASPECT_RATIO) //200
+extern int	screenwidth;
+extern int	screenheight;
+
+#define SCREENWIDTH	screenwidth
+#define SCREENHEIGHT	screenheight
 
 
 
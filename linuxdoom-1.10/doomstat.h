@@ -257,6 +257,9 @@ extern  int             mouseSensitivity;
 // debug flag to cancel adaptiveness
 extern  boolean         singletics;	
 
+// draw frames in between tics, interpolated
+extern  boolean         uncapped;
+
 extern  int             bodyqueslot;
 
 
@@ -196,6 +196,8 @@ wipe_doMelt
 	    else if (y[i] < height)
 	    {
 		dy = (y[i] < 16) ? y[i]+1 : 8;
+		// same speed, in screen heights, at any size
+		dy = dy*height/BASE_HEIGHT;
 		if (y[i]+dy >= height) dy = height - y[i];
 		s = &((short *)wipe_scr_end)[i*height+y[i]];
 		d = &((short *)wipe_scr)[y[i]*width+i];
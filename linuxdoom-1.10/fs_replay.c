@@ -0,0 +1,87 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Replay of a frame written with -capture, drawn over
+//	 and over through the frame server, to profile the
+//	 refresh on that frame alone.
+//
+//	doomreplay <capture> <iwad> [<pwad>...] [-frames <n>]
+//	 [-pcx <file>] [-rthreads <n>] [other refresh switches]
+//
+//-----------------------------------------------------------------------------
+
+static const char
+rcsid[] = "$Id:$";
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomdef.h"
+
+#include "m_argv.h"
+#include "m_misc.h"
+#include "fs_serv.h"
+
+
+#define MAXREPLAYWADS	32
+
+
+int
+main
+( int		argc,
+  char**	argv )
+{
+    char*	wadfiles[MAXREPLAYWADS+1];
+    fsview_t	view;
+    int		frames;
+    int		p;
+    int		i;
+
+    if (argc < 3)
+    {
+	fprintf (stderr, "usage: %s <capture> <iwad> [<pwad>...] "
+		 "[-frames <n>] [-pcx <file>]\n", argv[0]);
+	return 1;
+    }
+
+    // the wads go up to the first switch
+    for (i=0 ; i<MAXREPLAYWADS && i+2<argc && argv[i+2][0] != '-' ; i++)
+	wadfiles[i] = argv[i+2];
+    wadfiles[i] = NULL;
+
+    FS_Init (wadfiles, argc, argv);
+    FS_LoadCapture (argv[1], &view);
+
+    frames = 1000;
+    p = M_CheckParm ("-frames");
+    if (p && p < myargc-1)
+	frames = atoi (myargv[p+1]);
+
+    for (i=0 ; i<frames ; i++)
+	FS_RenderViews (&view, 1);
+    FS_PrintStats ();
+
+    // to check the replay against the frame in the game
+    p = M_CheckParm ("-pcx");
+    if (p && p < myargc-1)
+	WritePCXfile (myargv[p+1], view.buffer, view.width, view.height,
+		      FS_Palette ());
+
+    return 0;
+}
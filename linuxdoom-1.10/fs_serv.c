@@ -0,0 +1,335 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Frame server: renders views of a map, not of a player,
+//	 straight into buffers handed in by the caller.
+//
+//-----------------------------------------------------------------------------
+
+
+static const char
+rcsid[] = "$Id:$";
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+
+#include "z_zone.h"
+#include "w_wad.h"
+#include "m_argv.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+
+#include "p_setup.h"
+
+#include "r_local.h"
+#include "r_sky.h"
+#include "r_reuse.h"
+#include "r_capture.h"
+
+#include "v_video.h"
+
+#include "fs_serv.h"
+
+
+void R_ExecuteSetViewSize (void);
+
+
+//
+// The views are drawn as the view of a player
+//  that is nowhere in the map: its mobj is not
+//  linked in, and has no weapon up.
+//
+static mobj_t		fsmobj;
+static player_t		fsplayer;
+
+static boolean		fslevel;
+
+// Size the view tables are set up for.
+static int		fswidth;
+static int		fsheight;
+
+static int		fsframes;
+static int		fstime;
+
+
+//
+// FS_IdentifyMode
+// Tells the game mode from the maps there are,
+//  as the wads are the caller's and need not have
+//  the usual names IdentifyVersion looks for.
+//
+static void FS_IdentifyMode (void)
+{
+    if (W_CheckNumForName ("MAP01") != -1)
+	gamemode = commercial;
+    else if (W_CheckNumForName ("E4M1") != -1)
+	gamemode = retail;
+    else if (W_CheckNumForName ("E3M1") != -1)
+	gamemode = registered;
+    else
+	gamemode = shareware;
+}
+
+
+//
+// FS_Init
+//
+void
+FS_Init
+( char**	wadfiles,
+  int		argc,
+  char**	argv )
+{
+    static char*	noargs[] = { "", NULL };
+
+    if (!argv)
+    {
+	argc = 1;
+	argv = noargs;
+    }
+    myargc = argc;
+    myargv = argv;
+
+    printf ("Z_Init: Init zone memory allocation daemon. \n");
+    Z_Init ();
+
+    printf ("W_Init: Init WADfiles.\n");
+    W_InitMultipleFiles (wadfiles);
+    FS_IdentifyMode ();
+
+    printf ("R_Init: Init DOOM refresh daemon - ");
+    R_Init ();
+
+    // every view is new, none is worth saving
+    viewreuse = false;
+
+    printf ("\nP_Init: Init Playloop state.\n");
+    P_Init ();
+
+    // one strip per processor, unless -rthreads says
+    if (!M_CheckParm ("-rthreads"))
+    {
+	I_InitThreads (I_NumCPUs ());
+	numrenderthreads = I_NumThreads ();
+    }
+
+    // always full screen, in full detail
+    R_SetViewSize (11, 0);
+    fswidth = fsheight = 0;
+
+    fsplayer.mo = &fsmobj;
+    fsframes = fstime = 0;
+}
+
+
+//
+// FS_LoadMap
+//
+boolean
+FS_LoadMap
+( int		episode,
+  int		map )
+{
+    char	lumpname[9];
+    int		i;
+
+    if (gamemode == commercial)
+    {
+	episode = 1;
+	sprintf (lumpname, "map%02i", map);
+    }
+    else
+	sprintf (lumpname, "E%iM%i", episode, map);
+
+    if (W_CheckNumForName (lumpname) == -1)
+	return false;
+
+    gameepisode = episode;
+    gamemap = map;
+    gameskill = sk_medium;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	playeringame[i] = false;
+
+    // set the sky map, as G_InitNew does
+    skyflatnum = R_FlatNumForName (SKYFLATNAME);
+
+    if (gamemode == commercial)
+    {
+	skytexture = R_TextureNumForName ("SKY3");
+	if (gamemap < 12)
+	    skytexture = R_TextureNumForName ("SKY1");
+	else if (gamemap < 21)
+	    skytexture = R_TextureNumForName ("SKY2");
+    }
+    else
+    {
+	// SKY4 is the Special Edition sky
+	sprintf (lumpname, "SKY%i", episode);
+	skytexture = R_TextureNumForName (lumpname);
+    }
+
+    P_SetupLevel (episode, map, 0, gameskill);
+    fslevel = true;
+
+    return true;
+}
+
+
+//
+// FS_FloorHeight
+//
+fixed_t
+FS_FloorHeight
+( fixed_t	x,
+  fixed_t	y )
+{
+    if (!fslevel)
+	I_Error ("FS_FloorHeight: no map loaded");
+
+    return R_PointInSubsector (x, y)->sector->floorheight;
+}
+
+
+//
+// FS_LoadCapture
+//
+void
+FS_LoadCapture
+( char*		name,
+  fsview_t*	view )
+{
+    capture_t*	capture;
+
+    capture = R_ReadCapture (name);
+    if (!FS_LoadMap (capture->episode, capture->map))
+	I_Error ("FS_LoadCapture: %s is of a map not in the wads", name);
+    R_ApplyCapture (&fsplayer);
+
+    view->x = capture->viewx;
+    view->y = capture->viewy;
+    view->z = capture->viewz;
+    view->angle = capture->viewangle;
+    view->width = capture->width;
+    view->height = capture->height;
+    view->buffer = malloc (view->width*view->height);
+    if (!view->buffer)
+	I_Error ("FS_LoadCapture: no memory for a %ix%i view",
+		 view->width, view->height);
+
+    // the view tables are set up again for the next view
+    R_SetViewSize (11, capture->detail);
+    R_SetRenderScale (capture->scale);
+    fswidth = fsheight = 0;
+}
+
+
+//
+// FS_SetupView
+// Points the refresh at the buffer of the view,
+//  and the player at its view point.
+//
+static void FS_SetupView (fsview_t* view)
+{
+    if (view->width < FS_MINSIZE || view->width > MAXWIDTH
+	|| view->height < FS_MINSIZE || view->height > MAXHEIGHT)
+	I_Error ("FS_RenderViews: bad view size %ix%i",
+		 view->width, view->height);
+
+    // The view fills the whole screen, so that
+    //  screens[0] can just be the buffer.
+    screens[0] = view->buffer;
+
+    if (view->width != fswidth || view->height != fsheight)
+    {
+	fswidth = view->width;
+	fsheight = view->height;
+	V_SetScreenSize (fswidth, fsheight);
+	R_ExecuteSetViewSize ();
+    }
+    else
+	R_InitBuffer (scaledviewwidth, viewheight);
+
+    fsmobj.x = fsmobj.oldx = view->x;
+    fsmobj.y = fsmobj.oldy = view->y;
+    fsmobj.angle = fsmobj.oldangle = view->angle;
+    fsmobj.subsector = R_PointInSubsector (view->x, view->y);
+    fsplayer.viewz = fsplayer.oldviewz = view->z;
+}
+
+
+//
+// FS_RenderViews
+// One view after the other, each spread over the
+//  render threads as strips, see R_RenderPlayerView.
+//
+void
+FS_RenderViews
+( fsview_t*	views,
+  int		count )
+{
+    int		start;
+    int		i;
+
+    if (!fslevel)
+	I_Error ("FS_RenderViews: no map loaded");
+
+    start = I_GetTimeMS ();
+
+    // no tic to interpolate from
+    fractionaltic = FRACUNIT;
+
+    for (i=0 ; i<count ; i++)
+    {
+	FS_SetupView (&views[i]);
+	R_RenderPlayerView (&fsplayer);
+    }
+
+    fsframes += count;
+    fstime += I_GetTimeMS () - start;
+}
+
+
+//
+// FS_Palette
+//
+byte* FS_Palette (void)
+{
+    return W_CacheLumpName ("PLAYPAL", PU_STATIC);
+}
+
+
+//
+// FS_PrintStats
+//
+void FS_PrintStats (void)
+{
+    double	rate;
+    int		threads;
+
+    threads = I_NumThreads ();
+    rate = fsframes * 1000.0 / (fstime ? fstime : 1);
+
+    printf ("FS: %i frames in %i ms, %.1f frames/sec, "
+	    "%.1f per core (%i threads)\n",
+	    fsframes, fstime, rate, rate/threads, threads);
+    R_PrintPhaseTimes ();
+}
@@ -0,0 +1,99 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Frame server, for programs that link the engine as a
+//	 library (make libdoom.a) to render maps from any
+//	 number of view points, without a player or game loop.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __FS_SERV__
+#define __FS_SERV__
+
+#include "doomtype.h"
+#include "m_fixed.h"
+#include "tables.h"
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// Smallest view FS_RenderViews takes either way.
+// The largest is MAXWIDTH by MAXHEIGHT.
+#define FS_MINSIZE		16
+
+
+//
+// A view point, and where to put what it sees:
+//  width by height palette indices, row after row.
+//
+typedef struct
+{
+    fixed_t	x;
+    fixed_t	y;
+    fixed_t	z;		// of the eye, not above the floor
+    angle_t	angle;
+
+    int		width;
+    int		height;
+    byte*	buffer;		// [width*height]
+
+} fsview_t;
+
+
+// Starts the zone, wads, refresh and play data, but
+//  no video, sound or network. wadfiles is NULL
+//  terminated, IWAD first. argc/argv are looked at
+//  for the usual switches (-rthreads, -patchcache...),
+//  argv may be NULL. Without -rthreads every view is
+//  split over all processors.
+void FS_Init (char** wadfiles, int argc, char** argv);
+
+// Loads ExMy, or MAPxx for DOOM 2 (episode ignored),
+//  with its things but no players.
+// False if the map is not in the wads.
+boolean FS_LoadMap (int episode, int map);
+
+// For placing views: the floor height at x,y.
+fixed_t FS_FloorHeight (fixed_t x, fixed_t y);
+
+// Loads the map of a frame written with -capture, and
+//  puts it as it was then. The view is set to where
+//  and how large the frame was drawn, with a new
+//  buffer, and is drawn in the detail it was.
+void FS_LoadCapture (char* name, fsview_t* view);
+
+// Renders each view into its buffer, in order.
+// The views in a batch may all differ in size.
+void FS_RenderViews (fsview_t* views, int count);
+
+// The 256 RGB triples the buffers are indices into.
+byte* FS_Palette (void);
+
+// Frames rendered since FS_Init, and the rate
+//  per second and per processor.
+void FS_PrintStats (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -65,10 +65,12 @@ rcsid[] = "$Id: g_game.c,v 1.8 1997/02/03 22:45:09 b1 Exp $";
 // SKY handling - still the wrong place.
 #include "r_data.h"
 #include "r_sky.h"
+#include "r_reuse.h"
 
 
 
 #include "g_game.h"
+#include "m_fhash.h"
 
 
 #define SAVEGAMESIZE	0x2c000
@@ -1648,11 +1650,16 @@ boolean G_CheckDemoStatus (void)
 { 
     int             endtime; 
 	 
+    // before the timedemo result ends the program
+    if (demoplayback)
+	M_FinishFrameHash ();
+
     if (timingdemo) 
     { 
 	endtime = I_GetTime (); 
-	I_Error ("timed %i gametics in %i realtics",gametic 
-		 , endtime-starttime); 
+	R_PrintPhaseTimes ();
+	I_Error ("timed %i gametics in %i realtics, %i frames reused",gametic 
+		 , endtime-starttime, reusedframes); 
     } 
 	 
     if (demoplayback) 
@@ -0,0 +1,593 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	The screen as 32 bit pixels, scaled to any window size.
+//	Each window pixel takes the screen pixel nearest to its
+//	 center, through a table of the 256 palette colors.
+//	The rows are split across the worker threads; rows that
+//	 come from the same screen row are copies of the first.
+//	Only what changed is scaled: the marks of V_MarkRect are
+//	 checked against a copy of the screen as last scaled,
+//	 and the changed rows gathered into a few rectangles.
+//
+//-----------------------------------------------------------------------------
+
+static const char
+rcsid[] = "$Id:$";
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
+#include "m_bbox.h"
+#include "v_video.h"
+
+#ifdef __GNUG__
+#pragma implementation "i_scale.h"
+#endif
+#include "i_scale.h"
+
+#if defined(__x86_64__) || defined(_M_X64) \
+    || (defined(__i386__) && defined(__SSE2__))
+#define I_SIMD
+#include <immintrin.h>
+
+#ifdef __GNUC__
+#define AVX2FUNC	__attribute__((target("avx2")))
+#else
+#define AVX2FUNC
+#endif
+#endif
+
+
+
+static byte*		scaledest;
+static int		scalewidth;
+static int		scaleheight;
+static int		scalepitch;
+
+// Where each color goes in a pixel, the left shift
+//  of its top bit from bit 7.
+static int		redshift = 16;
+static int		greenshift = 8;
+static int		blueshift = 0;
+static unsigned		redmask = 0xff0000;
+static unsigned		greenmask = 0xff00;
+static unsigned		bluemask = 0xff;
+
+// The palette as set, gamma corrected, and as pixels.
+static byte		scalepalette[256*3];
+static unsigned		pixels[256];
+
+// The screen column of each window column,
+//  the screen row of each window row.
+static int*		sourcex;
+static int*		sourcey;
+
+// The window width in screen widths, when whole.
+static int		factor;
+
+// The first window column at or past each screen column,
+//  and the same for rows, one more for the end.
+static int*		windowx;
+static int*		windowy;
+
+static int		scalebands;
+
+static void		(*scalerow) (byte* source, unsigned* dest,
+				     int x1, int x2);
+
+// The screen as last scaled, to find what changed.
+static byte*		shownscreen;
+
+// The next I_ScaleScreen does all of the screen, as after
+//  a new palette. -nodirty keeps it so.
+static boolean		scaleall;
+static boolean		nodirty;
+
+// Rows changed at most this far apart go in one rectangle.
+#define MERGEROWS	8
+#define MAXSCALERECTS	16
+
+typedef struct
+{
+    int		x1, y1;
+    int		x2, y2;		// inclusive
+} screenrect_t;
+
+static screenrect_t	screenrects[MAXSCALERECTS];
+static scalerect_t	windowrects[MAXSCALERECTS];
+static scalerect_t*	bandrect;
+
+
+
+//
+// I_WindowSize
+//
+void I_WindowSize (int* width, int* height)
+{
+    int		multiply;
+    int		p;
+
+    multiply = 1;
+    if (M_CheckParm ("-2"))
+	multiply = 2;
+    if (M_CheckParm ("-3"))
+	multiply = 3;
+    if (M_CheckParm ("-4"))
+	multiply = 4;
+
+    *width = SCREENWIDTH*multiply;
+    *height = SCREENHEIGHT*multiply;
+
+    // either alone keeps the shape of the screen
+    p = M_CheckParm ("-winwidth");
+    if (p && p < myargc-1)
+    {
+	*width = atoi (myargv[p+1]);
+	*height = *width*SCREENHEIGHT/SCREENWIDTH;
+    }
+    p = M_CheckParm ("-winheight");
+    if (p && p < myargc-1)
+    {
+	*height = atoi (myargv[p+1]);
+	if (!M_CheckParm ("-winwidth"))
+	    *width = *height*SCREENWIDTH/SCREENHEIGHT;
+    }
+
+    if (*width < 1 || *height < 1)
+	I_Error ("I_WindowSize: bad window size %ix%i", *width, *height);
+}
+
+
+
+//
+// I_ScaleRowWhole
+// Each screen pixel is looked up once
+//  and written factor times.
+// The row functions fill window columns x1 to x2-1
+//  of dest, the window row, from source, the screen row.
+//
+static void
+I_ScaleRowWhole
+( byte*		source,
+  unsigned*	dest,
+  int		x1,
+  int		x2 )
+{
+    unsigned	p;
+    int		count;
+    int		i;
+
+    // x1 and x2 are whole screen pixels, from windowx
+    count = (x2-x1)/factor;
+    source += x1/factor;
+    dest += x1;
+
+    switch (factor)
+    {
+      case 1:
+	do
+	    *dest++ = pixels[*source++];
+	while (--count);
+	break;
+
+      case 2:
+	do
+	{
+	    p = pixels[*source++];
+	    dest[0] = p;
+	    dest[1] = p;
+	    dest += 2;
+	} while (--count);
+	break;
+
+      case 3:
+	do
+	{
+	    p = pixels[*source++];
+	    dest[0] = p;
+	    dest[1] = p;
+	    dest[2] = p;
+	    dest += 3;
+	} while (--count);
+	break;
+
+      case 4:
+	do
+	{
+	    p = pixels[*source++];
+	    dest[0] = p;
+	    dest[1] = p;
+	    dest[2] = p;
+	    dest[3] = p;
+	    dest += 4;
+	} while (--count);
+	break;
+
+      default:
+	do
+	{
+	    p = pixels[*source++];
+	    for (i=0 ; i<factor ; i++)
+		*dest++ = p;
+	} while (--count);
+	break;
+    }
+}
+
+
+//
+// I_ScaleRowAny
+//
+static void
+I_ScaleRowAny
+( byte*		source,
+  unsigned*	dest,
+  int		x1,
+  int		x2 )
+{
+    int*	x;
+    int		count;
+
+    x = sourcex + x1;
+    count = x2-x1;
+    dest += x1;
+
+    do
+	*dest++ = pixels[source[*x++]];
+    while (--count);
+}
+
+
+#ifdef I_SIMD
+//
+// I_ScaleRowAVX2
+// Eight window pixels at a time, for any scale:
+//  one gather for the screen pixels, one for
+//  their colors.
+//
+AVX2FUNC static void
+I_ScaleRowAVX2
+( byte*		source,
+  unsigned*	dest,
+  int		x1,
+  int		x2 )
+{
+    __m256i	index;
+    int		x;
+
+    for (x=x1 ; x <= x2-8 ; x += 8)
+    {
+	// The dword that ends at each wanted byte, as in
+	//  R_DrawSpanAVX2, so nothing past the end of the
+	//  screen is read. In front of it are the other
+	//  screens, or the pad V_Init puts before the first.
+	index = _mm256_loadu_si256 ((__m256i *)&sourcex[x]);
+	index = _mm256_srli_epi32 (
+	    _mm256_i32gather_epi32 ((const int *)(source-3), index, 1), 24);
+	_mm256_storeu_si256 ((__m256i *)&dest[x],
+			     _mm256_i32gather_epi32 ((const int *)pixels,
+						     index, 4));
+    }
+
+    for ( ; x<x2 ; x++)
+	dest[x] = pixels[source[sourcex[x]]];
+}
+#endif
+
+
+
+//
+// I_ScaleBand
+// A band of the rows of bandrect.
+//
+static void I_ScaleBand (int band)
+{
+    byte*	row;
+    int		x1;
+    int		x2;
+    int		y;
+    int		y1;
+    int		y2;
+
+    x1 = bandrect->x;
+    x2 = bandrect->x + bandrect->width;
+    y1 = bandrect->y + bandrect->height*band/scalebands;
+    y2 = bandrect->y + bandrect->height*(band+1)/scalebands;
+    row = scaledest + y1*scalepitch;
+
+    for (y=y1 ; y<y2 ; y++, row += scalepitch)
+    {
+	if (y > y1 && sourcey[y] == sourcey[y-1])
+	    memcpy ((unsigned *)row + x1, (unsigned *)(row-scalepitch) + x1,
+		    (x2-x1)*4);
+	else
+	    scalerow (screens[0] + sourcey[y]*SCREENWIDTH, (unsigned *)row,
+		      x1, x2);
+    }
+}
+
+
+
+//
+// I_FindChanges
+// Compares the marked part of screens[0] with shownscreen,
+//  bringing shownscreen up to date, and gathers the changed
+//  rows into screenrects. Returns how many.
+//
+static int I_FindChanges (void)
+{
+    screenrect_t*	rect;
+    byte*		source;
+    byte*		shown;
+    int			count;
+    int			left;
+    int			right;
+    int			top;
+    int			bottom;
+    int			x1;
+    int			x2;
+    int			y;
+
+    if (scaleall || nodirty)
+    {
+	memcpy (shownscreen, screens[0], SCREENWIDTH*SCREENHEIGHT);
+	M_ClearBox (dirtybox);
+	scaleall = false;
+
+	screenrects[0].x1 = 0;
+	screenrects[0].y1 = 0;
+	screenrects[0].x2 = SCREENWIDTH-1;
+	screenrects[0].y2 = SCREENHEIGHT-1;
+	return 1;
+    }
+
+    // y grows down the screen, so BOXTOP is the bottom row
+    left = dirtybox[BOXLEFT] < 0 ? 0 : dirtybox[BOXLEFT];
+    right = dirtybox[BOXRIGHT] >= SCREENWIDTH ?
+	SCREENWIDTH-1 : dirtybox[BOXRIGHT];
+    top = dirtybox[BOXBOTTOM] < 0 ? 0 : dirtybox[BOXBOTTOM];
+    bottom = dirtybox[BOXTOP] >= SCREENHEIGHT ?
+	SCREENHEIGHT-1 : dirtybox[BOXTOP];
+    M_ClearBox (dirtybox);
+
+    count = 0;
+    rect = screenrects;
+
+    for (y=top ; y<=bottom && left<=right ; y++)
+    {
+	source = screens[0] + y*SCREENWIDTH;
+	shown = shownscreen + y*SCREENWIDTH;
+
+	// drawn over with the same pixels, as the base
+	//  screens put back every frame
+	if (!memcmp (source+left, shown+left, right-left+1))
+	    continue;
+
+	for (x1=left ; source[x1] == shown[x1] ; x1++)
+	    ;
+	for (x2=right ; source[x2] == shown[x2] ; x2--)
+	    ;
+	memcpy (shown+x1, source+x1, x2-x1+1);
+
+	if (count
+	    && (y - rect->y2 <= MERGEROWS || count == MAXSCALERECTS))
+	{
+	    if (x1 < rect->x1)
+		rect->x1 = x1;
+	    if (x2 > rect->x2)
+		rect->x2 = x2;
+	    rect->y2 = y;
+	    continue;
+	}
+
+	rect = &screenrects[count++];
+	rect->x1 = x1;
+	rect->y1 = y;
+	rect->x2 = x2;
+	rect->y2 = y;
+    }
+
+    return count;
+}
+
+
+//
+// I_ScaleScreen
+//
+int I_ScaleScreen (scalerect_t** rects)
+{
+    screenrect_t*	screen;
+    scalerect_t*	window;
+    int			count;
+    int			i;
+
+    count = I_FindChanges ();
+
+    // the window pixels centered in each
+    window = windowrects;
+    for (i=0, screen=screenrects ; i<count ; i++, screen++)
+    {
+	window->x = windowx[screen->x1];
+	window->y = windowy[screen->y1];
+	window->width = windowx[screen->x2+1] - window->x;
+	window->height = windowy[screen->y2+1] - window->y;
+
+	// too small to cover a window pixel center
+	if (window->width <= 0 || window->height <= 0)
+	    continue;
+
+	bandrect = window;
+	scalebands = I_NumThreads ();
+	if (scalebands > window->height)
+	    scalebands = window->height;
+	I_RunParallel (I_ScaleBand, scalebands);
+
+	window++;
+    }
+
+    *rects = windowrects;
+    return window - windowrects;
+}
+
+
+//
+// I_ScaleAll
+//
+void I_ScaleAll (void)
+{
+    scaleall = true;
+}
+
+
+
+//
+// I_BuildPixels
+//
+static int I_ColorShift (unsigned mask)
+{
+    int		top;
+
+    for (top=31 ; top>0 && !(mask & (1u<<top)) ; top--)
+	;
+    return top-7;
+}
+
+static unsigned I_ColorBits (int c, int shift, unsigned mask)
+{
+    if (shift < 0)
+	return (c >> -shift) & mask;
+    return (c << shift) & mask;
+}
+
+static void I_BuildPixels (void)
+{
+    byte*	c;
+    int		i;
+
+    for (i=0, c=scalepalette ; i<256 ; i++, c+=3)
+	pixels[i] = I_ColorBits (c[0], redshift, redmask)
+	    | I_ColorBits (c[1], greenshift, greenmask)
+	    | I_ColorBits (c[2], blueshift, bluemask);
+}
+
+
+//
+// I_SetScalePalette
+//
+void I_SetScalePalette (byte* palette)
+{
+    int		i;
+
+    for (i=0 ; i<256*3 ; i++)
+	scalepalette[i] = gammatable[usegamma][*palette++];
+
+    I_BuildPixels ();
+    scaleall = true;
+}
+
+
+//
+// I_SetScaleDest
+//
+void I_SetScaleDest (byte* dest)
+{
+    scaledest = dest;
+}
+
+
+//
+// I_InitScale
+//
+void
+I_InitScale
+( byte*		dest,
+  int		width,
+  int		height,
+  int		pitch,
+  unsigned	red,
+  unsigned	green,
+  unsigned	blue )
+{
+    int		i;
+    int		x;
+
+    scaledest = dest;
+    scalewidth = width;
+    scaleheight = height;
+    scalepitch = pitch;
+
+    redmask = red;
+    greenmask = green;
+    bluemask = blue;
+    redshift = I_ColorShift (red);
+    greenshift = I_ColorShift (green);
+    blueshift = I_ColorShift (blue);
+    I_BuildPixels ();
+
+    free (sourcex);
+    free (sourcey);
+    free (windowx);
+    free (windowy);
+    free (shownscreen);
+    sourcex = malloc (width*sizeof(*sourcex));
+    sourcey = malloc (height*sizeof(*sourcey));
+    windowx = malloc ((SCREENWIDTH+1)*sizeof(*windowx));
+    windowy = malloc ((SCREENHEIGHT+1)*sizeof(*windowy));
+    shownscreen = malloc (SCREENWIDTH*SCREENHEIGHT);
+    if (!sourcex || !sourcey || !windowx || !windowy || !shownscreen)
+	I_Error ("I_InitScale: no memory for a %ix%i window", width, height);
+
+    // the screen pixel under the center of each window pixel
+    for (i=0 ; i<width ; i++)
+	sourcex[i] = (2*i+1)*SCREENWIDTH/(2*width);
+    for (i=0 ; i<height ; i++)
+	sourcey[i] = (2*i+1)*SCREENHEIGHT/(2*height);
+
+    // and back, for the window rectangles of screen ones
+    for (i=0, x=0 ; i<=SCREENWIDTH ; i++)
+    {
+	while (x < width && sourcex[x] < i)
+	    x++;
+	windowx[i] = x;
+    }
+    for (i=0, x=0 ; i<=SCREENHEIGHT ; i++)
+    {
+	while (x < height && sourcey[x] < i)
+	    x++;
+	windowy[i] = x;
+    }
+
+    scaleall = true;
+    nodirty = M_CheckParm ("-nodirty");
+
+    factor = width % SCREENWIDTH ? 0 : width/SCREENWIDTH;
+    scalerow = factor ? I_ScaleRowWhole : I_ScaleRowAny;
+
+#ifdef I_SIMD
+    // -nosimd keeps the plain loops
+    if (!factor && (I_CPUFeatures () & CPU_AVX2) && !M_CheckParm ("-nosimd"))
+	scalerow = I_ScaleRowAVX2;
+#endif
+}
@@ -0,0 +1,82 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	The screen as 32 bit pixels, scaled to the window,
+//	 for the video backends.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __I_SCALE__
+#define __I_SCALE__
+
+#include "doomtype.h"
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// The window size from -2, -3, -4 (the screen times that)
+//  or -winwidth and -winheight, the screen size if none.
+void I_WindowSize (int* width, int* height);
+
+// Where I_ScaleScreen writes, pitch in bytes, and where
+//  each color goes in a pixel.
+void
+I_InitScale
+( byte*		dest,
+  int		width,
+  int		height,
+  int		pitch,
+  unsigned	redmask,
+  unsigned	greenmask,
+  unsigned	bluemask );
+
+// Moves the output, same size and pitch, e.g. to
+//  the next of several buffers.
+void I_SetScaleDest (byte* dest);
+
+// Takes full 8 bit values, as I_SetPalette.
+void I_SetScalePalette (byte* palette);
+
+// A part of the window, in window pixels.
+typedef struct
+{
+    int		x;
+    int		y;
+    int		width;
+    int		height;
+} scalerect_t;
+
+// Converts and scales to dest what changed in screens[0]
+//  since the last call, as marked with V_MarkRect.
+// Points rects at the window rectangles that were written,
+//  returns how many (none if nothing changed).
+int I_ScaleScreen (scalerect_t** rects);
+
+// The next I_ScaleScreen does all of the screen,
+//  e.g. when the window was uncovered.
+void I_ScaleAll (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
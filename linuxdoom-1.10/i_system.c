@@ -100,6 +100,56 @@ int  I_GetTime (void)
 }
 
 
+//
+// I_GetTimeMS
+// returns time in milliseconds, for timing
+//  below the resolution of a tic
+//
+int  I_GetTimeMS (void)
+{
+    struct timeval	tp;
+    struct timezone	tzp;
+    static int		basetime=0;
+  
+    gettimeofday(&tp, &tzp);
+    if (!basetime)
+	basetime = tp.tv_sec;
+    return (tp.tv_sec-basetime)*1000 + tp.tv_usec/1000;
+}
+
+
+//
+// I_GetTimeUS
+//
+unsigned I_GetTimeUS (void)
+{
+    struct timeval	tp;
+
+    gettimeofday(&tp, NULL);
+    return (unsigned)tp.tv_sec*1000000u + tp.tv_usec;
+}
+
+
+//
+// I_CPUFeatures
+//
+int I_CPUFeatures (void)
+{
+    int		features;
+
+    features = 0;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // CPUID, plus the OS check for the AVX registers
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("sse2"))
+	features |= CPU_SSE2;
+    if (__builtin_cpu_supports ("avx2"))
+	features |= CPU_AVX2;
+#endif
+    return features;
+}
+
+
 
 //
 // I_Init
@@ -44,6 +44,21 @@ byte*	I_ZoneBase (int *size);
 // returns current time in tics.
 int I_GetTime (void);
 
+// Sub-tic clock, in milliseconds.
+// Used to draw frames in between tics.
+int I_GetTimeMS (void);
+
+// Microseconds, for timing parts of a frame.
+// Wraps, so only differences mean anything.
+unsigned I_GetTimeUS (void);
+
+// Vector instruction sets the CPU (and OS) support,
+//  for picking drawers at runtime.
+#define CPU_SSE2		1
+#define CPU_AVX2		2
+
+int I_CPUFeatures (void);
+
 
 //
 // Called by D_DoomLoop,
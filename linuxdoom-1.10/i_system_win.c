@@ -12,6 +12,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <intrin.h>
 
 #include "doomdef.h"
 #include "m_misc.h"
@@ -71,6 +72,61 @@ int I_GetTime(void)
     return (int)(elapsed * TICRATE / s_perf_freq.QuadPart);
 }
 
+/* Returns time in milliseconds, for timing below the resolution of a tic. */
+int I_GetTimeMS(void)
+{
+    LARGE_INTEGER now;
+    __int64 elapsed;
+
+    if (!s_time_inited)
+    {
+        QueryPerformanceFrequency(&s_perf_freq);
+        QueryPerformanceCounter(&s_perf_base);
+        s_time_inited = 1;
+    }
+    QueryPerformanceCounter(&now);
+    elapsed = now.QuadPart - s_perf_base.QuadPart;
+    return (int)(elapsed * 1000 / s_perf_freq.QuadPart);
+}
+
+/* Microseconds, for timing parts of a frame; wraps. */
+unsigned I_GetTimeUS(void)
+{
+    LARGE_INTEGER now;
+    __int64 elapsed;
+
+    if (!s_time_inited)
+    {
+        QueryPerformanceFrequency(&s_perf_freq);
+        QueryPerformanceCounter(&s_perf_base);
+        s_time_inited = 1;
+    }
+    QueryPerformanceCounter(&now);
+    elapsed = now.QuadPart - s_perf_base.QuadPart;
+    return (unsigned)(elapsed * 1000000 / s_perf_freq.QuadPart);
+}
+
+/* CPUID leaves 1 and 7; AVX2 also needs the OS to save the YMM registers. */
+int I_CPUFeatures(void)
+{
+    int regs[4];
+    int features = 0;
+
+#if defined(_M_X64) || defined(_M_IX86)
+    __cpuid(regs, 1);
+    if (regs[3] & (1 << 26))
+        features |= CPU_SSE2;
+    if ((regs[2] & (1 << 27)) && (regs[2] & (1 << 28))
+        && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(regs, 7, 0);
+        if (regs[1] & (1 << 5))
+            features |= CPU_AVX2;
+    }
+#endif
+    return features;
+}
+
 void I_Init(void)
 {
     I_InitSound();
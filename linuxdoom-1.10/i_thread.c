@@ -0,0 +1,186 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Worker threads, POSIX threads version.
+//
+//-----------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "doomdef.h"
+#include "i_system.h"
+
+#ifdef __GNUG__
+#pragma implementation "i_thread.h"
+#endif
+#include "i_thread.h"
+
+
+
+static pthread_t	threads[MAXTHREADS];
+static int		threadindex[MAXTHREADS];
+static int		numthreads = 1;
+
+// Guards the batch description below.
+static pthread_mutex_t	poollock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	workcond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	donecond = PTHREAD_COND_INITIALIZER;
+
+static void		(*workfunc) (int);
+static int		workcount;
+static int		workgeneration;
+static int		workleft;
+
+static pthread_mutex_t	globallock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+//
+// I_NumCPUs
+//
+int I_NumCPUs (void)
+{
+    long	count;
+
+    count = sysconf (_SC_NPROCESSORS_ONLN);
+    if (count < 1)
+	return 1;
+    return count;
+}
+
+
+//
+// I_WorkerThread
+// Every worker sees every batch; the ones beyond
+//  the batch count just report back.
+//
+static void* I_WorkerThread (void* arg)
+{
+    int		index;
+    int		generation;
+    int		count;
+    void	(*func) (int);
+
+    index = *(int *)arg;
+    generation = 0;
+
+    for (;;)
+    {
+	pthread_mutex_lock (&poollock);
+	while (workgeneration == generation)
+	    pthread_cond_wait (&workcond, &poollock);
+	generation = workgeneration;
+	func = workfunc;
+	count = workcount;
+	pthread_mutex_unlock (&poollock);
+
+	if (index < count)
+	    func (index);
+
+	pthread_mutex_lock (&poollock);
+	if (--workleft == 0)
+	    pthread_cond_signal (&donecond);
+	pthread_mutex_unlock (&poollock);
+    }
+
+    return NULL;
+}
+
+
+//
+// I_InitThreads
+//
+void I_InitThreads (int count)
+{
+    int		i;
+
+    if (numthreads > 1)
+	return;
+
+    if (count < 1)
+	count = 1;
+    if (count > MAXTHREADS)
+	count = MAXTHREADS;
+
+    for (i=1 ; i<count ; i++)
+    {
+	threadindex[i] = i;
+	if (pthread_create (&threads[i], NULL,
+			    I_WorkerThread, &threadindex[i]))
+	    I_Error ("I_InitThreads: can't start thread %i", i);
+    }
+
+    numthreads = count;
+}
+
+
+//
+// I_NumThreads
+//
+int I_NumThreads (void)
+{
+    return numthreads;
+}
+
+
+//
+// I_RunParallel
+//
+void I_RunParallel (void (*func) (int), int count)
+{
+    if (count > numthreads)
+	count = numthreads;
+
+    if (count < 2)
+    {
+	if (count == 1)
+	    func (0);
+	return;
+    }
+
+    pthread_mutex_lock (&poollock);
+    workfunc = func;
+    workcount = count;
+    workleft = numthreads-1;
+    workgeneration++;
+    pthread_cond_broadcast (&workcond);
+    pthread_mutex_unlock (&poollock);
+
+    func (0);
+
+    pthread_mutex_lock (&poollock);
+    while (workleft)
+	pthread_cond_wait (&donecond, &poollock);
+    pthread_mutex_unlock (&poollock);
+}
+
+
+//
+// I_Lock
+//
+void I_Lock (void)
+{
+    pthread_mutex_lock (&globallock);
+}
+
+void I_Unlock (void)
+{
+    pthread_mutex_unlock (&globallock);
+}
@@ -0,0 +1,77 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	System specific worker threads.
+//	A fixed pool, started once, that runs one function
+//	 over a range of indices and waits for all of them.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// Upper bound for the pool, the calling thread included.
+#define MAXTHREADS		32
+
+
+// Number of online processors, 1 if it can't be told.
+int I_NumCPUs (void);
+
+// Starts the pool: count-1 workers plus the calling thread.
+// Called once at startup; count is clamped to 1..MAXTHREADS.
+void I_InitThreads (int count);
+
+// Size of the pool, 1 if I_InitThreads was never called.
+int I_NumThreads (void);
+
+// Calls func(0) to func(count-1) in parallel and returns
+//  when all of them are done. Index 0 runs on the calling
+//  thread. count is clamped to I_NumThreads.
+// Must only be called from the main thread.
+void I_RunParallel (void (*func) (int), int count);
+
+// A single global lock, for the rare shared state
+//  (zone allocations, mostly) touched by workers.
+void I_Lock (void);
+void I_Unlock (void);
+
+// For a flag that workers check without the lock:
+//  what a thread stored before its I_StoreRelease of
+//  the flag is seen by any thread whose I_LoadAcquire
+//  reads that value. Volatile has these semantics
+//  with MSVC on x86 and x64.
+#ifdef _MSC_VER
+#define I_LoadAcquire(p)	(*(volatile int *)(p))
+#define I_StoreRelease(p,v)	(*(volatile int *)(p) = (v))
+#else
+#define I_LoadAcquire(p)	__atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define I_StoreRelease(p,v)	__atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+#endif
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -0,0 +1,152 @@
+//-----------------------------------------------------------------------------
+// Windows implementation of i_thread.h
+// Worker pool: CreateThread + CRITICAL_SECTION / CONDITION_VARIABLE.
+//-----------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "i_thread.h"
+
+static HANDLE s_threads[MAXTHREADS];
+static int s_threadindex[MAXTHREADS];
+static int s_numthreads = 1;
+
+/* Guards the batch description below. */
+static CRITICAL_SECTION s_poollock;
+static CONDITION_VARIABLE s_workcond;
+static CONDITION_VARIABLE s_donecond;
+
+static void (*s_workfunc)(int);
+static int s_workcount;
+static int s_workgeneration;
+static int s_workleft;
+
+static CRITICAL_SECTION s_globallock;
+static int s_locks_inited;
+
+static void InitLocks(void)
+{
+    if (s_locks_inited)
+        return;
+    InitializeCriticalSection(&s_poollock);
+    InitializeCriticalSection(&s_globallock);
+    InitializeConditionVariable(&s_workcond);
+    InitializeConditionVariable(&s_donecond);
+    s_locks_inited = 1;
+}
+
+int I_NumCPUs(void)
+{
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    if (info.dwNumberOfProcessors < 1)
+        return 1;
+    return (int)info.dwNumberOfProcessors;
+}
+
+/* Every worker sees every batch; the ones beyond the batch count just report back. */
+static DWORD WINAPI WorkerThread(LPVOID arg)
+{
+    int index = *(int *)arg;
+    int generation = 0;
+    int count;
+    void (*func)(int);
+
+    for (;;)
+    {
+        EnterCriticalSection(&s_poollock);
+        while (s_workgeneration == generation)
+            SleepConditionVariableCS(&s_workcond, &s_poollock, INFINITE);
+        generation = s_workgeneration;
+        func = s_workfunc;
+        count = s_workcount;
+        LeaveCriticalSection(&s_poollock);
+
+        if (index < count)
+            func(index);
+
+        EnterCriticalSection(&s_poollock);
+        if (--s_workleft == 0)
+            WakeConditionVariable(&s_donecond);
+        LeaveCriticalSection(&s_poollock);
+    }
+
+    return 0;
+}
+
+void I_InitThreads(int count)
+{
+    int i;
+
+    InitLocks();
+
+    if (s_numthreads > 1)
+        return;
+
+    if (count < 1)
+        count = 1;
+    if (count > MAXTHREADS)
+        count = MAXTHREADS;
+
+    for (i = 1; i < count; i++)
+    {
+        s_threadindex[i] = i;
+        s_threads[i] = CreateThread(NULL, 0, WorkerThread, &s_threadindex[i], 0, NULL);
+        if (!s_threads[i])
+            I_Error("I_InitThreads: can't start thread %i", i);
+    }
+
+    s_numthreads = count;
+}
+
+int I_NumThreads(void)
+{
+    return s_numthreads;
+}
+
+void I_RunParallel(void (*func)(int), int count)
+{
+    if (count > s_numthreads)
+        count = s_numthreads;
+
+    if (count < 2)
+    {
+        if (count == 1)
+            func(0);
+        return;
+    }
+
+    EnterCriticalSection(&s_poollock);
+    s_workfunc = func;
+    s_workcount = count;
+    s_workleft = s_numthreads - 1;
+    s_workgeneration++;
+    WakeAllConditionVariable(&s_workcond);
+    LeaveCriticalSection(&s_poollock);
+
+    func(0);
+
+    EnterCriticalSection(&s_poollock);
+    while (s_workleft)
+        SleepConditionVariableCS(&s_donecond, &s_poollock, INFINITE);
+    LeaveCriticalSection(&s_poollock);
+}
+
+void I_Lock(void)
+{
+    InitLocks();
+    EnterCriticalSection(&s_globallock);
+}
+
+void I_Unlock(void)
+{
+    LeaveCriticalSection(&s_globallock);
+}
+
+#endif /* _WIN32 */
@@ -54,6 +54,7 @@ int XShmGetEventBase( Display* dpy ); // problems with g++?
 #include "v_video.h"
 #include "m_argv.h"
 #include "d_main.h"
+#include "i_scale.h"
 
 #include "doomdef.h"
 
@@ -74,7 +75,18 @@ int		X_height;
 // MIT SHared Memory extension.
 boolean		doShm;
 
-XShmSegmentInfo	X_shminfo;
+// With it, the window is drawn from the shared images
+//  in turn, so that a frame can be scaled into one while
+//  the X server still reads the one before. An image is
+//  busy from XShmPutImage to its completion event.
+// -shmbuffers <n> sets how many there are.
+#define MAXSHMIMAGES	4
+
+XImage*		shmimages[MAXSHMIMAGES];
+XShmSegmentInfo	X_shminfos[MAXSHMIMAGES];
+boolean		shmbusy[MAXSHMIMAGES];
+int		numshmimages = 2;
+int		shmimage;	// the one drawn next
 int		X_shmeventtype;
 
 // Fake mouse handling.
@@ -83,13 +95,6 @@ int		X_shmeventtype;
 boolean		grabMouse;
 int		doPointerWarp = POINTER_WARP_COUNTDOWN;
 
-// Blocky mode,
-// replace each 320x200 pixel with multiply*multiply pixels.
-// According to Dave Taylor, it still is a bonehead thing
-// to use ....
-static int	multiply=1;
-
-
 //
 //  Translates the key currently in X_event
 //
@@ -163,16 +168,25 @@ int xlatekey(void)
 
 void I_ShutdownGraphics(void)
 {
-  // Detach from X server
-  if (!XShmDetach(X_display, &X_shminfo))
+  int		i;
+
+  // Never started, as with the frame server.
+  if (!X_display)
+	return;
+
+  for (i=0 ; doShm && i<numshmimages ; i++)
+  {
+    // Detach from X server
+    if (!XShmDetach(X_display, &X_shminfos[i]))
 	    I_Error("XShmDetach() failed in I_ShutdownGraphics()");
 
-  // Release shared memory.
-  shmdt(X_shminfo.shmaddr);
-  shmctl(X_shminfo.shmid, IPC_RMID, 0);
+    // Release shared memory.
+    shmdt(X_shminfos[i].shmaddr);
+    shmctl(X_shminfos[i].shmid, IPC_RMID, 0);
 
-  // Paranoia.
-  image->data = NULL;
+    // Paranoia.
+    shmimages[i]->data = NULL;
+  }
 }
 
 
@@ -189,7 +203,20 @@ void I_StartFrame (void)
 static int	lastmousex = 0;
 static int	lastmousey = 0;
 boolean		mousemoved = false;
-boolean		shmFinished;
+
+
+//
+// I_ShmCompletion
+// The X server is done reading a shared image.
+//
+void I_ShmCompletion (XShmCompletionEvent* ev)
+{
+    int		i;
+
+    for (i=0 ; i<numshmimages ; i++)
+	if (X_shminfos[i].shmseg == ev->shmseg)
+	    shmbusy[i] = false;
+}
 
 void I_GetEvent(void)
 {
@@ -268,11 +295,16 @@ void I_GetEvent(void)
 	break;
 	
       case Expose:
+	// the window must be drawn again, not just what changed
+	I_ScaleAll ();
+	break;
+
       case ConfigureNotify:
 	break;
 	
       default:
-	if (doShm && X_event.type == X_shmeventtype) shmFinished = true;
+	if (doShm && X_event.type == X_shmeventtype)
+	    I_ShmCompletion ((XShmCompletionEvent *) &X_event);
 	break;
     }
 
@@ -355,6 +387,8 @@ void I_FinishUpdate (void)
     static int	lasttic;
     int		tics;
     int		i;
+    scalerect_t*	rects;
+    int		count;
     // UNUSED static unsigned char *bigscreen=0;
 
     // draws little dots on the bottom of the screen
@@ -370,148 +404,62 @@ void I_FinishUpdate (void)
 	    screens[0][ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0xff;
 	for ( ; i<20*2 ; i+=2)
 	    screens[0][ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0x0;
+	V_MarkRect (0, SCREENHEIGHT-1, 20*2, 1);
     
     }
 
-    // scales the screen size before blitting it
-    if (multiply == 2)
+    if (doShm)
     {
-	unsigned int *olineptrs[2];
-	unsigned int *ilineptr;
-	int x, y, i;
-	unsigned int twoopixels;
-	unsigned int twomoreopixels;
-	unsigned int fouripixels;
-
-	ilineptr = (unsigned int *) (screens[0]);
-	for (i=0 ; i<2 ; i++)
-	    olineptrs[i] = (unsigned int *) &image->data[i*X_width];
-
-	y = SCREENHEIGHT;
-	while (y--)
-	{
-	    x = SCREENWIDTH;
-	    do
-	    {
-		fouripixels = *ilineptr++;
-		twoopixels =	(fouripixels & 0xff000000)
-		    |	((fouripixels>>8) & 0xffff00)
-		    |	((fouripixels>>16) & 0xff);
-		twomoreopixels =	((fouripixels<<16) & 0xff000000)
-		    |	((fouripixels<<8) & 0xffff00)
-		    |	(fouripixels & 0xff);
-#ifdef __BIG_ENDIAN__
-		*olineptrs[0]++ = twoopixels;
-		*olineptrs[1]++ = twoopixels;
-		*olineptrs[0]++ = twomoreopixels;
-		*olineptrs[1]++ = twomoreopixels;
-#else
-		*olineptrs[0]++ = twomoreopixels;
-		*olineptrs[1]++ = twomoreopixels;
-		*olineptrs[0]++ = twoopixels;
-		*olineptrs[1]++ = twoopixels;
-#endif
-	    } while (x-=4);
-	    olineptrs[0] += X_width/4;
-	    olineptrs[1] += X_width/4;
-	}
+	// the image of numshmimages frames ago may still
+	//  be read, processing input events meanwhile
+	while (shmbusy[shmimage])
+	    I_GetEvent();
 
+	image = shmimages[shmimage];
+	I_SetScaleDest ((byte *) image->data);
     }
-    else if (multiply == 3)
-    {
-	unsigned int *olineptrs[3];
-	unsigned int *ilineptr;
-	int x, y, i;
-	unsigned int fouropixels[3];
-	unsigned int fouripixels;
-
-	ilineptr = (unsigned int *) (screens[0]);
-	for (i=0 ; i<3 ; i++)
-	    olineptrs[i] = (unsigned int *) &image->data[i*X_width];
-
-	y = SCREENHEIGHT;
-	while (y--)
-	{
-	    x = SCREENWIDTH;
-	    do
-	    {
-		fouripixels = *ilineptr++;
-		fouropixels[0] = (fouripixels & 0xff000000)
-		    |	((fouripixels>>8) & 0xff0000)
-		    |	((fouripixels>>16) & 0xffff);
-		fouropixels[1] = ((fouripixels<<8) & 0xff000000)
-		    |	(fouripixels & 0xffff00)
-		    |	((fouripixels>>8) & 0xff);
-		fouropixels[2] = ((fouripixels<<16) & 0xffff0000)
-		    |	((fouripixels<<8) & 0xff00)
-		    |	(fouripixels & 0xff);
-#ifdef __BIG_ENDIAN__
-		*olineptrs[0]++ = fouropixels[0];
-		*olineptrs[1]++ = fouropixels[0];
-		*olineptrs[2]++ = fouropixels[0];
-		*olineptrs[0]++ = fouropixels[1];
-		*olineptrs[1]++ = fouropixels[1];
-		*olineptrs[2]++ = fouropixels[1];
-		*olineptrs[0]++ = fouropixels[2];
-		*olineptrs[1]++ = fouropixels[2];
-		*olineptrs[2]++ = fouropixels[2];
-#else
-		*olineptrs[0]++ = fouropixels[2];
-		*olineptrs[1]++ = fouropixels[2];
-		*olineptrs[2]++ = fouropixels[2];
-		*olineptrs[0]++ = fouropixels[1];
-		*olineptrs[1]++ = fouropixels[1];
-		*olineptrs[2]++ = fouropixels[1];
-		*olineptrs[0]++ = fouropixels[0];
-		*olineptrs[1]++ = fouropixels[0];
-		*olineptrs[2]++ = fouropixels[0];
-#endif
-	    } while (x-=4);
-	    olineptrs[0] += 2*X_width/4;
-	    olineptrs[1] += 2*X_width/4;
-	    olineptrs[2] += 2*X_width/4;
-	}
 
-    }
-    else if (multiply == 4)
-    {
-	// Broken. Gotta fix this some day.
-	void Expand4(unsigned *, double *);
-  	Expand4 ((unsigned *)(screens[0]), (double *) (image->data));
-    }
+    // to 32 bit pixels, at the window size, what changed
+    count = I_ScaleScreen (&rects);
+    if (!count)
+	return;
 
     if (doShm)
     {
 
-	if (!XShmPutImage(	X_display,
+	// the server takes them in order, so the completion
+	//  of the last says the image is free
+	for (i=0 ; i<count ; i++)
+	    if (!XShmPutImage(	X_display,
 				X_mainWindow,
 				X_gc,
 				image,
-				0, 0,
-				0, 0,
-				X_width, X_height,
-				True ))
-	    I_Error("XShmPutImage() failed\n");
-
-	// wait for it to finish and processes all input events
-	shmFinished = false;
-	do
-	{
-	    I_GetEvent();
-	} while (!shmFinished);
+				rects[i].x, rects[i].y,
+				rects[i].x, rects[i].y,
+				rects[i].width, rects[i].height,
+				i == count-1 ))
+		I_Error("XShmPutImage() failed\n");
+
+	// no waiting for it, the next frame goes to the next image
+	shmbusy[shmimage] = true;
+	shmimage = (shmimage+1) % numshmimages;
+
+	// sent now, rather than with the next request
+	XFlush(X_display);
 
     }
     else
     {
 
 	// draw the image
-	XPutImage(	X_display,
+	for (i=0 ; i<count ; i++)
+	    XPutImage(	X_display,
 			X_mainWindow,
 			X_gc,
 			image,
-			0, 0,
-			0, 0,
-			X_width, X_height );
+			rects[i].x, rects[i].y,
+			rects[i].x, rects[i].y,
+			rects[i].width, rects[i].height );
 
 	// sync up with server
 	XSync(X_display, False);
@@ -530,58 +478,12 @@ void I_ReadScreen (byte* scr)
 }
 
 
-//
-// Palette stuff.
-//
-static XColor	colors[256];
-
-void UploadNewPalette(Colormap cmap, byte *palette)
-{
-
-    register int	i;
-    register int	c;
-    static boolean	firstcall = true;
-
-#ifdef __cplusplus
-    if (X_visualinfo.c_class == PseudoColor && X_visualinfo.depth == 8)
-#else
-    if (X_visualinfo.class == PseudoColor && X_visualinfo.depth == 8)
-#endif
-	{
-	    // initialize the colormap
-	    if (firstcall)
-	    {
-		firstcall = false;
-		for (i=0 ; i<256 ; i++)
-		{
-		    colors[i].pixel = i;
-		    colors[i].flags = DoRed|DoGreen|DoBlue;
-		}
-	    }
-
-	    // set the X colormap entries
-	    for (i=0 ; i<256 ; i++)
-	    {
-		c = gammatable[usegamma][*palette++];
-		colors[i].red = (c<<8) + c;
-		c = gammatable[usegamma][*palette++];
-		colors[i].green = (c<<8) + c;
-		c = gammatable[usegamma][*palette++];
-		colors[i].blue = (c<<8) + c;
-	    }
-
-	    // store the colors to the current colormap
-	    XStoreColors(X_display, cmap, colors, 256);
-
-	}
-}
-
 //
 // I_SetPalette
 //
 void I_SetPalette (byte* palette)
 {
-    UploadNewPalette(X_cmap, palette);
+    I_SetScalePalette (palette);
 }
 
 
@@ -592,10 +494,12 @@ void I_SetPalette (byte* palette)
 //  thus there might have been stale
 //  handles accumulating.
 //
-void grabsharedmemory(int size)
+void grabsharedmemory(int buffer, int size)
 {
 
-  int			key = ('d'<<24) | ('o'<<16) | ('o'<<8) | 'm';
+  // each image starts at a key of its own, past the
+  //  5 tries of the one before
+  int			key = (('d'<<24) | ('o'<<16) | ('o'<<8) | 'm') + buffer*8;
   struct shmid_ds	shminfo;
   int			minsize = 320*200;
   int			id;
@@ -680,13 +584,13 @@ void grabsharedmemory(int size)
 	    "shared memory segments.\n");
     }	
   
-  X_shminfo.shmid = id;
+  X_shminfos[buffer].shmid = id;
   
   // attach to the shared memory segment
-  image->data = X_shminfo.shmaddr = shmat(id, 0, 0);
+  shmimages[buffer]->data = X_shminfos[buffer].shmaddr = shmat(id, 0, 0);
   
   fprintf(stderr, "shared memory id=%d, addr=0x%x\n", id,
-	  (int) (image->data));
+	  (int) (shmimages[buffer]->data));
 }
 
 void I_InitGraphics(void)
@@ -716,17 +620,8 @@ void I_InitGraphics(void)
 
     signal(SIGINT, (void (*)(int)) I_Quit);
 
-    if (M_CheckParm("-2"))
-	multiply = 2;
-
-    if (M_CheckParm("-3"))
-	multiply = 3;
-
-    if (M_CheckParm("-4"))
-	multiply = 4;
-
-    X_width = SCREENWIDTH * multiply;
-    X_height = SCREENHEIGHT * multiply;
+    // -2, -3, -4, -winwidth or -winheight
+    I_WindowSize (&X_width, &X_height);
 
     // check for command-line display name
     if ( (pnum=M_CheckParm("-disp")) ) // suggest parentheses around assignment
@@ -768,8 +663,8 @@ void I_InitGraphics(void)
 
     // use the default visual 
     X_screen = DefaultScreen(X_display);
-    if (!XMatchVisualInfo(X_display, X_screen, 8, PseudoColor, &X_visualinfo))
-	I_Error("xdoom currently only supports 256-color PseudoColor screens");
+    if (!XMatchVisualInfo(X_display, X_screen, 24, TrueColor, &X_visualinfo))
+	I_Error("xdoom needs a 24 bit TrueColor screen");
     X_visual = X_visualinfo.visual;
 
     // check for the MITSHM extension
@@ -790,9 +685,9 @@ void I_InitGraphics(void)
 
     fprintf(stderr, "Using MITSHM extension\n");
 
-    // create the colormap
+    // create the colormap, the palette is in the pixels
     X_cmap = XCreateColormap(X_display, RootWindow(X_display,
-						   X_screen), X_visual, AllocAll);
+						   X_screen), X_visual, AllocNone);
 
     // setup attributes for main window
     attribmask = CWEventMask | CWColormap | CWBorderPixel;
@@ -811,7 +706,7 @@ void I_InitGraphics(void)
 					x, y,
 					X_width, X_height,
 					0, // borderwidth
-					8, // depth
+					X_visualinfo.depth,
 					InputOutput,
 					X_visual,
 					attribmask,
@@ -855,18 +750,14 @@ void I_InitGraphics(void)
 
 	X_shmeventtype = XShmGetEventBase(X_display) + ShmCompletion;
 
-	// create the image
-	image = XShmCreateImage(	X_display,
-					X_visual,
-					8,
-					ZPixmap,
-					0,
-					&X_shminfo,
-					X_width,
-					X_height );
-
-	grabsharedmemory(image->bytes_per_line * image->height);
-
+	if ( (pnum=M_CheckParm("-shmbuffers")) && pnum < myargc-1 )
+	{
+	    numshmimages = atoi(myargv[pnum+1]);
+	    if (numshmimages < 1)
+		numshmimages = 1;
+	    if (numshmimages > MAXSHMIMAGES)
+		numshmimages = MAXSHMIMAGES;
+	}
 
 	// UNUSED
 	// create the shared memory segment
@@ -880,171 +771,58 @@ void I_InitGraphics(void)
 	// fprintf(stderr, "shared memory id=%d\n", X_shminfo.shmid);
 	// attach to the shared memory segment
 	// image->data = X_shminfo.shmaddr = shmat(X_shminfo.shmid, 0, 0);
-	
 
-	if (!image->data)
+	for (n=0 ; n<numshmimages ; n++)
 	{
-	    perror("");
-	    I_Error("shmat() failed in InitGraphics()");
+	    // create the image
+	    image = XShmCreateImage(	X_display,
+	    				X_visual,
+	    				X_visualinfo.depth,
+	    				ZPixmap,
+	    				0,
+	    				&X_shminfos[n],
+	    				X_width,
+	    				X_height );
+	    shmimages[n] = image;
+
+	    grabsharedmemory(n, image->bytes_per_line * image->height);
+
+	    if (!image->data)
+	    {
+		perror("");
+		I_Error("shmat() failed in InitGraphics()");
+	    }
+
+	    // get the X server to attach to it
+	    if (!XShmAttach(X_display, &X_shminfos[n]))
+		I_Error("XShmAttach() failed in InitGraphics()");
 	}
 
-	// get the X server to attach to it
-	if (!XShmAttach(X_display, &X_shminfo))
-	    I_Error("XShmAttach() failed in InitGraphics()");
+	image = shmimages[0];
+	fprintf(stderr, "Using %i shared images in turn\n", numshmimages);
 
     }
     else
     {
 	image = XCreateImage(	X_display,
     				X_visual,
-    				8,
+    				X_visualinfo.depth,
     				ZPixmap,
     				0,
-    				(char*)malloc(X_width * X_height),
+    				(char*)malloc(X_width * X_height * 4),
     				X_width, X_height,
-    				8,
-    				X_width );
+    				32,
+    				0 );
 
     }
 
-    if (multiply == 1)
-	screens[0] = (unsigned char *) (image->data);
-    else
-	screens[0] = (unsigned char *) malloc (SCREENWIDTH * SCREENHEIGHT);
-
-}
-
+    if (image->bits_per_pixel != 32)
+	I_Error("xdoom needs 32 bit pixels, not %i", image->bits_per_pixel);
 
-unsigned	exptable[256];
+    // screens[0] stays where V_Init put it
+    I_InitScale ((byte *) image->data, X_width, X_height,
+		 image->bytes_per_line, X_visualinfo.red_mask,
+		 X_visualinfo.green_mask, X_visualinfo.blue_mask);
 
-void InitExpand (void)
-{
-    int		i;
-	
-    for (i=0 ; i<256 ; i++)
-	exptable[i] = i | (i<<8) | (i<<16) | (i<<24);
 }
 
-double		exptable2[256*256];
-
-void InitExpand2 (void)
-{
-    int		i;
-    int		j;
-    // UNUSED unsigned	iexp, jexp;
-    double*	exp;
-    union
-    {
-	double 		d;
-	unsigned	u[2];
-    } pixel;
-	
-    printf ("building exptable2...\n");
-    exp = exptable2;
-    for (i=0 ; i<256 ; i++)
-    {
-	pixel.u[0] = i | (i<<8) | (i<<16) | (i<<24);
-	for (j=0 ; j<256 ; j++)
-	{
-	    pixel.u[1] = j | (j<<8) | (j<<16) | (j<<24);
-	    *exp++ = pixel.d;
-	}
-    }
-    printf ("done.\n");
-}
-
-int	inited;
-
-void
-Expand4
-( unsigned*	lineptr,
-  double*	xline )
-{
-    double	dpixel;
-    unsigned	x;
-    unsigned 	y;
-    unsigned	fourpixels;
-    unsigned	step;
-    double*	exp;
-	
-    exp = exptable2;
-    if (!inited)
-    {
-	inited = 1;
-	InitExpand2 ();
-    }
-		
-		
-    step = 3*SCREENWIDTH/2;
-	
-    y = SCREENHEIGHT-1;
-    do
-    {
-	x = SCREENWIDTH;
-
-	do
-	{
-	    fourpixels = lineptr[0];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[0] = dpixel;
-	    xline[160] = dpixel;
-	    xline[320] = dpixel;
-	    xline[480] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[1] = dpixel;
-	    xline[161] = dpixel;
-	    xline[321] = dpixel;
-	    xline[481] = dpixel;
-
-	    fourpixels = lineptr[1];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[2] = dpixel;
-	    xline[162] = dpixel;
-	    xline[322] = dpixel;
-	    xline[482] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[3] = dpixel;
-	    xline[163] = dpixel;
-	    xline[323] = dpixel;
-	    xline[483] = dpixel;
-
-	    fourpixels = lineptr[2];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[4] = dpixel;
-	    xline[164] = dpixel;
-	    xline[324] = dpixel;
-	    xline[484] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[5] = dpixel;
-	    xline[165] = dpixel;
-	    xline[325] = dpixel;
-	    xline[485] = dpixel;
-
-	    fourpixels = lineptr[3];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[6] = dpixel;
-	    xline[166] = dpixel;
-	    xline[326] = dpixel;
-	    xline[486] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[7] = dpixel;
-	    xline[167] = dpixel;
-	    xline[327] = dpixel;
-	    xline[487] = dpixel;
-
-	    lineptr+=4;
-	    xline+=8;
-	} while (x-=16);
-	xline += step;
-    } while (y--);
-}
-
-
@@ -0,0 +1,185 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	DOOM graphics stuff without a display, for timedemos
+//	 and benchmarks on machines with no X server.
+//	The screen is converted and scaled as for a window,
+//	 into memory only, and every so many frames written
+//	 to a PCX file with -dumpframes <n>.
+//
+//-----------------------------------------------------------------------------
+
+static const char
+rcsid[] = "$Id:$";
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <signal.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "v_video.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "i_scale.h"
+
+#include "doomdef.h"
+
+#include "i_video.h"
+
+
+// What a window would show, as of the last I_FinishUpdate.
+static byte*	framebuffer;
+static int	framewidth;
+static int	frameheight;
+
+// The palette as set, with gamma correction, for the dumps.
+static byte	palette[256*3];
+
+// -dumpframes <n>, every n-th frame is written, 0 if none.
+static int	dumpframes;
+static int	framecount;
+
+// Window pixels scaled, for how much the dirty
+//  rectangles saved over scaling every frame whole.
+static double	scaledpixels;
+
+
+void I_ShutdownGraphics(void)
+{
+    if (framecount)
+	fprintf (stderr, "I_ShutdownGraphics: %i frames, %.1f%% of the "
+		 "window scaled\n", framecount,
+		 100*scaledpixels/((double)framecount*framewidth*frameheight));
+    framecount = 0;
+
+    if (framebuffer)
+	free (framebuffer);
+    framebuffer = NULL;
+}
+
+
+
+//
+// I_StartFrame
+//
+void I_StartFrame (void)
+{
+}
+
+
+//
+// I_StartTic
+// There is nothing to read input from.
+//
+void I_StartTic (void)
+{
+}
+
+
+//
+// I_UpdateNoBlit
+//
+void I_UpdateNoBlit (void)
+{
+}
+
+
+//
+// I_FinishUpdate
+//
+void I_FinishUpdate (void)
+{
+    char		name[32];
+    scalerect_t*	rects;
+    int			count;
+    int			i;
+
+    // as the X version, without the blits
+    count = I_ScaleScreen (&rects);
+    for (i=0 ; i<count ; i++)
+	scaledpixels += (double)rects[i].width*rects[i].height;
+
+    if (dumpframes && !(framecount % dumpframes))
+    {
+	sprintf (name, "FRAME%05i.pcx", framecount);
+	WritePCXfile (name, screens[0], SCREENWIDTH, SCREENHEIGHT, palette);
+    }
+    framecount++;
+}
+
+
+//
+// I_ReadScreen
+//
+void I_ReadScreen (byte* scr)
+{
+    memcpy (scr, screens[0], SCREENWIDTH*SCREENHEIGHT);
+}
+
+
+//
+// I_SetPalette
+//
+void I_SetPalette (byte* pal)
+{
+    int		i;
+
+    I_SetScalePalette (pal);
+
+    for (i=0 ; i<256*3 ; i++)
+	palette[i] = gammatable[usegamma][*pal++];
+}
+
+
+//
+// I_InitGraphics
+//
+void I_InitGraphics(void)
+{
+    static int		firsttime=1;
+    int			p;
+
+    if (!firsttime)
+	return;
+    firsttime = 0;
+
+    signal(SIGINT, (void (*)(int)) I_Quit);
+
+    p = M_CheckParm ("-dumpframes");
+    if (p && p < myargc-1)
+    {
+	dumpframes = atoi (myargv[p+1]);
+	if (dumpframes < 0)
+	    I_Error ("I_InitGraphics: bad -dumpframes %i", dumpframes);
+    }
+
+    // -2, -3, -4, -winwidth or -winheight
+    I_WindowSize (&framewidth, &frameheight);
+    framebuffer = (byte *) malloc (framewidth * frameheight * 4);
+    if (!framebuffer)
+	I_Error ("I_InitGraphics: no memory for a %ix%i window",
+		 framewidth, frameheight);
+    I_InitScale (framebuffer, framewidth, frameheight, framewidth*4,
+		 0xff0000, 0xff00, 0xff);
+
+    fprintf (stderr, "I_InitGraphics: %ix%i window without a display\n",
+	     framewidth, frameheight);
+}
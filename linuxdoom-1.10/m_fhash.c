@@ -0,0 +1,244 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Frame hashes of demo playback.
+//	One line per tic, "tic hash", after a line with
+//	 the screen size.
+//
+//-----------------------------------------------------------------------------
+
+
+static const char
+rcsid[] = "$Id:$";
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+
+#include "z_zone.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "v_video.h"
+#include "w_wad.h"
+
+#include "m_fhash.h"
+
+
+#define HASHLANES	4
+#define HASHPRIME	0x9e3779b1u
+
+typedef unsigned	framehash_t[HASHLANES];
+
+static FILE*		hashfile;
+static boolean		comparing;
+static int		dumptic = -1;
+
+static int		hashedtics;
+
+
+//
+// M_HashScreen
+// Four independent multiply chains over the words of
+//  screens[0], so the multiplies overlap; about as
+//  cheap as a copy of the screen.
+//
+static void M_HashScreen (framehash_t hash)
+{
+    unsigned*	src;
+    unsigned	a;
+    unsigned	b;
+    unsigned	c;
+    unsigned	d;
+    int		count;
+
+    a = 1;
+    b = 2;
+    c = 3;
+    d = 4;
+
+    // SCREENWIDTH is a multiple of 4, see V_Init
+    src = (unsigned *)screens[0];
+    count = SCREENWIDTH*SCREENHEIGHT/4;
+
+    for ( ; count >= HASHLANES ; count -= HASHLANES, src += HASHLANES)
+    {
+	a = (a ^ src[0]) * HASHPRIME;
+	b = (b ^ src[1]) * HASHPRIME;
+	c = (c ^ src[2]) * HASHPRIME;
+	d = (d ^ src[3]) * HASHPRIME;
+	a ^= a >> 15;
+	b ^= b >> 15;
+	c ^= c >> 15;
+	d ^= d >> 15;
+    }
+    while (count--)
+    {
+	a = (a ^ *src++) * HASHPRIME;
+	a ^= a >> 15;
+    }
+
+    // so that each lane depends on all of them
+    hash[0] = (a ^ (b >> 7) ^ (c << 11) ^ d) * HASHPRIME;
+    hash[1] = (b ^ (c >> 7) ^ (d << 11) ^ a) * HASHPRIME;
+    hash[2] = (c ^ (d >> 7) ^ (a << 11) ^ b) * HASHPRIME;
+    hash[3] = (d ^ (a >> 7) ^ (b << 11) ^ c) * HASHPRIME;
+}
+
+
+//
+// M_DumpFrame
+//
+static void M_DumpFrame (char* prefix, int tic)
+{
+    char	name[32];
+
+    sprintf (name, "%s%05i.pcx", prefix, tic);
+    WritePCXfile (name, screens[0], SCREENWIDTH, SCREENHEIGHT,
+		  W_CacheLumpName ("PLAYPAL", PU_CACHE));
+    printf ("M_FrameHash: tic %i written to %s\n", tic, name);
+}
+
+
+//
+// M_InitFrameHash
+//
+void M_InitFrameHash (void)
+{
+    int		p;
+    int		width;
+    int		height;
+
+    p = M_CheckParm ("-framedump");
+    if (p && p < myargc-1)
+	dumptic = atoi (myargv[p+1]);
+
+    p = M_CheckParm ("-framehash");
+    if (p && p < myargc-1)
+    {
+	hashfile = fopen (myargv[p+1], "w");
+	if (!hashfile)
+	    I_Error ("M_InitFrameHash: couldn't create %s", myargv[p+1]);
+	fprintf (hashfile, "%i %i\n", SCREENWIDTH, SCREENHEIGHT);
+    }
+    else
+    {
+	p = M_CheckParm ("-framecmp");
+	if (!p || p >= myargc-1)
+	    return;
+
+	hashfile = fopen (myargv[p+1], "r");
+	if (!hashfile)
+	    I_Error ("M_InitFrameHash: couldn't open %s", myargv[p+1]);
+	if (fscanf (hashfile, "%i %i", &width, &height) != 2)
+	    I_Error ("M_InitFrameHash: %s is not a frame hash file",
+		     myargv[p+1]);
+	if (width != SCREENWIDTH || height != SCREENHEIGHT)
+	    I_Error ("M_InitFrameHash: %s is for a %ix%i screen",
+		     myargv[p+1], width, height);
+	comparing = true;
+    }
+
+    if (M_CheckParm ("-nodraw"))
+	I_Error ("M_InitFrameHash: -nodraw leaves nothing to hash");
+
+    // one frame per tic, drawn at the tic itself,
+    //  however fast or slow it goes
+    singletics = true;
+
+    printf ("M_InitFrameHash: %s frames of demo playback.\n",
+	    comparing ? "checking" : "hashing");
+}
+
+
+//
+// M_FrameHash
+//
+void M_FrameHash (void)
+{
+    framehash_t	hash;
+    framehash_t	refhash;
+    int		tic;
+    int		i;
+
+    if (!demoplayback)
+	return;
+
+    if (gametic == dumptic)
+	M_DumpFrame ("FDUMP", gametic);
+
+    if (!hashfile)
+	return;
+
+    M_HashScreen (hash);
+    hashedtics++;
+
+    if (!comparing)
+    {
+	fprintf (hashfile, "%i %08x%08x%08x%08x\n",
+		 gametic, hash[0], hash[1], hash[2], hash[3]);
+	return;
+    }
+
+    if (fscanf (hashfile, "%i %8x%8x%8x%8x", &tic,
+		&refhash[0], &refhash[1], &refhash[2], &refhash[3]) != 5)
+    {
+	M_DumpFrame ("FCMP", gametic);
+	I_Error ("M_FrameHash: the reference ends before tic %i", gametic);
+    }
+    if (tic != gametic)
+	I_Error ("M_FrameHash: reference tic %i where %i was expected",
+		 tic, gametic);
+
+    for (i=0 ; i<HASHLANES ; i++)
+	if (hash[i] != refhash[i])
+	    break;
+    if (i == HASHLANES)
+	return;
+
+    M_DumpFrame ("FCMP", gametic);
+    I_Error ("M_FrameHash: tic %i differs after %i matching tics,\n"
+	     "run the reference with -framedump %i for its frame",
+	     gametic, hashedtics-1, gametic);
+}
+
+
+//
+// M_FinishFrameHash
+//
+void M_FinishFrameHash (void)
+{
+    int		tic;
+
+    if (!hashfile)
+	return;
+
+    if (comparing)
+    {
+	if (fscanf (hashfile, "%i", &tic) == 1)
+	    I_Error ("M_FrameHash: the demo ended before reference tic %i",
+		     tic);
+	printf ("M_FrameHash: all %i tics match\n", hashedtics);
+    }
+    else
+	printf ("M_FrameHash: %i tics hashed\n", hashedtics);
+
+    fclose (hashfile);
+    hashfile = NULL;
+}
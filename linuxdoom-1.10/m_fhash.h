@@ -0,0 +1,55 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Frame hashes of demo playback, for checking that
+//	 the renderer still draws exactly what it used to.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __M_FHASH__
+#define __M_FHASH__
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// -framehash <file> writes a hash of screens[0] for
+//  every tic of demo playback.
+// -framecmp <file> checks each tic against such a file,
+//  and stops at the first that differs, with its frame
+//  written to FCMPnnnnn.pcx.
+// -framedump <tic> writes FDUMPnnnnn.pcx for that tic,
+//  to get the other frame from the reference build.
+// Called by D_DoomMain.
+void M_InitFrameHash (void);
+
+// Called by D_DoomLoop after each D_Display.
+void M_FrameHash (void);
+
+// Called by G_CheckDemoStatus when the demo is over.
+void M_FinishFrameHash (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
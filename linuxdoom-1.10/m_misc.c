@@ -113,7 +113,7 @@ M_DrawText
 	}
 		
 	w = SHORT (hu_font[c]->width);
-	if (x+w > SCREENWIDTH)
+	if (x+w > BASE_WIDTH)
 	    break;
 	if (direct)
 	    V_DrawPatchDirect(x, y, 0, hu_font[c]);
@@ -42,6 +42,14 @@ M_ReadFile
 ( char const*	name,
   byte**	buffer );
 
+void
+WritePCXfile
+( char*		filename,
+  byte*		data,
+  int		width,
+  int		height,
+  byte*		palette );
+
 void M_ScreenShot (void);
 
 void M_LoadDefaults (void);
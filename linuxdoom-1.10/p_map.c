@@ -171,6 +171,11 @@ P_TeleportMove
     thing->x = x;
     thing->y = y;
 
+    // no frames in between the old spot and the new
+    thing->oldx = x;
+    thing->oldy = y;
+    thing->oldz = thing->z;
+
     P_SetThingPosition (thing);
 	
     return true;
@@ -397,7 +397,7 @@ P_NightmareRespawn (mobj_t* mobj)
     // inherit attributes from deceased one
     mo = P_SpawnMobj (x,y,z, mobj->type);
     mo->spawnpoint = mobj->spawnpoint;	
-    mo->angle = ANG45 * (mthing->angle/45);
+    mo->angle = mo->oldangle = ANG45 * (mthing->angle/45);
 
     if (mthing->options & MTF_AMBUSH)
 	mo->flags |= MF_AMBUSH;
@@ -493,8 +493,8 @@ P_SpawnMobj
 	
     mobj->type = type;
     mobj->info = info;
-    mobj->x = x;
-    mobj->y = y;
+    mobj->x = mobj->oldx = x;
+    mobj->y = mobj->oldy = y;
     mobj->radius = info->radius;
     mobj->height = info->height;
     mobj->flags = info->flags;
@@ -526,6 +526,8 @@ P_SpawnMobj
     else 
 	mobj->z = z;
 
+    mobj->oldz = mobj->z;
+
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	
     P_AddThinker (&mobj->thinker);
@@ -624,7 +626,7 @@ void P_RespawnSpecials (void)
 
     mo = P_SpawnMobj (x,y,z, i);
     mo->spawnpoint = *mthing;	
-    mo->angle = ANG45 * (mthing->angle/45);
+    mo->angle = mo->oldangle = ANG45 * (mthing->angle/45);
 
     // pull it from the que
     iquetail = (iquetail+1)&(ITEMQUESIZE-1);
@@ -668,7 +670,7 @@ void P_SpawnPlayer (mapthing_t* mthing)
     if (mthing->type > 1)		
 	mobj->flags |= (mthing->type-1)<<MF_TRANSSHIFT;
 		
-    mobj->angle	= ANG45 * (mthing->angle/45);
+    mobj->angle	= mobj->oldangle = ANG45 * (mthing->angle/45);
     mobj->player = p;
     mobj->health = p->health;
 
@@ -682,6 +684,9 @@ void P_SpawnPlayer (mapthing_t* mthing)
     p->fixedcolormap = 0;
     p->viewheight = VIEWHEIGHT;
 
+    // not from where the last life ended
+    p->viewz = p->oldviewz = mobj->z + VIEWHEIGHT;
+
     // setup gun psprite
     P_SetupPsprites (p);
     
@@ -791,7 +796,7 @@ void P_SpawnMapThing (mapthing_t* mthing)
     if (mobj->flags & MF_COUNTITEM)
 	totalitems++;
 		
-    mobj->angle = ANG45 * (mthing->angle/45);
+    mobj->angle = mobj->oldangle = ANG45 * (mthing->angle/45);
     if (mthing->options & MTF_AMBUSH)
 	mobj->flags |= MF_AMBUSH;
 }
@@ -282,6 +282,13 @@ typedef struct mobj_s
 
     // Thing being chased/attacked for tracers.
     struct mobj_s*	tracer;	
+
+    // Position and angle at the start of the last tic,
+    //  to draw frames in between tics (see P_Ticker).
+    fixed_t		oldx;
+    fixed_t		oldy;
+    fixed_t		oldz;
+    angle_t		oldangle;
     
 } mobj_t;
 
@@ -44,6 +44,8 @@ rcsid[] = "$Id: p_setup.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 #include "s_sound.h"
 
 #include "doomstat.h"
+#include "r_pvs.h"
+#include "r_reuse.h"
 
 
 void	P_SpawnMapThing (mapthing_t*	mthing);
@@ -246,6 +248,8 @@ void P_LoadSectors (int lump)
     {
 	ss->floorheight = SHORT(ms->floorheight)<<FRACBITS;
 	ss->ceilingheight = SHORT(ms->ceilingheight)<<FRACBITS;
+	ss->oldfloorheight = ss->floorheight;
+	ss->oldceilingheight = ss->ceilingheight;
 	ss->floorpic = R_FlatNumForName(ms->floorpic);
 	ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
 	ss->lightlevel = SHORT(ms->lightlevel);
@@ -533,7 +537,7 @@ void P_GroupLines (void)
     }
 	
     // build line tables for each sector	
-    linebuffer = Z_Malloc (total*4, PU_LEVEL, 0);
+    linebuffer = Z_Malloc (total*sizeof(*linebuffer), PU_LEVEL, 0);
     sector = sectors;
     for (i=0 ; i<numsectors ; i++, sector++)
     {
@@ -599,10 +603,6 @@ P_SetupLevel
 	    = players[i].itemcount = 0;
     }
 
-    // Initial height of PointOfView
-    // will be set by player think.
-    players[consoleplayer].viewz = 1; 
-
     // Make sure all sounds are stopped before Z_FreeTags.
     S_Start ();			
 
@@ -675,6 +675,10 @@ P_SetupLevel
 			
     }
 
+    // Initial height of PointOfView
+    // will be set by player think.
+    players[consoleplayer].viewz = 1; 
+
     // clear special respawning que
     iquehead = iquetail = 0;		
 	
@@ -684,10 +688,20 @@ P_SetupLevel
     // build subsector connect matrix
     //	UNUSED P_ConnectSubsectors ();
 
+    // potentially visible sets, for the BSP walk
+    R_BuildPVS ();
+    R_ForgetView ();
+
+    // composite the wall textures
+    R_BuildColumnStore ();
+
     // preload graphics
     if (precache)
 	R_PrecacheLevel ();
 
+    // only does anything the first time
+    R_GenerateMipmaps ();
+
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
 
 }
@@ -152,7 +152,7 @@ void P_InitPicAnims (void)
     
     //	Init animation
     lastanim = anims;
-    for (i=0 ; animdefs[i].istexture != 255 ; i++)
+    for (i=0 ; animdefs[i].istexture != (boolean)-1 ; i++)
     {
         // Validate start and end names are printable ASCII
         int valid = 1;
@@ -201,6 +201,32 @@ void P_InitPicAnims (void)
 }
 
 
+//
+// P_MarkAnimatedTextures
+//
+void P_MarkAnimatedTextures (byte* present)
+{
+    anim_t*	anim;
+    int		i;
+
+    for (anim = anims ; anim < lastanim ; anim++)
+    {
+	if (!anim->istexture)
+	    continue;
+
+	for (i=anim->basepic ; i<anim->basepic+anim->numpics ; i++)
+	    if (present[i])
+		break;
+
+	if (i == anim->basepic+anim->numpics)
+	    continue;
+
+	for (i=anim->basepic ; i<anim->basepic+anim->numpics ; i++)
+	    present[i] = 1;
+    }
+}
+
+
 
 //
 // UTILITIES
@@ -41,6 +41,10 @@ extern	int	levelTimeCount;
 // at game start
 void    P_InitPicAnims (void);
 
+// Marks every frame of the texture animations
+//  with a frame in present[].
+void    P_MarkAnimatedTextures (byte* present);
+
 // at map load
 void    P_SpawnSpecials (void);
 
@@ -255,6 +259,10 @@ P_ChangeSwitchTexture
 
 void P_InitSwitchList(void);
 
+// Marks the other texture of every switch
+//  pair with one of them in present[].
+void P_MarkSwitchTextures (byte* present);
+
 
 //
 // P_PLATS
@@ -148,6 +148,19 @@ void P_InitSwitchList(void)
 }
 
 
+//
+// P_MarkSwitchTextures
+//
+void P_MarkSwitchTextures (byte* present)
+{
+    int		i;
+
+    for (i = 0;i < numswitches*2;i++)
+	if (present[switchlist[i]])
+	    present[switchlist[i^1]] = 1;
+}
+
+
 //
 // Start a button counting down till it turns off.
 //
@@ -26,6 +26,7 @@ static const char
 rcsid[] = "$Id: p_tick.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
 #include "z_zone.h"
+#include "i_system.h"
 #include "p_local.h"
 
 #include "doomstat.h"
@@ -33,6 +34,9 @@ rcsid[] = "$Id: p_tick.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
 int	leveltime;
 
+// I_GetTimeMS of the last tic that moved the world.
+int	lasttictime;
+
 //
 // THINKERS
 // All thinkers should be allocated by Z_Malloc
@@ -123,6 +127,45 @@ void P_RunThinkers (void)
 
 
 
+//
+// P_StoreOldPositions
+// Remembers where everything the refresh interpolates
+//  was before the tic moves it.
+//
+void P_StoreOldPositions (void)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+    sector_t*	sec;
+    int		i;
+
+    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    {
+	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+	    continue;
+
+	mo = (mobj_t *)th;
+	mo->oldx = mo->x;
+	mo->oldy = mo->y;
+	mo->oldz = mo->z;
+	mo->oldangle = mo->angle;
+    }
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->oldfloorheight = sec->floorheight;
+	sec->oldceilingheight = sec->ceilingheight;
+    }
+
+    // a viewz of 1 is no tic yet on this level (P_SetupLevel),
+    //  oldviewz stays as P_SpawnPlayer left it
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	if (playeringame[i] && players[i].viewz != 1)
+	    players[i].oldviewz = players[i].viewz;
+}
+
+
+
 //
 // P_Ticker
 //
@@ -144,6 +187,8 @@ void P_Ticker (void)
 	return;
     }
     
+    P_StoreOldPositions ();
+    lasttictime = I_GetTimeMS ();
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
@@ -34,6 +34,11 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// Snapshot of mobj, sector and view heights
+//  taken before each tic, for interpolation.
+void P_StoreOldPositions (void);
+extern int	lasttictime;
+
 
 
 #endif
@@ -0,0 +1,243 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Drawer benchmark. Each variant fills the view the
+//	 same way its generic drawer does, from a made up
+//	 column or flat, and both are timed.
+//
+//-----------------------------------------------------------------------------
+
+
+static const char
+rcsid[] = "$Id:$";
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+
+#include "z_zone.h"
+#include "i_system.h"
+
+#include "r_local.h"
+
+#ifdef __GNUG__
+#pragma implementation "r_bench.h"
+#endif
+#include "r_bench.h"
+
+
+#define BENCHPASSES	64
+
+// The column repeats all the way, so the generic drawer
+//  reads on into the same texels a wrapped run tiles.
+#define COLUMNHEIGHT	128
+#define SOURCESIZE	(COLUMNHEIGHT*64)
+
+enum
+{
+    BENCH_INSIDE,	// a column run inside the column
+    BENCH_WRAP,		// one that tiles it
+    BENCH_TRANSLATED,	// inside, with translation 1
+    BENCH_SPAN
+};
+
+typedef struct
+{
+    char*	name;
+    void	(*variant) (void);
+    char*	genericname;
+    void	(*generic) (void);
+    int		detail;
+    int		run;
+
+} benchcase_t;
+
+static benchcase_t	benchcases[] =
+{
+    {"R_DrawColumnInside", R_DrawColumnInside,
+     "R_DrawColumn", R_DrawColumn, 0, BENCH_INSIDE},
+    {"R_DrawColumnWrap", R_DrawColumnWrap,
+     "R_DrawColumn", R_DrawColumn, 0, BENCH_WRAP},
+    {"R_DrawColumnInside", R_DrawColumnInside,
+     "R_DrawTranslatedColumn", R_DrawTranslatedColumn, 0, BENCH_TRANSLATED},
+    {"R_DrawSpanRow", R_DrawSpanRow,
+     "R_DrawSpan", R_DrawSpan, 0, BENCH_SPAN},
+    {"R_DrawColumnLowInside", R_DrawColumnLowInside,
+     "R_DrawColumnLow", R_DrawColumnLow, 1, BENCH_INSIDE},
+    {"R_DrawColumnLowWrap", R_DrawColumnLowWrap,
+     "R_DrawColumnLow", R_DrawColumnLow, 1, BENCH_WRAP},
+    {"R_DrawSpanLowRow", R_DrawSpanLowRow,
+     "R_DrawSpanLow", R_DrawSpanLow, 1, BENCH_SPAN},
+    {NULL}
+};
+
+static byte*	benchsource;
+static byte*	benchflat;
+static byte*	benchview[2];
+
+void R_ExecuteSetViewSize (void);
+
+// from r_draw.c
+extern byte*	ylookup[MAXHEIGHT];
+extern int	columnofs[MAXWIDTH];
+
+
+//
+// R_ClearBenchView
+//
+static void R_ClearBenchView (void)
+{
+    int		y;
+
+    for (y=0 ; y<viewheight ; y++)
+	memset (ylookup[y] + columnofs[0], 0, scaledviewwidth);
+}
+
+
+//
+// R_CopyBenchView
+//
+static void R_CopyBenchView (byte* to)
+{
+    int		x;
+    int		y;
+
+    for (y=0 ; y<viewheight ; y++)
+	for (x=0 ; x<scaledviewwidth ; x++)
+	    *to++ = ylookup[y][columnofs[x]];
+}
+
+
+//
+// R_TimeDrawer
+// Nanoseconds per pixel of the view.
+//
+static double
+R_TimeDrawer
+( void		(*func) (void),
+  benchcase_t*	bench,
+  boolean	variant )
+{
+    lighttable_t*	colormap;
+    unsigned		start;
+    int			pass;
+    int			x;
+    int			y;
+
+    colormap = colormaps + 8*256;
+
+    start = I_GetTimeUS ();
+
+    for (pass=0 ; pass<BENCHPASSES ; pass++)
+    {
+	if (bench->run == BENCH_SPAN)
+	{
+	    for (y=0 ; y<viewheight ; y++)
+	    {
+		ds_y = y;
+		ds_x1 = 0;
+		ds_x2 = viewwidth-1;
+		ds_xfrac = y*3*FRACUNIT;
+		ds_yfrac = -y*FRACUNIT;
+		ds_xstep = FRACUNIT*7/10;
+		ds_ystep = FRACUNIT*3/10;
+		ds_colormap = colormap;
+		ds_source = benchflat;
+		func ();
+	    }
+	    continue;
+	}
+
+	for (x=0 ; x<viewwidth ; x++)
+	{
+	    dc_x = x;
+	    dc_yl = 0;
+	    dc_yh = viewheight-1;
+	    dc_source = benchsource;
+	    dc_colormap = colormap;
+	    dc_translation = translationtables;
+	    dc_heightmask = COLUMNHEIGHT-1;
+
+	    if (bench->run == BENCH_WRAP)
+		dc_iscale = FRACUNIT;
+	    else
+		dc_iscale = ((COLUMNHEIGHT-1)<<FRACBITS) / viewheight;
+	    dc_texturemid = centery*dc_iscale;
+
+	    if (bench->run == BENCH_TRANSLATED && variant)
+		dc_colormap = R_TranslatedColormap (1, colormap);
+	    func ();
+	}
+    }
+
+    return (I_GetTimeUS () - start) * 1000.0
+	/ ((double)BENCHPASSES * viewwidth * viewheight);
+}
+
+
+//
+// R_BenchDrawers
+//
+void R_BenchDrawers (void)
+{
+    benchcase_t*	bench;
+    double		varianttime;
+    double		generictime;
+    int			i;
+
+    benchsource = Z_Malloc (SOURCESIZE, PU_STATIC, 0);
+    benchflat = Z_Malloc (64*64, PU_STATIC, 0);
+    benchview[0] = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, 0);
+    benchview[1] = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, 0);
+
+    for (i=0 ; i<COLUMNHEIGHT ; i++)
+	benchsource[i] = rand ();
+    for ( ; i<SOURCESIZE ; i++)
+	benchsource[i] = benchsource[i & (COLUMNHEIGHT-1)];
+    for (i=0 ; i<64*64 ; i++)
+	benchflat[i] = rand ();
+
+    printf ("R_BenchDrawers: ns per pixel, %i passes\n", BENCHPASSES);
+
+    for (bench=benchcases ; bench->name ; bench++)
+    {
+	// spans are only drawn a row at a time untransposed
+	if (bench->run == BENCH_SPAN && transposed)
+	    continue;
+
+	R_SetViewSize (11, bench->detail);
+	R_ExecuteSetViewSize ();
+
+	R_ClearBenchView ();
+	generictime = R_TimeDrawer (bench->generic, bench, false);
+	R_CopyBenchView (benchview[0]);
+
+	R_ClearBenchView ();
+	varianttime = R_TimeDrawer (bench->variant, bench, true);
+	R_CopyBenchView (benchview[1]);
+
+	printf ("  %-22s %6.2f   %-22s %6.2f   %s\n",
+		bench->name, varianttime,
+		bench->genericname, generictime,
+		memcmp (benchview[0], benchview[1],
+			scaledviewwidth*viewheight) ? "DIFFERENT" : "same");
+    }
+}
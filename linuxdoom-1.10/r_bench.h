@@ -0,0 +1,45 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Timing of the drawer variants against the generic
+//	 drawers they stand in for.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __R_BENCH__
+#define __R_BENCH__
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// -drawbench draws a full screen view with each variant
+//  and its generic drawer, and prints the time per pixel
+//  and whether they drew the same.
+// Called by D_DoomMain after R_Init, which then quits.
+void R_BenchDrawers (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -26,15 +26,20 @@ static const char
 rcsid[] = "$Id: r_bsp.c,v 1.4 1997/02/03 22:45:12 b1 Exp $";
 
 
+#include <stdlib.h>
+
 #include "doomdef.h"
 
 #include "m_bbox.h"
 
 #include "i_system.h"
+#include "i_thread.h"
 
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_things.h"
+#include "r_pvs.h"
+#include "r_reuse.h"
 
 // State.
 #include "doomstat.h"
@@ -44,14 +49,16 @@ rcsid[] = "$Id: r_bsp.c,v 1.4 1997/02/03 22:45:12 b1 Exp $";
 
 
 
-seg_t*		curline;
-side_t*		sidedef;
-line_t*		linedef;
-sector_t*	frontsector;
-sector_t*	backsector;
+THREADLOCAL seg_t*		curline;
+THREADLOCAL side_t*		sidedef;
+THREADLOCAL line_t*		linedef;
+THREADLOCAL sector_t*	frontsector;
+THREADLOCAL sector_t*	backsector;
 
-drawseg_t	drawsegs[MAXDRAWSEGS];
-drawseg_t*	ds_p;
+// Grown as needed, see R_CheckDrawSegs.
+THREADLOCAL drawseg_t*	drawsegs;
+THREADLOCAL drawseg_t*	ds_p;
+THREADLOCAL int		maxdrawsegs;
 
 
 void
@@ -71,27 +78,181 @@ void R_ClearDrawSegs (void)
 }
 
 
+//
+// R_PublishDrawSegs
+// Each strip's drawsegs, for R_MapDrawnLines.
+//
+static drawseg_t*	stripdrawsegs[MAXTHREADS];
+static int		numstripdrawsegs[MAXTHREADS];
+
+void R_PublishDrawSegs (int strip)
+{
+    stripdrawsegs[strip] = drawsegs;
+    numstripdrawsegs[strip] = ds_p - drawsegs;
+}
+
+
+//
+// R_MapDrawnLines
+// Marks the lines of every wall drawn as seen, for the
+//  auto map. The strips share the lines, so this is done
+//  by one thread once they are all done.
+//
+void R_MapDrawnLines (int strips)
+{
+    drawseg_t*	ds;
+    int		strip;
+    int		i;
+
+    for (strip=0 ; strip<strips ; strip++)
+    {
+	ds = stripdrawsegs[strip];
+	for (i=0 ; i<numstripdrawsegs[strip] ; i++, ds++)
+	    ds->curline->linedef->flags |= ML_MAPPED;
+    }
+}
+
+
+//
+// R_CheckDrawSegs
+// Makes room for one more drawseg.
+//
+void R_CheckDrawSegs (void)
+{
+    int		count;
+
+    if (ds_p < drawsegs + maxdrawsegs)
+	return;
+
+    count = ds_p - drawsegs;
+    maxdrawsegs = maxdrawsegs ? maxdrawsegs*2 : 256;
+    drawsegs = realloc (drawsegs, maxdrawsegs*sizeof(*drawsegs));
+    if (!drawsegs)
+	I_Error ("R_CheckDrawSegs: no memory for %i drawsegs", maxdrawsegs);
+    ds_p = drawsegs + count;
+}
+
+
 
 //
 // ClipWallSegment
 // Clips the given range of columns
 // and includes it in the new clip list.
 //
-typedef	struct
+// The clip list is a bitmap with a bit set for every
+//  column a solid wall already covers, plus a count
+//  of the columns still open in this thread's strip.
+//
+#define SOLIDWORDS		((MAXWIDTH+31)/32)
+
+THREADLOCAL unsigned	solidcols[SOLIDWORDS];
+THREADLOCAL int		opencolumns;
+
+
+//
+// R_LowestBit
+// Index of the lowest set bit of a nonzero word.
+//
+#ifdef _MSC_VER
+#include <intrin.h>
+
+static int R_LowestBit (unsigned bits)
 {
-    int	first;
-    int last;
-    
-} cliprange_t;
+    unsigned long	index;
+
+    _BitScanForward (&index, bits);
+    return index;
+}
+#else
+#define R_LowestBit(bits)	__builtin_ctz (bits)
+#endif
+
+
+//
+// R_FindColumn
+// First column from x on that is solid, or open if
+//  solid is false. limit if none is before limit.
+//
+static int
+R_FindColumn
+( int		x,
+  int		limit,
+  boolean	solid )
+{
+    unsigned	flip;
+    unsigned	bits;
+    int		word;
+
+    flip = solid ? 0 : ~0u;
+    word = x>>5;
+    bits = (solidcols[word]^flip) & (~0u << (x&31));
+
+    while (!bits)
+    {
+	if (++word<<5 >= limit)
+	    return limit;
+	bits = solidcols[word]^flip;
+    }
+
+    x = (word<<5) + R_LowestBit (bits);
+    return x < limit ? x : limit;
+}
+
+
+//
+// R_MarkSolid
+// Sets the bits of first to last.
+//
+static void
+R_MarkSolid
+( int		first,
+  int		last )
+{
+    unsigned	mask;
+    int		word;
+
+    for (word=first>>5 ; word<=last>>5 ; word++)
+    {
+	mask = ~0u;
+	if (word == first>>5)
+	    mask &= ~0u << (first&31);
+	if (word == last>>5)
+	    mask &= ~0u >> (31-(last&31));
+	solidcols[word] |= mask;
+    }
+}
 
 
-#define MAXSEGS		32
+//
+// R_ClipWallSegment
+// Stores every open run of columns in first to last,
+//  in order. Returns how many columns that was.
+//
+static int
+R_ClipWallSegment
+( int		first,
+  int		last )
+{
+    int		x;
+    int		end;
+    int		count;
 
-// newend is one past the last valid seg
-cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+    count = 0;
+    x = first;
 
+    for (;;)
+    {
+	x = R_FindColumn (x, last+1, false);
+	if (x > last)
+	    break;
+	end = R_FindColumn (x, last+1, true);
+	R_StoreWallRange (x, end-1);
+	count += end-x;
+	x = end;
+    }
 
+    return count;
+}
 
 
 //
@@ -105,83 +266,14 @@ R_ClipSolidWallSegment
 ( int			first,
   int			last )
 {
-    cliprange_t*	next;
-    cliprange_t*	start;
-
-    // Find the first range that touches the range
-    //  (adjacent pixels are touching).
-    start = solidsegs;
-    while (start->last < first-1)
-	start++;
-
-    if (first < start->first)
-    {
-	if (last < start->first-1)
-	{
-	    // Post is entirely visible (above start),
-	    //  so insert a new clippost.
-	    R_StoreWallRange (first, last);
-	    next = newend;
-	    newend++;
-	    
-	    while (next != start)
-	    {
-		*next = *(next-1);
-		next--;
-	    }
-	    next->first = first;
-	    next->last = last;
-	    return;
-	}
-		
-	// There is a fragment above *start.
-	R_StoreWallRange (first, start->first - 1);
-	// Now adjust the clip size.
-	start->first = first;	
-    }
-
-    // Bottom contained in start?
-    if (last <= start->last)
-	return;			
-		
-    next = start;
-    while (last >= (next+1)->first-1)
-    {
-	// There is a fragment between two posts.
-	R_StoreWallRange (next->last + 1, (next+1)->first - 1);
-	next++;
-	
-	if (last <= next->last)
-	{
-	    // Bottom is contained in next.
-	    // Adjust the clip size.
-	    start->last = next->last;	
-	    goto crunch;
-	}
-    }
-	
-    // There is a fragment after *next.
-    R_StoreWallRange (next->last + 1, last);
-    // Adjust the clip size.
-    start->last = last;
-	
-    // Remove start+1 to next from the clip list,
-    // because start now covers their area.
-  crunch:
-    if (next == start)
-    {
-	// Post just extended past the bottom of one post.
-	return;
-    }
-    
+    int		count;
 
-    while (next++ != newend)
+    count = R_ClipWallSegment (first, last);
+    if (count)
     {
-	// Remove a post.
-	*++start = *next;
+	R_MarkSolid (first, last);
+	opencolumns -= count;
     }
-
-    newend = start+1;
 }
 
 
@@ -198,43 +290,30 @@ R_ClipPassWallSegment
 ( int	first,
   int	last )
 {
-    cliprange_t*	start;
+    R_ClipWallSegment (first, last);
+}
 
-    // Find the first range that touches the range
-    //  (adjacent pixels are touching).
-    start = solidsegs;
-    while (start->last < first-1)
-	start++;
 
-    if (first < start->first)
-    {
-	if (last < start->first-1)
-	{
-	    // Post is entirely visible (above start).
-	    R_StoreWallRange (first, last);
-	    return;
-	}
-		
-	// There is a fragment above *start.
-	R_StoreWallRange (first, start->first - 1);
-    }
 
-    // Bottom contained in start?
-    if (last <= start->last)
-	return;			
-		
-    while (last >= (start+1)->first-1)
+//
+// Per frame cache of R_PointToAngle for vertexes,
+//  as each one is shared by several segs.
+//
+THREADLOCAL angle_t*	vertexangles;
+THREADLOCAL int*	vertexangleframes;
+THREADLOCAL int		numvertexangles;
+
+static angle_t R_VertexAngle (vertex_t* v)
+{
+    int		i;
+
+    i = v - vertexes;
+    if (vertexangleframes[i] != framecount)
     {
-	// There is a fragment between two posts.
-	R_StoreWallRange (start->last + 1, (start+1)->first - 1);
-	start++;
-	
-	if (last <= start->last)
-	    return;
+	vertexangleframes[i] = framecount;
+	vertexangles[i] = R_PointToAngle (v->x, v->y);
     }
-	
-    // There is a fragment after *next.
-    R_StoreWallRange (start->last + 1, last);
+    return vertexangles[i];
 }
 
 
@@ -244,11 +323,28 @@ R_ClipPassWallSegment
 //
 void R_ClearClipSegs (void)
 {
-    solidsegs[0].first = -0x7fffffff;
-    solidsegs[0].last = -1;
-    solidsegs[1].first = viewwidth;
-    solidsegs[1].last = 0x7fffffff;
-    newend = solidsegs+2;
+    // Everything outside this thread's strip
+    //  starts out as solid.
+    memset (solidcols, 0, sizeof(solidcols));
+    if (stripstart > 0)
+	R_MarkSolid (0, stripstart-1);
+    if (stripend < SOLIDWORDS*32)
+	R_MarkSolid (stripend, SOLIDWORDS*32-1);
+    opencolumns = stripend - stripstart;
+
+    if (numvertexangles < numvertexes)
+    {
+	numvertexangles = numvertexes;
+	vertexangles = realloc (vertexangles,
+				numvertexes*sizeof(*vertexangles));
+	vertexangleframes = realloc (vertexangleframes,
+				     numvertexes*sizeof(*vertexangleframes));
+	if (!vertexangles || !vertexangleframes)
+	    I_Error ("R_ClearClipSegs: no memory for %i vertexes",
+		     numvertexes);
+	memset (vertexangleframes, 0xff,
+		numvertexes*sizeof(*vertexangleframes));
+    }
 }
 
 //
@@ -268,8 +364,8 @@ void R_AddLine (seg_t*	line)
     curline = line;
 
     // OPTIMIZE: quickly reject orthogonal back sides.
-    angle1 = R_PointToAngle (line->v1->x, line->v1->y);
-    angle2 = R_PointToAngle (line->v2->x, line->v2->y);
+    angle1 = R_VertexAngle (line->v1);
+    angle2 = R_VertexAngle (line->v2);
     
     // Clip to view edges.
     // OPTIMIZE: make constant out of 2*clipangle (FIELDOFVIEW).
@@ -394,8 +490,6 @@ boolean R_CheckBBox (fixed_t*	bspcoord)
     angle_t		span;
     angle_t		tspan;
     
-    cliprange_t*	start;
-
     int			sx1;
     int			sx2;
     
@@ -471,19 +565,9 @@ boolean R_CheckBBox (fixed_t*	bspcoord)
     if (sx1 == sx2)
 	return false;			
     sx2--;
-	
-    start = solidsegs;
-    while (start->last < sx2)
-	start++;
-    
-    if (sx1 >= start->first
-	&& sx2 <= start->last)
-    {
-	// The clippost contains the new span.
-	return false;
-    }
 
-    return true;
+    // Any open column in the span?
+    return R_FindColumn (sx1, sx2+1, false) <= sx2;
 }
 
 
@@ -512,6 +596,7 @@ void R_Subsector (int num)
     frontsector = sub->sector;
     count = sub->numlines;
     line = &segs[sub->firstline];
+    R_DrawnSubsector (num);
 
     if (frontsector->floorheight < viewz)
     {
@@ -554,15 +639,23 @@ void R_RenderBSPNode (int bspnum)
     node_t*	bsp;
     int		side;
 
+    // Solid walls cover the whole strip already?
+    if (!opencolumns)
+	return;
+
     // Found a subsector?
     if (bspnum & NF_SUBSECTOR)
     {
 	if (bspnum == -1)			
 	    R_Subsector (0);
-	else
+	else if (!pvsactive || R_PVSSubsector (bspnum&(~NF_SUBSECTOR)))
 	    R_Subsector (bspnum&(~NF_SUBSECTOR));
 	return;
     }
+
+    // Nothing down here can be seen from the view subsector.
+    if (pvsactive && !pvsnodes[bspnum])
+	return;
 		
     bsp = &nodes[bspnum];
     
@@ -28,25 +28,25 @@
 #endif
 
 
-extern seg_t*		curline;
-extern side_t*		sidedef;
-extern line_t*		linedef;
-extern sector_t*	frontsector;
-extern sector_t*	backsector;
+extern THREADLOCAL seg_t*		curline;
+extern THREADLOCAL side_t*		sidedef;
+extern THREADLOCAL line_t*		linedef;
+extern THREADLOCAL sector_t*	frontsector;
+extern THREADLOCAL sector_t*	backsector;
 
-extern int		rw_x;
-extern int		rw_stopx;
+extern THREADLOCAL int		rw_x;
+extern THREADLOCAL int		rw_stopx;
 
-extern boolean		segtextured;
+extern THREADLOCAL boolean		segtextured;
 
 // false if the back side is the same plane
-extern boolean		markfloor;		
-extern boolean		markceiling;
+extern THREADLOCAL boolean		markfloor;		
+extern THREADLOCAL boolean		markceiling;
 
 extern boolean		skymap;
 
-extern drawseg_t	drawsegs[MAXDRAWSEGS];
-extern drawseg_t*	ds_p;
+extern THREADLOCAL drawseg_t*	drawsegs;
+extern THREADLOCAL drawseg_t*	ds_p;
 
 extern lighttable_t**	hscalelight;
 extern lighttable_t**	vscalelight;
@@ -59,6 +59,12 @@ typedef void (*drawfunc_t) (int start, int stop);
 // BSP?
 void R_ClearClipSegs (void);
 void R_ClearDrawSegs (void);
+void R_CheckDrawSegs (void);
+
+// Each strip publishes its drawsegs when its walls are done,
+//  then R_MapDrawnLines flags their lines ML_MAPPED.
+void R_PublishDrawSegs (int strip);
+void R_MapDrawnLines (int strips);
 
 
 void R_RenderBSPNode (int bspnum);
@@ -0,0 +1,412 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Frame capture. A capture is text, a keyword and its
+//	 values per line: the map and view, the player's
+//	 weapon and powers, then one line per sector, side,
+//	 texture and flat translation, and thing, as drawn.
+//	Sectors and things are written where they were drawn
+//	 that frame, so a replay needs no interpolation.
+//
+//-----------------------------------------------------------------------------
+
+
+static const char
+rcsid[] = "$Id:$";
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+
+#include "z_zone.h"
+#include "i_system.h"
+#include "w_wad.h"
+#include "p_local.h"
+
+#include "r_local.h"
+#include "r_sky.h"
+
+#ifdef __GNUG__
+#pragma implementation "r_capture.h"
+#endif
+#include "r_capture.h"
+
+
+#define CAPTUREVERSION	1
+
+// values per line of each section
+#define PSPRITEFIELDS	3
+#define SECTORFIELDS	5
+#define SIDEFIELDS	5
+#define THINGFIELDS	7
+
+int			capturetic = -1;
+
+// from r_data.c
+extern int		numtextures;
+extern int		numflats;
+
+// The capture being read, from R_ReadCapture
+//  to R_ApplyCapture.
+static capture_t	capture;
+static FILE*		capfile;
+static char*		capname;
+
+static int		capextralight;
+static int		capfixedcolormap;
+static int		capinvisibility;
+static int		capsky;
+
+static int*		cappsprites;
+static int*		capsectors;
+static int		capnumsectors;
+static int*		capsides;
+static int		capnumsides;
+static int*		captextures;
+static int*		capflats;
+static int*		capthings;
+static int		capnumthings;
+
+
+
+//
+// R_CaptureFrame
+//
+void R_CaptureFrame (void)
+{
+    char	name[32];
+    FILE*	f;
+    sector_t*	sec;
+    side_t*	side;
+    mobj_t*	thing;
+    pspdef_t*	psp;
+    fixed_t	x;
+    fixed_t	y;
+    fixed_t	z;
+    int		count;
+    int		i;
+
+    // only the first frame of the tic
+    capturetic = -1;
+
+    sprintf (name, "CAP%05i.frm", gametic);
+    f = fopen (name, "w");
+    if (!f)
+	I_Error ("R_CaptureFrame: couldn't create %s", name);
+
+    fprintf (f, "DOOMCAPTURE %i\n", CAPTUREVERSION);
+    fprintf (f, "lumps %i\n", numlumps);
+    fprintf (f, "map %i %i\n", gameepisode, gamemap);
+    fprintf (f, "view %i %i %i %i\n", viewx, viewy, viewz, (int)viewangle);
+    fprintf (f, "window %i %i %i %i\n",
+	     viewwindowwidth, viewwindowheight, detailshift, renderscale);
+    fprintf (f, "player %i %i %i\n", viewplayer->extralight,
+	     viewplayer->fixedcolormap, viewplayer->powers[pw_invisibility]);
+    fprintf (f, "sky %i\n", skytexture);
+
+    fprintf (f, "psprites %i\n", NUMPSPRITES);
+    for (i=0, psp=viewplayer->psprites ; i<NUMPSPRITES ; i++, psp++)
+	fprintf (f, "%i %i %i\n", psp->state ? (int)(psp->state - states) : -1,
+		 psp->sx, psp->sy);
+
+    fprintf (f, "sectors %i\n", numsectors);
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+	fprintf (f, "%i %i %i %i %i\n", sec->floorheight, sec->ceilingheight,
+		 sec->floorpic, sec->ceilingpic, sec->lightlevel);
+
+    fprintf (f, "sides %i\n", numsides);
+    for (i=0, side=sides ; i<numsides ; i++, side++)
+	fprintf (f, "%i %i %i %i %i\n", side->textureoffset, side->rowoffset,
+		 side->toptexture, side->midtexture, side->bottomtexture);
+
+    fprintf (f, "textures %i\n", numtextures);
+    for (i=0 ; i<numtextures ; i++)
+	fprintf (f, "%i\n", texturetranslation[i]);
+
+    fprintf (f, "flats %i\n", numflats);
+    for (i=0 ; i<numflats ; i++)
+	fprintf (f, "%i\n", flattranslation[i]);
+
+    // the things the refresh can find, in the sectors
+    count = 0;
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+	for (thing = sec->thinglist ; thing ; thing = thing->snext)
+	    count++;
+
+    fprintf (f, "things %i\n", count);
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	for (thing = sec->thinglist ; thing ; thing = thing->snext)
+	{
+	    // as R_ProjectSprite has it
+	    if (fractionaltic < FRACUNIT)
+	    {
+		x = R_Interpolate (thing->oldx, thing->x);
+		y = R_Interpolate (thing->oldy, thing->y);
+		z = R_Interpolate (thing->oldz, thing->z);
+	    }
+	    else
+	    {
+		x = thing->x;
+		y = thing->y;
+		z = thing->z;
+	    }
+	    fprintf (f, "%i %i %i %i %i %i %i\n", x, y, z, (int)thing->angle,
+		     thing->sprite, thing->frame, thing->flags);
+	}
+    }
+
+    if (fclose (f))
+	I_Error ("R_CaptureFrame: couldn't write %s", name);
+
+    printf ("R_CaptureFrame: tic %i written to %s\n", gametic, name);
+}
+
+
+
+//
+// R_ReadWord
+//
+static void R_ReadWord (char* word)
+{
+    char	read[32];
+
+    if (fscanf (capfile, "%31s", read) != 1 || strcmp (read, word))
+	I_Error ("R_ReadCapture: %s has no %s where expected", capname, word);
+}
+
+
+//
+// R_ReadInt
+//
+static int R_ReadInt (void)
+{
+    int		value;
+
+    if (fscanf (capfile, "%d", &value) != 1)
+	I_Error ("R_ReadCapture: %s is cut short", capname);
+    return value;
+}
+
+
+//
+// R_ReadSection
+// A keyword with a count, then count lines of
+//  fields values each.
+//
+static int*
+R_ReadSection
+( char*		word,
+  int		fields,
+  int*		count )
+{
+    int*	values;
+    int		i;
+
+    R_ReadWord (word);
+    *count = R_ReadInt ();
+    if (*count < 0)
+	I_Error ("R_ReadCapture: %i %s in %s", *count, word, capname);
+
+    values = malloc ((*count*fields + 1)*sizeof(*values));
+    if (!values)
+	I_Error ("R_ReadCapture: no memory for %i %s", *count, word);
+
+    for (i=0 ; i<*count*fields ; i++)
+	values[i] = R_ReadInt ();
+
+    return values;
+}
+
+
+//
+// R_ReadCapture
+//
+capture_t* R_ReadCapture (char* name)
+{
+    int		count;
+
+    capname = name;
+    capfile = fopen (name, "r");
+    if (!capfile)
+	I_Error ("R_ReadCapture: couldn't open %s", name);
+
+    R_ReadWord ("DOOMCAPTURE");
+    if (R_ReadInt () != CAPTUREVERSION)
+	I_Error ("R_ReadCapture: %s is not version %i", name, CAPTUREVERSION);
+
+    R_ReadWord ("lumps");
+    count = R_ReadInt ();
+    if (count != numlumps)
+	I_Error ("R_ReadCapture: %s was captured with %i lumps, "
+		 "these wads have %i", name, count, numlumps);
+
+    R_ReadWord ("map");
+    capture.episode = R_ReadInt ();
+    capture.map = R_ReadInt ();
+
+    R_ReadWord ("view");
+    capture.viewx = R_ReadInt ();
+    capture.viewy = R_ReadInt ();
+    capture.viewz = R_ReadInt ();
+    capture.viewangle = (angle_t)R_ReadInt ();
+
+    R_ReadWord ("window");
+    capture.width = R_ReadInt ();
+    capture.height = R_ReadInt ();
+    capture.detail = R_ReadInt ();
+    capture.scale = R_ReadInt ();
+
+    R_ReadWord ("player");
+    capextralight = R_ReadInt ();
+    capfixedcolormap = R_ReadInt ();
+    capinvisibility = R_ReadInt ();
+
+    R_ReadWord ("sky");
+    capsky = R_ReadInt ();
+    if ((unsigned)capsky >= (unsigned)numtextures)
+	I_Error ("R_ReadCapture: bad sky texture %i", capsky);
+
+    free (cappsprites);
+    cappsprites = R_ReadSection ("psprites", PSPRITEFIELDS, &count);
+    if (count != NUMPSPRITES)
+	I_Error ("R_ReadCapture: %i psprites in %s", count, name);
+
+    free (capsectors);
+    capsectors = R_ReadSection ("sectors", SECTORFIELDS, &capnumsectors);
+    free (capsides);
+    capsides = R_ReadSection ("sides", SIDEFIELDS, &capnumsides);
+
+    free (captextures);
+    captextures = R_ReadSection ("textures", 1, &count);
+    if (count != numtextures)
+	I_Error ("R_ReadCapture: %i textures in %s", count, name);
+
+    free (capflats);
+    capflats = R_ReadSection ("flats", 1, &count);
+    if (count != numflats)
+	I_Error ("R_ReadCapture: %i flats in %s", count, name);
+
+    free (capthings);
+    capthings = R_ReadSection ("things", THINGFIELDS, &capnumthings);
+
+    fclose (capfile);
+    return &capture;
+}
+
+
+//
+// R_ApplyCapture
+//
+void R_ApplyCapture (player_t* player)
+{
+    thinker_t*	th;
+    sector_t*	sec;
+    side_t*	side;
+    mobj_t*	thing;
+    pspdef_t*	psp;
+    int*	v;
+    int		i;
+
+    if (capnumsectors != numsectors || capnumsides != numsides)
+	I_Error ("R_ApplyCapture: %s has %i sectors and %i sides, "
+		 "the map %i and %i", capname, capnumsectors, capnumsides,
+		 numsectors, numsides);
+
+    for (i=0, sec=sectors, v=capsectors ; i<numsectors ; i++, sec++)
+    {
+	sec->floorheight = sec->oldfloorheight = *v++;
+	sec->ceilingheight = sec->oldceilingheight = *v++;
+	sec->floorpic = *v++;
+	sec->ceilingpic = *v++;
+	sec->lightlevel = *v++;
+	if ((unsigned)sec->floorpic >= (unsigned)numflats
+	    || (unsigned)sec->ceilingpic >= (unsigned)numflats)
+	    I_Error ("R_ApplyCapture: bad flat in sector %i", i);
+    }
+
+    for (i=0, side=sides, v=capsides ; i<numsides ; i++, side++)
+    {
+	side->textureoffset = *v++;
+	side->rowoffset = *v++;
+	side->toptexture = *v++;
+	side->midtexture = *v++;
+	side->bottomtexture = *v++;
+	if ((unsigned)side->toptexture >= (unsigned)numtextures
+	    || (unsigned)side->midtexture >= (unsigned)numtextures
+	    || (unsigned)side->bottomtexture >= (unsigned)numtextures)
+	    I_Error ("R_ApplyCapture: bad texture on side %i", i);
+    }
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if ((unsigned)captextures[i] >= (unsigned)numtextures)
+	    I_Error ("R_ApplyCapture: bad translation of texture %i", i);
+	texturetranslation[i] = captextures[i];
+    }
+    for (i=0 ; i<numflats ; i++)
+    {
+	if ((unsigned)capflats[i] >= (unsigned)numflats)
+	    I_Error ("R_ApplyCapture: bad translation of flat %i", i);
+	flattranslation[i] = capflats[i];
+    }
+
+    skytexture = capsky;
+
+    // the things the map started with make way
+    //  for the ones captured
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+	    P_UnsetThingPosition ((mobj_t *)th);
+
+    for (i=0, v=capthings ; i<capnumthings ; i++)
+    {
+	thing = Z_Malloc (sizeof(*thing), PU_LEVEL, NULL);
+	memset (thing, 0, sizeof(*thing));
+	thing->x = thing->oldx = *v++;
+	thing->y = thing->oldy = *v++;
+	thing->z = thing->oldz = *v++;
+	thing->angle = thing->oldangle = (angle_t)*v++;
+	thing->sprite = *v++;
+	thing->frame = *v++;
+	thing->flags = *v++ | MF_NOBLOCKMAP;
+	if ((unsigned)thing->sprite >= NUMSPRITES)
+	    I_Error ("R_ApplyCapture: bad sprite on thing %i", i);
+
+	// never think, only drawn
+	P_SetThingPosition (thing);
+    }
+
+    player->extralight = capextralight;
+    player->fixedcolormap = capfixedcolormap;
+    player->powers[pw_invisibility] = capinvisibility;
+
+    for (i=0, psp=player->psprites, v=cappsprites ; i<NUMPSPRITES ; i++, psp++)
+    {
+	if (*v >= NUMSTATES)
+	    I_Error ("R_ApplyCapture: bad psprite state %i", *v);
+	psp->state = *v < 0 ? NULL : &states[*v];
+	v++;
+	psp->sx = *v++;
+	psp->sy = *v++;
+    }
+}
@@ -0,0 +1,80 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Capture of everything the refresh reads for one
+//	 frame, so that it can be drawn again on its own.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __R_CAPTURE__
+#define __R_CAPTURE__
+
+#include "d_player.h"
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+//
+// What a replay needs to know before the
+//  level can be put back: the map, and the
+//  view the frame was drawn from.
+//
+typedef struct
+{
+    int		episode;
+    int		map;
+
+    fixed_t	viewx;
+    fixed_t	viewy;
+    fixed_t	viewz;
+    angle_t	viewangle;
+
+    // the view window, and how it was drawn in it
+    int		width;
+    int		height;
+    int		detail;
+    int		scale;
+
+} capture_t;
+
+
+// -capture <tic> writes CAPnnnnn.frm for the first
+//  frame drawn at that tic, -1 if none.
+extern int		capturetic;
+
+// Called by R_RenderPlayerView once the frame is set up.
+void R_CaptureFrame (void);
+
+// Reads a capture for a replay, once the wads
+//  are loaded.
+capture_t* R_ReadCapture (char* name);
+
+// Then, with the map loaded, puts the sectors, sides,
+//  animations and things back as they were, and the
+//  player's weapon and powers into player.
+void R_ApplyCapture (player_t* player);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -28,9 +28,12 @@ static const char
 rcsid[] = "$Id: r_data.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
 #include <stdint.h>
+#include <stdlib.h>
 #include "i_system.h"
+#include "i_thread.h"
 #include "z_zone.h"
 
+#include "m_argv.h"
 #include "m_swap.h"
 
 #include "w_wad.h"
@@ -391,6 +394,347 @@ void R_GenerateLookup (int texnum)
 
 
 
+//
+// CACHE PINNING
+// The render threads share the zone. A thread may
+//  only cache a lump or composite while holding the
+//  lock, and anything it got back stays PU_STATIC
+//  until the frame is done, so no other thread can
+//  purge it while it is still being drawn from.
+//
+typedef struct
+{
+    void*	ptr;
+    int		tag;	// to restore when released
+    
+} cachepin_t;
+
+boolean		pinningcache;
+int		pinframe;
+int*		lumppinframe;
+int*		texturepinframe;
+
+cachepin_t*	cachepins;
+int		numcachepins;
+int		maxcachepins;
+
+
+//
+// R_PinBlock
+// Keeps a purgable zone block from being purged.
+// Called with the lock held.
+//
+void R_PinBlock (void* ptr)
+{
+    memblock_t*	block;
+
+    block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
+    if (block->tag < PU_PURGELEVEL)
+	return;
+
+    if (numcachepins == maxcachepins)
+    {
+	maxcachepins = maxcachepins ? maxcachepins*2 : 256;
+	cachepins = realloc (cachepins, maxcachepins*sizeof(*cachepins));
+	if (!cachepins)
+	    I_Error ("R_PinBlock: no memory for %i pins", maxcachepins);
+    }
+
+    cachepins[numcachepins].ptr = ptr;
+    cachepins[numcachepins].tag = block->tag;
+    numcachepins++;
+    
+    Z_ChangeTag2 (ptr, PU_STATIC);
+}
+
+
+//
+// R_StartCachePins
+//
+void R_StartCachePins (void)
+{
+    if (!lumppinframe)
+    {
+	lumppinframe = Z_Malloc (numlumps*sizeof(*lumppinframe), PU_STATIC, 0);
+	memset (lumppinframe, 0, numlumps*sizeof(*lumppinframe));
+	texturepinframe = Z_Malloc (numtextures*sizeof(*texturepinframe), PU_STATIC, 0);
+	memset (texturepinframe, 0, numtextures*sizeof(*texturepinframe));
+    }
+
+    pinframe++;
+    pinningcache = true;
+}
+
+
+//
+// R_ReleaseCachePins
+// Everything pinned goes back to its old tag.
+//
+void R_ReleaseCachePins (void)
+{
+    int		i;
+
+    for (i=0 ; i<numcachepins ; i++)
+	Z_ChangeTag2 (cachepins[i].ptr, cachepins[i].tag);
+    
+    numcachepins = 0;
+    pinningcache = false;
+}
+
+
+//
+// R_CacheLumpNum
+// W_CacheLumpNum (lump, PU_CACHE) for the refresh.
+//
+void* R_CacheLumpNum (int lump)
+{
+    void*	ptr;
+
+    if (!pinningcache)
+	return W_CacheLumpNum (lump, PU_CACHE);
+
+    // Pinned by one of the strips already, so it can
+    //  not move until the frame is done. The frame is
+    //  stored after the pointer, so the pointer is seen.
+    if (I_LoadAcquire (&lumppinframe[lump]) == pinframe)
+	return lumpcache[lump];
+
+    I_Lock ();
+    if (lumppinframe[lump] == pinframe)
+	ptr = lumpcache[lump];
+    else
+    {
+	ptr = W_CacheLumpNum (lump, PU_CACHE);
+	R_PinBlock (ptr);
+	I_StoreRelease (&lumppinframe[lump], pinframe);
+    }
+    I_Unlock ();
+
+    return ptr;
+}
+
+
+//
+// R_PinComposite
+// Composite textures are generated and pinned
+//  under the lock as well.
+//
+void R_PinComposite (int tex)
+{
+    I_Lock ();
+    if (texturepinframe[tex] != pinframe)
+    {
+	if (!texturecomposite[tex])
+	    R_GenerateComposite (tex);
+	if (texturecomposite[tex])
+	{
+	    R_PinBlock (texturecomposite[tex]);
+	    I_StoreRelease (&texturepinframe[tex], pinframe);
+	}
+    }
+    I_Unlock ();
+}
+
+
+
+//
+// COLUMN STORE
+// Every wall texture the level uses is composited on
+//  level load, column after column, into one block,
+//  with a pointer to each column, so the refresh never
+//  builds a composite or caches a patch for a wall.
+// The textures are shared out between the worker
+//  threads. Only the main thread may use the zone, so
+//  the patches are all cached and pinned beforehand.
+// A texture the level never showed at load time still
+//  takes the composite path above.
+//
+byte***		texturecolumns;	// NULL if not in the store
+
+static byte*	columnstore;
+static byte**	storecolumns;
+static int*	storetextures;
+static int	numstoretextures;
+static int	storethreads;
+
+// The column drawers read past the end of a column
+//  on tall walls, and masked columns of more than
+//  one patch are looked at 3 bytes before the start.
+#define STORELEADPAD	16
+#define STORETAILPAD	0x10000
+
+
+//
+// R_MarkLevelTextures
+// Sets present[] for every texture on the level's
+//  sides, the sky, and whatever animations and
+//  switches turn those into.
+//
+void R_MarkLevelTextures (byte* present)
+{
+    int		i;
+
+    memset (present, 0, numtextures);
+
+    for (i=0 ; i<numsides ; i++)
+    {
+	present[sides[i].toptexture] = 1;
+	present[sides[i].midtexture] = 1;
+	present[sides[i].bottomtexture] = 1;
+    }
+
+    // Sky texture is always present.
+    // Note that F_SKY1 is the name used to
+    //  indicate a sky floor/ceiling as a flat,
+    //  while the sky texture is stored like
+    //  a wall texture, with an episode dependend
+    //  name.
+    present[skytexture] = 1;
+
+    P_MarkSwitchTextures (present);
+    P_MarkAnimatedTextures (present);
+}
+
+
+//
+// R_CompositeTexture
+// Draws all the patches of a texture
+//  into its columns in the store.
+//
+static void R_CompositeTexture (int texnum)
+{
+    texture_t*		texture;
+    texpatch_t*		patch;
+    patch_t*		realpatch;
+    column_t*		patchcol;
+    byte**		columns;
+    int			x;
+    int			x1;
+    int			x2;
+    int			i;
+
+    texture = textures[texnum];
+    columns = texturecolumns[texnum];
+
+    for (i=0 , patch = texture->patches;
+	 i<texture->patchcount;
+	 i++, patch++)
+    {
+	// Pinned by R_BuildColumnStore.
+	realpatch = lumpcache[patch->patch];
+	x1 = patch->originx;
+	x2 = x1 + SHORT(realpatch->width);
+
+	if (x1<0)
+	    x = 0;
+	else
+	    x = x1;
+
+	if (x2 > texture->width)
+	    x2 = texture->width;
+
+	for ( ; x<x2 ; x++)
+	{
+	    patchcol = (column_t *)((byte *)realpatch
+				    + LONG(realpatch->columnofs[x-x1]));
+	    R_DrawColumnInCache (patchcol,
+				 columns[x],
+				 patch->originy,
+				 texture->height);
+	}
+    }
+}
+
+
+//
+// R_StoreThread
+//
+static void R_StoreThread (int thread)
+{
+    int		i;
+
+    for (i=thread ; i<numstoretextures ; i+=storethreads)
+	R_CompositeTexture (storetextures[i]);
+}
+
+
+//
+// R_BuildColumnStore
+// Called by P_SetupLevel, every level.
+//
+void R_BuildColumnStore (void)
+{
+    byte*	present;
+    byte*	data;
+    texture_t*	texture;
+    int		starttime;
+    int		numcolumns;
+    int		size;
+    int		i;
+    int		j;
+    int		x;
+
+    starttime = I_GetTimeMS ();
+
+    free (columnstore);
+    free (storecolumns);
+    free (storetextures);
+    memset (texturecolumns, 0, numtextures*sizeof(*texturecolumns));
+
+    present = alloca (numtextures);
+    R_MarkLevelTextures (present);
+
+    storetextures = malloc (numtextures*sizeof(*storetextures));
+    if (!storetextures)
+	I_Error ("R_BuildColumnStore: no memory");
+
+    // Size it all up first, for a single block.
+    numstoretextures = 0;
+    numcolumns = 0;
+    size = 0;
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if (!present[i])
+	    continue;
+	storetextures[numstoretextures++] = i;
+	numcolumns += textures[i]->width;
+	size += textures[i]->width * textures[i]->height;
+    }
+
+    columnstore = malloc (STORELEADPAD + size + STORETAILPAD);
+    storecolumns = malloc (numcolumns*sizeof(*storecolumns));
+    if (!columnstore || !storecolumns)
+	I_Error ("R_BuildColumnStore: no memory for %i bytes", size);
+
+    // Parts of a column no patch covers come out black,
+    //  not whatever was in memory.
+    memset (columnstore, 0, STORELEADPAD + size + STORETAILPAD);
+
+    data = columnstore + STORELEADPAD;
+    numcolumns = 0;
+    for (i=0 ; i<numstoretextures ; i++)
+    {
+	texture = textures[storetextures[i]];
+	texturecolumns[storetextures[i]] = storecolumns + numcolumns;
+	for (x=0 ; x<texture->width ; x++, data += texture->height)
+	    storecolumns[numcolumns++] = data;
+
+	for (j=0 ; j<texture->patchcount ; j++)
+	    R_PinBlock (W_CacheLumpNum (texture->patches[j].patch, PU_CACHE));
+    }
+
+    storethreads = I_NumThreads ();
+    I_RunParallel (R_StoreThread, storethreads);
+    R_ReleaseCachePins ();
+
+    printf ("R_BuildColumnStore: %i bytes for %i textures in %i ms\n",
+	    STORELEADPAD + size + STORETAILPAD
+	    + numcolumns*(int)sizeof(*storecolumns),
+	    numstoretextures, I_GetTimeMS () - starttime);
+}
+
+
+
 //
 // R_GetColumn
 //
@@ -409,14 +753,20 @@ R_GetColumn
         return dummy_column;
     }
     col &= texturewidthmask[tex];
+    if (texturecolumns[tex])
+        return texturecolumns[tex][col];
     lump = texturecolumnlump[tex][col];
     ofs = texturecolumnofs[tex][col];
     if (lump > 0) {
-        byte* p = (byte *)W_CacheLumpNum(lump, PU_CACHE);
+        byte* p = (byte *)R_CacheLumpNum(lump);
         if (!p) return dummy_column;
         return p + ofs;
     }
-    if (!texturecomposite[tex])
+    if (pinningcache) {
+        if (I_LoadAcquire(&texturepinframe[tex]) != pinframe)
+            R_PinComposite(tex);
+    }
+    else if (!texturecomposite[tex])
         R_GenerateComposite(tex);
     if (!texturecomposite[tex])
         return dummy_column;
@@ -424,6 +774,821 @@ R_GetColumn
 }
 
 
+//
+// COMPILED PATCHES
+// Patch lumps, and the mid textures drawn masked, are
+//  compiled to cpatch_t (see r_defs.h) on first use,
+//  into purgable zone blocks. Besides what the zone
+//  purges, they are kept to a budget of their own,
+//  -patchcache kb, by freeing the unpinned ones when
+//  a new one does not fit. They are pinned the same
+//  way lumps are, see R_CacheLumpNum.
+//
+#define PATCHCACHESIZE	(4*1024*1024)
+
+// Lumps first, then textures, then one slot
+//  for a patch that is not a cached lump.
+static cpatch_t**	cpatches;
+static int*		cpatchsize;
+static int*		cpatchpinframe;
+static int		numcpatches;
+static int		cpatchmemory;
+static int		cpatchbudget;
+static int		cpatchhand;
+
+// Where the patch being compiled is put together.
+static int*		compilecolumns;
+static cpost_t*		compileposts;
+static byte*		compilepixels;
+static int		maxcompilecolumns;
+static int		maxcompileposts;
+static int		maxcompilepixels;
+static int		numcompileposts;
+static int		numcompilepixels;
+
+
+//
+// R_InitPatchCache
+//
+void R_InitPatchCache (void)
+{
+    int		p;
+
+    numcpatches = numlumps + numtextures + 1;
+    cpatches = calloc (numcpatches, sizeof(*cpatches));
+    cpatchsize = calloc (numcpatches, sizeof(*cpatchsize));
+    cpatchpinframe = calloc (numcpatches, sizeof(*cpatchpinframe));
+    if (!cpatches || !cpatchsize || !cpatchpinframe)
+	I_Error ("R_InitPatchCache: no memory");
+
+    cpatchbudget = PATCHCACHESIZE;
+    p = M_CheckParm ("-patchcache");
+    if (p && p < myargc-1)
+	cpatchbudget = atoi (myargv[p+1])*1024;
+}
+
+
+//
+// R_StartCompile
+//
+static void R_StartCompile (int width)
+{
+    if (width+1 > maxcompilecolumns)
+    {
+	maxcompilecolumns = width+1;
+	compilecolumns = realloc (compilecolumns,
+				  maxcompilecolumns*sizeof(*compilecolumns));
+	if (!compilecolumns)
+	    I_Error ("R_StartCompile: no memory for %i columns", width);
+    }
+
+    numcompileposts = 0;
+    numcompilepixels = 0;
+}
+
+
+//
+// R_AddCompiledRun
+// Adds length texels from source, at row top, to the
+//  column whose posts start at firstpost. A run right
+//  below the last one is merged into it. The texels
+//  either side of source become the pads.
+//
+static void
+R_AddCompiledRun
+( int		firstpost,
+  int		top,
+  int		length,
+  byte*		source )
+{
+    cpost_t*	post;
+
+    if (numcompilepixels + length + 2 > maxcompilepixels)
+    {
+	maxcompilepixels = 2*maxcompilepixels + length + 2;
+	compilepixels = realloc (compilepixels, maxcompilepixels);
+	if (!compilepixels)
+	    I_Error ("R_AddCompiledRun: no memory for %i texels",
+		     maxcompilepixels);
+    }
+    if (numcompileposts == maxcompileposts)
+    {
+	maxcompileposts = maxcompileposts ? maxcompileposts*2 : 256;
+	compileposts = realloc (compileposts,
+				maxcompileposts*sizeof(*compileposts));
+	if (!compileposts)
+	    I_Error ("R_AddCompiledRun: no memory for %i posts",
+		     maxcompileposts);
+    }
+
+    post = &compileposts[numcompileposts-1];
+    if (numcompileposts > firstpost
+	&& post->topdelta + post->length == top)
+    {
+	// over the pad after the last run
+	numcompilepixels--;
+	post->length += length;
+    }
+    else
+    {
+	post = &compileposts[numcompileposts++];
+	post->topdelta = top;
+	post->length = length;
+	compilepixels[numcompilepixels++] = source[-1];
+	post->offset = numcompilepixels;
+    }
+
+    memcpy (compilepixels + numcompilepixels, source, length);
+    numcompilepixels += length;
+    compilepixels[numcompilepixels++] = source[length];
+}
+
+
+//
+// R_TrimPatchCache
+// Frees compiled patches, going round from where it
+//  stopped the last time, until size more bytes fit.
+//
+static void R_TrimPatchCache (int size)
+{
+    memblock_t*	block;
+    int		i;
+
+    for (i=0 ; i<numcpatches && cpatchmemory+size > cpatchbudget ; i++)
+    {
+	if (++cpatchhand == numcpatches)
+	    cpatchhand = 0;
+
+	if (cpatches[cpatchhand])
+	{
+	    // Pinned for the frame.
+	    block = (memblock_t *)((byte *)cpatches[cpatchhand]
+				   - sizeof(memblock_t));
+	    if (block->tag < PU_PURGELEVEL)
+		continue;
+	    Z_Free (cpatches[cpatchhand]);
+	}
+
+	// Purged by the zone, if not by us.
+	cpatchmemory -= cpatchsize[cpatchhand];
+	cpatchsize[cpatchhand] = 0;
+    }
+}
+
+
+//
+// R_FinishCompile
+// Moves what was compiled into a
+//  zone block owned by cpatches[slot].
+//
+static void
+R_FinishCompile
+( int		slot,
+  int		width,
+  int		height,
+  int		leftoffset,
+  int		topoffset )
+{
+    cpatch_t*	patch;
+    int		size;
+
+    compilecolumns[width] = numcompileposts;
+
+    size = sizeof(cpatch_t)
+	+ (width+1)*sizeof(int)
+	+ numcompileposts*sizeof(cpost_t)
+	+ numcompilepixels;
+
+    cpatchmemory -= cpatchsize[slot];
+    cpatchsize[slot] = 0;
+    R_TrimPatchCache (size);
+
+    patch = Z_Malloc (size, PU_CACHE, &cpatches[slot]);
+    patch->width = width;
+    patch->height = height;
+    patch->leftoffset = leftoffset;
+    patch->topoffset = topoffset;
+    patch->columns = (int *)(patch+1);
+    patch->posts = (cpost_t *)(patch->columns + width+1);
+    patch->pixels = (byte *)(patch->posts + numcompileposts);
+
+    memcpy (patch->columns, compilecolumns, (width+1)*sizeof(int));
+    memcpy (patch->posts, compileposts, numcompileposts*sizeof(cpost_t));
+    memcpy (patch->pixels, compilepixels, numcompilepixels);
+
+    cpatchsize[slot] = size;
+    cpatchmemory += size;
+}
+
+
+//
+// R_CompilePatch
+//
+static void
+R_CompilePatch
+( int		slot,
+  patch_t*	patch )
+{
+    column_t*	column;
+    int		width;
+    int		first;
+    int		x;
+
+    width = SHORT(patch->width);
+    R_StartCompile (width);
+
+    for (x=0 ; x<width ; x++)
+    {
+	first = compilecolumns[x] = numcompileposts;
+	column = (column_t *)((byte *)patch + LONG(patch->columnofs[x]));
+
+	for ( ; column->topdelta != 0xff ;
+	      column = (column_t *)((byte *)column + column->length + 4))
+	{
+	    if (column->length)
+		R_AddCompiledRun (first, column->topdelta,
+				  column->length, (byte *)column + 3);
+	}
+    }
+
+    R_FinishCompile (slot, width, SHORT(patch->height),
+		     SHORT(patch->leftoffset), SHORT(patch->topoffset));
+}
+
+
+//
+// R_CompileMaskedTexture
+// A column covered by one patch is that patch's posts,
+//  as R_GenerateLookup has always drawn them: where the
+//  patch puts them, ignoring originy and the texture
+//  height. Columns of several patches were never drawn
+//  right; they are composited, keeping their holes.
+//
+static void R_CompileMaskedTexture (int texnum)
+{
+    texture_t*	texture;
+    texpatch_t*	patch;
+    texpatch_t**	colpatch;
+    patch_t*	realpatch;
+    column_t*	column;
+    byte*	source;
+    byte*	texels;
+    byte*	opaque;
+    byte*	patchcount;
+    int		width;
+    int		height;
+    int		first;
+    int		count;
+    int		position;
+    int		i;
+    int		x;
+    int		x1;
+    int		x2;
+    int		y;
+
+    texture = textures[texnum];
+    width = texture->width;
+    height = texture->height;
+
+    // One row of pad above and below every column.
+    texels = malloc (width*(height+2));
+    opaque = calloc (width, height);
+    patchcount = calloc (width, 1);
+    colpatch = malloc (width*sizeof(*colpatch));
+    if (!texels || !opaque || !patchcount || !colpatch)
+	I_Error ("R_CompileMaskedTexture: no memory");
+    memset (texels, 0, width*(height+2));
+
+    // which columns have one patch, as in R_GenerateLookup
+    for (i=0 , patch = texture->patches;
+	 i<texture->patchcount;
+	 i++, patch++)
+    {
+	realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+	x1 = patch->originx;
+	x2 = x1 + SHORT(realpatch->width);
+
+	if (x1<0)
+	    x = 0;
+	else
+	    x = x1;
+
+	if (x2 > width)
+	    x2 = width;
+
+	for ( ; x<x2 ; x++)
+	{
+	    if (patchcount[x] < 255)
+		patchcount[x]++;
+	    colpatch[x] = patch;
+	}
+    }
+
+    for (i=0 , patch = texture->patches;
+	 i<texture->patchcount;
+	 i++, patch++)
+    {
+	realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+	x1 = patch->originx;
+	x2 = x1 + SHORT(realpatch->width);
+
+	if (x1<0)
+	    x = 0;
+	else
+	    x = x1;
+
+	if (x2 > width)
+	    x2 = width;
+
+	for ( ; x<x2 ; x++)
+	{
+	    if (patchcount[x] < 2)
+		continue;
+
+	    column = (column_t *)((byte *)realpatch
+				  + LONG(realpatch->columnofs[x-x1]));
+	    for ( ; column->topdelta != 0xff ;
+		  column = (column_t *)((byte *)column + column->length + 4))
+	    {
+		source = (byte *)column + 3;
+		count = column->length;
+		position = patch->originy + column->topdelta;
+		if (position < 0)
+		{
+		    source -= position;
+		    count += position;
+		    position = 0;
+		}
+		if (position + count > height)
+		    count = height - position;
+		if (count <= 0)
+		    continue;
+
+		memcpy (texels + x*(height+2) + 1 + position, source, count);
+		memset (opaque + x*height + position, 1, count);
+	    }
+	}
+    }
+
+    R_StartCompile (width);
+    for (x=0 ; x<width ; x++)
+    {
+	first = compilecolumns[x] = numcompileposts;
+
+	if (patchcount[x] == 1)
+	{
+	    patch = colpatch[x];
+	    realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+	    column = (column_t *)((byte *)realpatch
+				  + LONG(realpatch->columnofs[x-patch->originx]));
+	    for ( ; column->topdelta != 0xff ;
+		  column = (column_t *)((byte *)column + column->length + 4))
+	    {
+		if (column->length)
+		    R_AddCompiledRun (first, column->topdelta,
+				      column->length, (byte *)column + 3);
+	    }
+	    continue;
+	}
+
+	for (y=0 ; y<height ; )
+	{
+	    if (!opaque[x*height + y])
+	    {
+		y++;
+		continue;
+	    }
+	    for (i=y ; i<height && opaque[x*height + i] ; i++)
+		;
+	    R_AddCompiledRun (first, y, i-y, texels + x*(height+2) + 1 + y);
+	    y = i;
+	}
+    }
+
+    free (texels);
+    free (opaque);
+    free (patchcount);
+    free (colpatch);
+
+    R_FinishCompile (numlumps+texnum, width, height, 0, 0);
+}
+
+
+//
+// R_CacheCompiled
+// Compiles slot if it is not cached, under the lock
+//  while the refresh threads run, and pins it.
+//
+static cpatch_t* R_CacheCompiled (int slot)
+{
+    cpatch_t*	patch;
+
+    if (pinningcache && I_LoadAcquire (&cpatchpinframe[slot]) == pinframe)
+	return cpatches[slot];
+
+    if (pinningcache)
+    {
+	I_Lock ();
+	if (cpatchpinframe[slot] == pinframe)
+	{
+	    patch = cpatches[slot];
+	    I_Unlock ();
+	    return patch;
+	}
+    }
+
+    if (!cpatches[slot])
+    {
+	if (slot < numlumps)
+	    R_CompilePatch (slot, W_CacheLumpNum (slot, PU_CACHE));
+	else
+	    R_CompileMaskedTexture (slot - numlumps);
+    }
+    patch = cpatches[slot];
+
+    if (pinningcache)
+    {
+	R_PinBlock (patch);
+	I_StoreRelease (&cpatchpinframe[slot], pinframe);
+	I_Unlock ();
+    }
+
+    return patch;
+}
+
+
+//
+// R_CachePatchNum
+// The compiled patch of lump.
+//
+cpatch_t* R_CachePatchNum (int lump)
+{
+    if ((unsigned)lump >= (unsigned)numlumps)
+	I_Error ("R_CachePatchNum: %i >= numlumps", lump);
+
+    return R_CacheCompiled (lump);
+}
+
+
+//
+// R_CachePatch
+// The compiled patch of a patch_t from W_CacheLumpNum,
+//  for the 2D code, which holds on to those.
+//
+cpatch_t* R_CachePatch (patch_t* patch)
+{
+    memblock_t*	block;
+    void**	user;
+    int		slot;
+
+    block = (memblock_t *)((byte *)patch - sizeof(memblock_t));
+    user = block->user;
+    if (user >= lumpcache && user < lumpcache+numlumps && *user == patch)
+	return R_CacheCompiled (user - lumpcache);
+
+    // Not a lump, so it is compiled on every call.
+    slot = numcpatches-1;
+    if (cpatches[slot])
+	Z_Free (cpatches[slot]);
+    R_CompilePatch (slot, patch);
+
+    return cpatches[slot];
+}
+
+
+//
+// R_CacheMaskedTexture
+// The compiled texture, for masked mid textures.
+//
+cpatch_t* R_CacheMaskedTexture (int tex)
+{
+    return R_CacheCompiled (numlumps+tex);
+}
+
+
+
+//
+// MIPMAPS
+// Smaller copies of every wall texture and flat, each
+//  level half the size of the one before, box filtered
+//  in RGB and matched back to the palette. Far away
+//  walls and floors then sample something close to the
+//  average of the texels they step over, instead of
+//  every n-th one. Built on the first level load, in one
+//  block outside the zone; -nomipmap leaves them out for
+//  vanilla exact output.
+//
+typedef struct
+{
+    int		levels;		// including the texture itself
+    int		height[MIPLEVELS];
+    byte*	data[MIPLEVELS];
+
+} mipmap_t;
+
+boolean		mipmapping;
+
+static mipmap_t*	texturemips;
+static mipmap_t*	flatmips;
+static byte*		mipblock;
+
+// Nearest palette entry, by 5:5:5 RGB.
+static byte*		rgbtopalette;
+
+// The AVX2 span drawer reads a little in front of a
+//  flat, and columns are drawn past their ends on tall
+//  walls, as they are from the zone.
+#define MIPLEADPAD	16
+#define MIPTAILPAD	0x10000
+
+#define RGBINDEX(r,g,b)	((((r)>>3)<<10) + (((g)>>3)<<5) + ((b)>>3))
+
+
+//
+// R_InitRGBToPalette
+//
+static void R_InitRGBToPalette (byte* palette)
+{
+    int		r;
+    int		g;
+    int		b;
+    int		i;
+    int		d;
+    int		dist;
+    int		best;
+    byte*	pal;
+
+    rgbtopalette = malloc (32*32*32);
+    if (!rgbtopalette)
+	I_Error ("R_InitRGBToPalette: no memory");
+
+    for (r=0 ; r<32 ; r++)
+    {
+	for (g=0 ; g<32 ; g++)
+	{
+	    for (b=0 ; b<32 ; b++)
+	    {
+		best = 0;
+		dist = MAXINT;
+		for (i=0, pal=palette ; i<256 ; i++, pal+=3)
+		{
+		    d = (pal[0] - (r<<3|4)) * (pal[0] - (r<<3|4))
+			+ (pal[1] - (g<<3|4)) * (pal[1] - (g<<3|4))
+			+ (pal[2] - (b<<3|4)) * (pal[2] - (b<<3|4));
+		    if (d < dist)
+		    {
+			dist = d;
+			best = i;
+		    }
+		}
+		rgbtopalette[(r<<10) + (g<<5) + b] = best;
+	    }
+	}
+    }
+}
+
+
+//
+// R_HalveImage
+// Box filters w by h RGB texels into (w>>1) by (h>>1).
+// Columns are h texels apart, as in a texture; a flat,
+//  being square, just goes through it transposed.
+//
+static void
+R_HalveImage
+( int*		src,
+  int		w,
+  int		h,
+  int*		dest )
+{
+    int		x;
+    int		y;
+    int		c;
+    int*	s;
+
+    for (x=0 ; x<w>>1 ; x++)
+    {
+	for (y=0 ; y<h>>1 ; y++)
+	{
+	    s = src + (2*x*h + 2*y)*3;
+	    for (c=0 ; c<3 ; c++)
+		*dest++ = (s[c] + s[c+3] + s[h*3+c] + s[h*3+c+3] + 2) >> 2;
+	}
+    }
+}
+
+
+//
+// R_QuantizeImage
+//
+static void
+R_QuantizeImage
+( int*		src,
+  int		count,
+  byte*		dest )
+{
+    for ( ; count>0 ; count--, src+=3)
+	*dest++ = rgbtopalette[RGBINDEX(src[0], src[1], src[2])];
+}
+
+
+//
+// R_GenerateMipmaps
+// Called by P_SetupLevel; only the first call
+//  does anything.
+//
+void R_GenerateMipmaps (void)
+{
+    byte	palette[768];
+    texture_t*	texture;
+    int*	rgb;
+    int*	half;
+    int*	swap;
+    byte*	data;
+    byte*	src;
+    byte	quarter[32*32];
+    int		size;
+    int		maxsize;
+    int		i;
+    int		m;
+    int		x;
+    int		y;
+    int		w;
+    int		h;
+
+    if (!mipmapping || mipblock)
+	return;
+
+    memcpy (palette, W_CacheLumpName ("PLAYPAL", PU_CACHE), 768);
+    R_InitRGBToPalette (palette);
+
+    texturemips = calloc (numtextures, sizeof(*texturemips));
+    flatmips = calloc (numflats, sizeof(*flatmips));
+    if (!texturemips || !flatmips)
+	I_Error ("R_GenerateMipmaps: no memory");
+
+    // Size it all up first, for a single block.
+    // Flat levels are tiled up to 64*64, so that
+    //  the span drawers can wrap them as usual.
+    size = MIPLEADPAD;
+    maxsize = 64*64;
+    for (i=0 ; i<numflats ; i++)
+    {
+	if (W_LumpLength (firstflat+i) < 64*64)
+	    continue;
+	flatmips[i].levels = MIPLEVELS;
+	size += (MIPLEVELS-1)*64*64;
+    }
+    for (i=0 ; i<numtextures ; i++)
+    {
+	w = textures[i]->width;
+	h = textures[i]->height;
+	if (w*h > maxsize)
+	    maxsize = w*h;
+	for (m=1 ; m<MIPLEVELS && w>>m && h>>m ; m++)
+	    size += (w>>m)*(h>>m);
+	texturemips[i].levels = m;
+    }
+
+    mipblock = malloc (size + MIPTAILPAD);
+    rgb = malloc (maxsize*3*sizeof(*rgb));
+    half = malloc (maxsize*3*sizeof(*half));
+    if (!mipblock || !rgb || !half)
+	I_Error ("R_GenerateMipmaps: no memory for %i bytes", size);
+    memset (mipblock, 0, size + MIPTAILPAD);
+    data = mipblock + MIPLEADPAD;
+
+    for (i=0 ; i<numflats ; i++)
+    {
+	if (!flatmips[i].levels)
+	    continue;
+
+	src = W_CacheLumpNum (firstflat+i, PU_CACHE);
+	for (x=0 ; x<64*64 ; x++)
+	{
+	    rgb[x*3] = palette[src[x]*3];
+	    rgb[x*3+1] = palette[src[x]*3+1];
+	    rgb[x*3+2] = palette[src[x]*3+2];
+	}
+
+	for (m=1, w=32 ; m<MIPLEVELS ; m++, w>>=1)
+	{
+	    R_HalveImage (rgb, w*2, w*2, half);
+	    R_QuantizeImage (half, w*w, quarter);
+	    swap = rgb; rgb = half; half = swap;
+
+	    flatmips[i].data[m] = data;
+	    for (y=0 ; y<64 ; y++)
+		for (x=0 ; x<64 ; x++)
+		    *data++ = quarter[(y&(w-1))*w + (x&(w-1))];
+	}
+    }
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+	texture = textures[i];
+	w = texture->width;
+	h = texture->height;
+	texturemips[i].height[0] = h;
+	if (texturemips[i].levels < 2)
+	    continue;
+
+	// R_GetColumn may purge the last column it returned
+	for (x=0 ; x<w ; x++)
+	{
+	    src = R_GetColumn (i, x);
+	    for (y=0 ; y<h ; y++)
+	    {
+		rgb[(x*h+y)*3] = palette[src[y]*3];
+		rgb[(x*h+y)*3+1] = palette[src[y]*3+1];
+		rgb[(x*h+y)*3+2] = palette[src[y]*3+2];
+	    }
+	}
+
+	for (m=1 ; m<texturemips[i].levels ; m++)
+	{
+	    R_HalveImage (rgb, w, h, half);
+	    w >>= 1;
+	    h >>= 1;
+	    R_QuantizeImage (half, w*h, data);
+	    swap = rgb; rgb = half; half = swap;
+
+	    texturemips[i].data[m] = data;
+	    texturemips[i].height[m] = h;
+	    data += w*h;
+	}
+    }
+
+    free (rgb);
+    free (half);
+
+    printf ("R_GenerateMipmaps: %i bytes for %i textures and %i flats\n",
+	    size + MIPTAILPAD, numtextures, numflats);
+}
+
+
+//
+// R_MipLevel
+// The level to sample from when stepping
+//  step texels per pixel.
+//
+int R_MipLevel (fixed_t step)
+{
+    int		level;
+
+    if (!mipblock)
+	return 0;
+
+    for (level=0 ; level<MIPLEVELS-1 ; level++)
+	if (step < (2*FRACUNIT)<<level)
+	    break;
+
+    return level;
+}
+
+
+//
+// R_GetMipColumn
+// R_GetColumn from mip level *level, or the closest
+//  one the texture has, which is written back.
+//
+byte*
+R_GetMipColumn
+( int		tex,
+  int		col,
+  int*		level )
+{
+    mipmap_t*	mip;
+
+    if (*level && (unsigned)tex < (unsigned)numtextures)
+    {
+	mip = &texturemips[tex];
+	if (*level >= mip->levels)
+	    *level = mip->levels-1;
+	if (*level > 0)
+	    return mip->data[*level]
+		+ ((col & texturewidthmask[tex]) >> *level) * mip->height[*level];
+    }
+
+    *level = 0;
+    return R_GetColumn (tex, col);
+}
+
+
+//
+// R_GetFlatMip
+// Level 1 and up of a flat, NULL if there are none.
+//
+byte*
+R_GetFlatMip
+( int		flat,
+  int		level )
+{
+    if (!mipblock || level >= flatmips[flat].levels)
+	return NULL;
+    return flatmips[flat].data[level];
+}
+
 
 
 //
@@ -510,13 +1675,15 @@ void R_InitTextures (void)
     }
     numtextures = numtextures1 + numtextures2;
 	
-    textures = Z_Malloc (numtextures*4, PU_STATIC, 0);
-    texturecolumnlump = Z_Malloc (numtextures*4, PU_STATIC, 0);
-    texturecolumnofs = Z_Malloc (numtextures*4, PU_STATIC, 0);
-    texturecomposite = Z_Malloc (numtextures*4, PU_STATIC, 0);
+    textures = Z_Malloc (numtextures*sizeof(*textures), PU_STATIC, 0);
+    texturecolumnlump = Z_Malloc (numtextures*sizeof(*texturecolumnlump), PU_STATIC, 0);
+    texturecolumnofs = Z_Malloc (numtextures*sizeof(*texturecolumnofs), PU_STATIC, 0);
+    texturecomposite = Z_Malloc (numtextures*sizeof(*texturecomposite), PU_STATIC, 0);
     texturecompositesize = Z_Malloc (numtextures*4, PU_STATIC, 0);
     texturewidthmask = Z_Malloc (numtextures*4, PU_STATIC, 0);
     textureheight = Z_Malloc (numtextures*4, PU_STATIC, 0);
+    texturecolumns = Z_Malloc (numtextures*sizeof(*texturecolumns), PU_STATIC, 0);
+    memset (texturecolumns, 0, numtextures*sizeof(*texturecolumns));
 
     totalwidth = 0;
     
@@ -696,7 +1863,9 @@ void R_InitColormaps (void)
 //
 void R_InitData (void)
 {
+    mipmapping = !M_CheckParm ("-nomipmap");
     R_InitTextures ();
+    R_InitPatchCache ();
     printf ("\nInitTextures");
     R_InitFlats ();
     printf ("\nInitFlats");
@@ -861,23 +2030,10 @@ void R_PrecacheLevel (void)
     }
     
     // Precache textures.
+    // The walls are in the column store by now, but
+    //  masked mid textures are drawn from the patches.
     texturepresent = alloca(numtextures);
-    memset (texturepresent,0, numtextures);
-	
-    for (i=0 ; i<numsides ; i++)
-    {
-	texturepresent[sides[i].toptexture] = 1;
-	texturepresent[sides[i].midtexture] = 1;
-	texturepresent[sides[i].bottomtexture] = 1;
-    }
-
-    // Sky texture is always present.
-    // Note that F_SKY1 is the name used to
-    //  indicate a sky floor/ceiling as a flat,
-    //  while the sky texture is stored like
-    //  a wall texture, with an episode dependend
-    //  name.
-    texturepresent[skytexture] = 1;
+    R_MarkLevelTextures ((byte *)texturepresent);
 	
     texturememory = 0;
     for (i=0 ; i<numtextures ; i++)
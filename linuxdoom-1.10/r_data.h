@@ -38,6 +38,69 @@ R_GetColumn
   int		col );
 
 
+// Compiled patches, see cpatch_t. Between R_StartCachePins
+//  and R_ReleaseCachePins they are pinned like lumps.
+cpatch_t*	R_CachePatchNum (int lump);
+
+// For a patch_t the 2D code cached.
+cpatch_t*	R_CachePatch (patch_t* patch);
+
+// A texture compiled with its holes,
+//  for masked mid textures.
+cpatch_t*	R_CacheMaskedTexture (int tex);
+
+void	R_InitPatchCache (void);
+
+
+// For each texture, its columns in the store,
+//  or NULL if R_BuildColumnStore left it out.
+extern byte***	texturecolumns;
+
+// Composites the textures R_MarkLevelTextures
+//  finds into the store, on every level load.
+void	R_BuildColumnStore (void);
+
+// Marks the textures the level can show.
+void	R_MarkLevelTextures (byte* present);
+
+
+// Lump access from the refresh. Between R_StartCachePins
+//  and R_ReleaseCachePins, all lumps and composites touched
+//  are kept from being purged, so that several render
+//  threads can share the zone.
+void*	R_CacheLumpNum (int lump);
+void	R_StartCachePins (void);
+void	R_ReleaseCachePins (void);
+
+
+// Mip levels, including the full size one.
+#define MIPLEVELS	4
+
+// Cleared by -nomipmap.
+extern boolean	mipmapping;
+
+// Builds the mip levels, on the first level load.
+void	R_GenerateMipmaps (void);
+
+// The mip level for step texels per pixel.
+int	R_MipLevel (fixed_t step);
+
+// A column of mip level *level, or the nearest one
+//  that exists, in which case *level is lowered.
+byte*
+R_GetMipColumn
+( int		tex,
+  int		col,
+  int*		level );
+
+// A flat at mip level 1 and up, tiled to 64*64,
+//  or NULL if there is none.
+byte*
+R_GetFlatMip
+( int		flat,
+  int		level );
+
+
 // I/O, setting up the stuff.
 void R_InitData (void);
 void R_PrecacheLevel (void);
@@ -52,9 +52,6 @@
 #define SIL_TOP			2
 #define SIL_BOTH		3
 
-#define MAXDRAWSEGS		256
-
-
 
 
 
@@ -102,6 +99,11 @@ typedef	struct
 {
     fixed_t	floorheight;
     fixed_t	ceilingheight;
+
+    // Heights at the start of the last tic, for interpolation.
+    fixed_t	oldfloorheight;
+    fixed_t	oldceilingheight;
+    
     short	floorpic;
     short	ceilingpic;
     short	lightlevel;
@@ -364,6 +366,34 @@ typedef struct
 } patch_t;
 
 
+// Compiled patches.
+// A patch_t made over for drawing, see R_CachePatchNum:
+//  native ints, and the posts of each column as runs
+//  into one block of texels, with posts that touch
+//  merged into a single run. Each run keeps a pad texel
+//  on either side, as the drawers may read one past.
+// Drawing flipped just steps the column table backwards.
+typedef struct
+{
+    short		topdelta;	// first row of the run
+    short		length;
+    int			offset;		// of its first texel in pixels
+} cpost_t;
+
+typedef struct
+{
+    int			width;
+    int			height;
+    int			leftoffset;
+    int			topoffset;
+
+    // Column x is posts[columns[x]] up to posts[columns[x+1]].
+    int*		columns;
+    cpost_t*		posts;
+    byte*		pixels;
+} cpatch_t;
+
+
 
 
 
@@ -457,25 +487,22 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 // 
-typedef struct
+typedef struct visplane_s
 {
   fixed_t		height;
   int			picnum;
   int			lightlevel;
   int			minx;
   int			maxx;
+
+  // next in the R_FindPlane hash chain
+  struct visplane_s*	next;
   
-  // leave pads for [minx-1]/[maxx+1]
-  
-  byte		pad1;
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
-  // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+  // MAXWIDTH entries each, allocated along with
+  //  the plane; [minx-1]/[maxx+1] are valid pads.
+  // 0xffff is an unused column.
+  unsigned short*	top;
+  unsigned short*	bottom;
 
 } visplane_t;
 
@@ -23,9 +23,18 @@ rcsid[] = "$Id: r_draw.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 #include "r_local.h"
 #include "v_video.h"
 #include "doomstat.h"
+#include "r_reuse.h"
+
+#ifdef R_SIMD
+#include <immintrin.h>
+
+#ifdef __GNUC__
+#define AVX2FUNC    __attribute__((target("avx2")))
+#else
+#define AVX2FUNC
+#endif
+#endif
 
-#define MAXWIDTH    1120
-#define MAXHEIGHT   832
 #define SBARHEIGHT  32
 
 byte* viewimage;
@@ -34,23 +43,53 @@ int     scaledviewwidth;
 int     viewheight;
 int     viewwindowx;
 int     viewwindowy;
+int     viewwindowwidth;
+int     viewwindowheight;
 byte* ylookup[MAXHEIGHT];
 int     columnofs[MAXWIDTH];
 
+// The view window in BASE_WIDTH by BASE_HEIGHT units,
+//  for the border patches.
+static int baseviewx;
+static int baseviewy;
+static int baseviewwidth;
+static int baseviewheight;
+
+//
+// The view is drawn into viewbuffer instead of the
+//  screen when it is transposed or rendered smaller than
+//  its window, and R_FinishView copies it to screens[0]
+//  before anything else is drawn on top.
+// With -transpose it is column-major, so that the column
+//  drawers write to contiguous memory.
+//
+boolean transposed;
+boolean viewbuffered;
+byte*   viewbuffer;
+static int viewbuffersize;
+int     colstep = BASE_WIDTH;   // from a pixel to the one below
+int     spanstep = 1;           // from a pixel to the one right of it
+
+// Offset in viewbuffer of the pixel that each
+//  column/row of the window is stretched from.
+static int viewsrccol[MAXWIDTH];
+static int viewsrcrow[MAXHEIGHT];
+
 byte    translations[3][256];
 
 
 //
 // Column renderer globals
 //
-lighttable_t* dc_colormap;
-int             dc_x;
-int             dc_yl;
-int             dc_yh;
-fixed_t         dc_iscale;
-fixed_t         dc_texturemid;
-byte* dc_source;
-int             dccount;
+THREADLOCAL lighttable_t* dc_colormap;
+THREADLOCAL int             dc_x;
+THREADLOCAL int             dc_yl;
+THREADLOCAL int             dc_yh;
+THREADLOCAL fixed_t         dc_iscale;
+THREADLOCAL fixed_t         dc_texturemid;
+THREADLOCAL byte* dc_source;
+THREADLOCAL int             dc_heightmask;
+THREADLOCAL int             dccount;
 
 
 //
@@ -78,6 +117,7 @@ void R_DrawColumn(void)
     byte* dest;
     fixed_t     frac;
     fixed_t     fracstep;
+    int         step;
 
     count = dc_yh - dc_yl;
     if (count < 0)
@@ -94,6 +134,7 @@ void R_DrawColumn(void)
 
     dest = ylookup[dc_yl] + columnofs[dc_x];
 
+    step = colstep;
     fracstep = dc_iscale;
     frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
@@ -104,7 +145,7 @@ void R_DrawColumn(void)
         // dc_source points to the raw pixel data for this column.
         *dest = dc_colormap[dc_source[frac >> FRACBITS]];
 
-        dest += SCREENWIDTH;
+        dest += step;
         frac += fracstep;
     } while (count--);
 }
@@ -117,6 +158,7 @@ void R_DrawColumnLow(void)
     byte* dest2;
     fixed_t     frac;
     fixed_t     fracstep;
+    int         step;
 
     count = dc_yh - dc_yl;
     if (count < 0)
@@ -135,24 +177,588 @@ void R_DrawColumnLow(void)
     dest = ylookup[dc_yl] + columnofs[dc_x];
     dest2 = ylookup[dc_yl] + columnofs[dc_x + 1];
 
+    step = colstep;
     fracstep = dc_iscale;
     frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
     do
     {
         *dest2 = *dest = dc_colormap[dc_source[frac >> FRACBITS]];
-        dest += SCREENWIDTH;
-        dest2 += SCREENWIDTH;
+        dest += step;
+        dest2 += step;
+        frac += fracstep;
+    } while (count--);
+}
+
+
+//
+// Column drawer variants.
+// The generic drawers read dc_source and dc_colormap
+//  again for every pixel, since the writes through dest
+//  could change them. The variants take everything that
+//  is known before the loop into locals, and
+//  R_PickColumnFunc picks one for each column run.
+//
+boolean drawvariants = true;
+
+void R_DrawColumnInside(void)
+{
+    int         count;
+    byte* dest;
+    byte* source;
+    lighttable_t* colormap;
+    fixed_t     frac;
+    fixed_t     fracstep;
+    int         step;
+
+    count = dc_yh - dc_yl;
+    if (count < 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+        || dc_yl < 0
+        || dc_yh >= SCREENHEIGHT)
+    {
+        I_Error("R_DrawColumnInside: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    source = dc_source;
+    colormap = dc_colormap;
+
+    step = colstep;
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl - centery) * fracstep;
+
+    // two pixels a round, the count is one less
+    while (count > 0)
+    {
+        dest[0] = colormap[source[frac >> FRACBITS]];
+        dest[step] = colormap[source[(frac + fracstep) >> FRACBITS]];
+        dest += 2 * step;
+        frac += 2 * fracstep;
+        count -= 2;
+    }
+    if (!count)
+        *dest = colormap[source[frac >> FRACBITS]];
+}
+
+
+void R_DrawColumnWrap(void)
+{
+    int         count;
+    byte* dest;
+    byte* source;
+    lighttable_t* colormap;
+    fixed_t     frac;
+    fixed_t     fracstep;
+    int         mask;
+    int         step;
+
+    count = dc_yh - dc_yl;
+    if (count < 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+        || dc_yl < 0
+        || dc_yh >= SCREENHEIGHT)
+    {
+        I_Error("R_DrawColumnWrap: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    source = dc_source;
+    colormap = dc_colormap;
+    mask = dc_heightmask;
+
+    step = colstep;
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl - centery) * fracstep;
+
+    do
+    {
+        *dest = colormap[source[(frac >> FRACBITS) & mask]];
+        dest += step;
+        frac += fracstep;
+    } while (count--);
+}
+
+
+void R_DrawColumnLowInside(void)
+{
+    int         count;
+    byte* dest;
+    byte* dest2;
+    byte* source;
+    lighttable_t* colormap;
+    fixed_t     frac;
+    fixed_t     fracstep;
+    int         step;
+
+    count = dc_yh - dc_yl;
+    if (count < 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+        || dc_yl < 0
+        || dc_yh >= SCREENHEIGHT)
+    {
+        I_Error("R_DrawColumnLowInside: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dc_x <<= 1;
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    dest2 = ylookup[dc_yl] + columnofs[dc_x + 1];
+    source = dc_source;
+    colormap = dc_colormap;
+
+    step = colstep;
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl - centery) * fracstep;
+
+    do
+    {
+        *dest2 = *dest = colormap[source[frac >> FRACBITS]];
+        dest += step;
+        dest2 += step;
         frac += fracstep;
     } while (count--);
 }
 
 
+void R_DrawColumnLowWrap(void)
+{
+    int         count;
+    byte* dest;
+    byte* dest2;
+    byte* source;
+    lighttable_t* colormap;
+    fixed_t     frac;
+    fixed_t     fracstep;
+    int         mask;
+    int         step;
+
+    count = dc_yh - dc_yl;
+    if (count < 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+        || dc_yl < 0
+        || dc_yh >= SCREENHEIGHT)
+    {
+        I_Error("R_DrawColumnLowWrap: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dc_x <<= 1;
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    dest2 = ylookup[dc_yl] + columnofs[dc_x + 1];
+    source = dc_source;
+    colormap = dc_colormap;
+    mask = dc_heightmask;
+
+    step = colstep;
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl - centery) * fracstep;
+
+    do
+    {
+        *dest2 = *dest = colormap[source[(frac >> FRACBITS) & mask]];
+        dest += step;
+        dest2 += step;
+        frac += fracstep;
+    } while (count--);
+}
+
+
+//
+// R_PickColumnFunc
+// A run that leaves the column tiles it when the height
+//  is a power of two. Others read on past the column,
+//  as R_DrawColumn always has.
+//
+void R_PickColumnFunc(int height)
+{
+    fixed_t     top;
+    long long   bottom;
+
+    if (!drawvariants)
+    {
+        colfunc = basecolfunc;
+        return;
+    }
+
+    top = dc_texturemid + (dc_yl - centery) * dc_iscale;
+    bottom = top + (long long)(dc_yh - dc_yl) * dc_iscale;
+
+    if (top >= 0 && bottom < (long long)height << FRACBITS)
+        colfunc = columnfuncs[COLUMN_INSIDE];
+    else if (height > 0 && !(height & (height - 1)))
+    {
+        colfunc = columnfuncs[COLUMN_WRAP];
+        dc_heightmask = height - 1;
+    }
+    else
+        colfunc = columnfuncs[COLUMN_INSIDE];
+}
+
+
+//
+// Column batching.
+// Runs of adjacent columns that would go to R_DrawColumn
+//  are staged and drawn four at a time, row by row, so a
+//  row is one 4 byte write instead of four rows apart.
+// The pixels are exactly the ones R_DrawColumn draws.
+//
+THREADLOCAL boolean batchcolumns;
+
+//
+// R_DrawStagedRows
+// Rows yl to yh of one staged column.
+//
+static void R_DrawStagedRows(stagedcolumn_t* col, int yl, int yh)
+{
+    int         count;
+    byte* dest;
+    fixed_t     frac;
+    fixed_t     fracstep;
+    int         step;
+
+    count = yh - yl;
+    if (count < 0)
+        return;
+
+    dest = ylookup[yl] + columnofs[col->x];
+    step = colstep;
+    fracstep = col->iscale;
+    frac = col->texturemid + (yl - centery) * fracstep;
+
+    do
+    {
+        *dest = col->colormap[col->source[(frac >> FRACBITS)
+                                          & col->heightmask]];
+        dest += step;
+        frac += fracstep;
+    } while (count--);
+}
+
+
+//
+// R_DrawColumnQuad
+// Draws four adjacent staged columns. The rows all of
+//  them cover go four pixels at a time, the ragged ends
+//  one column at a time.
+//
+static void R_DrawColumnQuad(stagedcolumn_t* cols)
+{
+    int         i;
+    int         top;
+    int         bottom;
+    int         count;
+    byte* dest;
+    byte* s0, * s1, * s2, * s3;
+    lighttable_t* c0, * c1, * c2, * c3;
+    fixed_t     f0, f1, f2, f3;
+    fixed_t     i0, i1, i2, i3;
+    int         m0, m1, m2, m3;
+
+    top = cols[0].yl;
+    bottom = cols[0].yh;
+    for (i = 1; i < BATCHCOLUMNS; i++)
+    {
+        if (cols[i].yl > top)
+            top = cols[i].yl;
+        if (cols[i].yh < bottom)
+            bottom = cols[i].yh;
+    }
+
+    if (top > bottom)
+    {
+        for (i = 0; i < BATCHCOLUMNS; i++)
+            R_DrawStagedRows(&cols[i], cols[i].yl, cols[i].yh);
+        return;
+    }
+
+    for (i = 0; i < BATCHCOLUMNS; i++)
+    {
+        R_DrawStagedRows(&cols[i], cols[i].yl, top - 1);
+        R_DrawStagedRows(&cols[i], bottom + 1, cols[i].yh);
+    }
+
+    s0 = cols[0].source; c0 = cols[0].colormap; i0 = cols[0].iscale;
+    s1 = cols[1].source; c1 = cols[1].colormap; i1 = cols[1].iscale;
+    s2 = cols[2].source; c2 = cols[2].colormap; i2 = cols[2].iscale;
+    s3 = cols[3].source; c3 = cols[3].colormap; i3 = cols[3].iscale;
+    m0 = cols[0].heightmask; m1 = cols[1].heightmask;
+    m2 = cols[2].heightmask; m3 = cols[3].heightmask;
+    f0 = cols[0].texturemid + (top - centery) * i0;
+    f1 = cols[1].texturemid + (top - centery) * i1;
+    f2 = cols[2].texturemid + (top - centery) * i2;
+    f3 = cols[3].texturemid + (top - centery) * i3;
+
+    dest = ylookup[top] + columnofs[cols[0].x];
+    count = bottom - top;
+
+    do
+    {
+        dest[0] = c0[s0[(f0 >> FRACBITS) & m0]];
+        dest[1] = c1[s1[(f1 >> FRACBITS) & m1]];
+        dest[2] = c2[s2[(f2 >> FRACBITS) & m2]];
+        dest[3] = c3[s3[(f3 >> FRACBITS) & m3]];
+        dest += SCREENWIDTH;
+        f0 += i0;
+        f1 += i1;
+        f2 += i2;
+        f3 += i3;
+    } while (count--);
+}
+
+
+//
+// R_BatchColumn
+// Stands in for a colfunc() call. Columns for anything
+//  but R_DrawColumn and its variants are drawn right away.
+//
+void R_BatchColumn(colbatch_t* batch)
+{
+    stagedcolumn_t* col;
+
+    if (!batchcolumns
+        || (colfunc != R_DrawColumn
+            && colfunc != R_DrawColumnInside
+            && colfunc != R_DrawColumnWrap))
+    {
+        colfunc();
+        return;
+    }
+
+    if (dc_yl > dc_yh)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+        || dc_yl < 0
+        || dc_yh >= SCREENHEIGHT)
+    {
+        I_Error("R_BatchColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    if (batch->count && batch->columns[batch->count - 1].x != dc_x - 1)
+        R_FlushColumns(batch);
+
+    col = &batch->columns[batch->count++];
+    col->x = dc_x;
+    col->yl = dc_yl;
+    col->yh = dc_yh;
+    col->iscale = dc_iscale;
+    col->texturemid = dc_texturemid;
+    col->source = dc_source;
+    col->colormap = dc_colormap;
+    col->heightmask = colfunc == R_DrawColumnWrap ? dc_heightmask : -1;
+
+    if (batch->count == BATCHCOLUMNS)
+    {
+        R_DrawColumnQuad(batch->columns);
+        batch->count = 0;
+    }
+}
+
+
+//
+// R_FlushColumns
+// Draws whatever is left staged.
+//
+void R_FlushColumns(colbatch_t* batch)
+{
+    int         i;
+
+    for (i = 0; i < batch->count; i++)
+        R_DrawStagedRows(&batch->columns[i],
+                         batch->columns[i].yl, batch->columns[i].yh);
+    batch->count = 0;
+}
+
+
+//
+// Wall column queue, for -sortwalls.
+// Drawing the columns of one texture together keeps it
+//  in the cache, where front to back order goes from
+//  texture to texture column by column.
+// Walls never overlap each other, so the order they are
+//  drawn in makes no difference to the pixels.
+//
+typedef struct
+{
+    int             texture;
+    void            (*func) (void);
+    stagedcolumn_t  column;
+
+} queuedcolumn_t;
+
+boolean sortwalls;
+
+THREADLOCAL queuedcolumn_t* colqueue;
+THREADLOCAL queuedcolumn_t* colqueue_p;
+THREADLOCAL int             maxcolqueue;
+THREADLOCAL int             maxqueuedtexture;
+
+// Queue indices, sorted by x, then by texture.
+THREADLOCAL int* colorder;
+THREADLOCAL int* colsorted;
+THREADLOCAL int  maxcolorder;
+
+// Counts, then starts, for the counting sorts.
+THREADLOCAL int  colxstart[MAXWIDTH + 1];
+THREADLOCAL int* coltexstart;
+THREADLOCAL int  maxcoltexstart;
+
+THREADLOCAL colbatch_t sortedbatch;
+
+
+//
+// R_QueueColumn
+//
+void R_QueueColumn(int texture)
+{
+    stagedcolumn_t* col;
+    int         count;
+
+    if (dc_yl > dc_yh)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+        || dc_yl < 0
+        || dc_yh >= SCREENHEIGHT)
+    {
+        I_Error("R_QueueColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    if (colqueue_p == colqueue + maxcolqueue)
+    {
+        count = colqueue_p - colqueue;
+        maxcolqueue = maxcolqueue ? maxcolqueue * 2 : 1024;
+        colqueue = realloc(colqueue, maxcolqueue * sizeof(*colqueue));
+        if (!colqueue)
+            I_Error("R_QueueColumn: no memory for %i columns", maxcolqueue);
+        colqueue_p = colqueue + count;
+    }
+
+    if (texture > maxqueuedtexture)
+        maxqueuedtexture = texture;
+
+    colqueue_p->texture = texture;
+    colqueue_p->func = colfunc;
+    col = &colqueue_p->column;
+    col->x = dc_x;
+    col->yl = dc_yl;
+    col->yh = dc_yh;
+    col->iscale = dc_iscale;
+    col->texturemid = dc_texturemid;
+    col->source = dc_source;
+    col->colormap = dc_colormap;
+    col->heightmask = dc_heightmask;
+    colqueue_p++;
+}
+
+
+//
+// R_DrawQueuedColumns
+// Two stable counting sorts, by x and then by texture,
+//  and the columns go to R_BatchColumn in that order,
+//  so runs of a texture are still drawn four at a time.
+//
+void R_DrawQueuedColumns(void)
+{
+    stagedcolumn_t* col;
+    int         count;
+    int         total;
+    int         n;
+    int         i;
+
+    count = colqueue_p - colqueue;
+    if (!count)
+        return;
+
+    if (maxcolorder < count)
+    {
+        maxcolorder = maxcolqueue;
+        colorder = realloc(colorder, maxcolorder * sizeof(*colorder));
+        colsorted = realloc(colsorted, maxcolorder * sizeof(*colsorted));
+        if (!colorder || !colsorted)
+            I_Error("R_DrawQueuedColumns: no memory for %i columns", count);
+    }
+    if (maxcoltexstart < maxqueuedtexture + 1)
+    {
+        maxcoltexstart = maxqueuedtexture + 1;
+        coltexstart = realloc(coltexstart,
+                              maxcoltexstart * sizeof(*coltexstart));
+        if (!coltexstart)
+            I_Error("R_DrawQueuedColumns: no memory for %i textures",
+                    maxcoltexstart);
+    }
+
+    // by x
+    memset(colxstart, 0, sizeof(colxstart));
+    for (i = 0; i < count; i++)
+        colxstart[colqueue[i].column.x]++;
+    for (i = total = 0; i <= MAXWIDTH; i++)
+    {
+        n = colxstart[i];
+        colxstart[i] = total;
+        total += n;
+    }
+    for (i = 0; i < count; i++)
+        colorder[colxstart[colqueue[i].column.x]++] = i;
+
+    // then by texture, keeping x order within each
+    memset(coltexstart, 0, (maxqueuedtexture + 1) * sizeof(*coltexstart));
+    for (i = 0; i < count; i++)
+        coltexstart[colqueue[i].texture]++;
+    for (i = total = 0; i <= maxqueuedtexture; i++)
+    {
+        n = coltexstart[i];
+        coltexstart[i] = total;
+        total += n;
+    }
+    for (i = 0; i < count; i++)
+        colsorted[coltexstart[colqueue[colorder[i]].texture]++] = colorder[i];
+
+    for (i = 0; i < count; i++)
+    {
+        colfunc = colqueue[colsorted[i]].func;
+        col = &colqueue[colsorted[i]].column;
+        dc_x = col->x;
+        dc_yl = col->yl;
+        dc_yh = col->yh;
+        dc_iscale = col->iscale;
+        dc_texturemid = col->texturemid;
+        dc_source = col->source;
+        dc_colormap = col->colormap;
+        dc_heightmask = col->heightmask;
+        R_BatchColumn(&sortedbatch);
+    }
+    R_FlushColumns(&sortedbatch);
+
+    colqueue_p = colqueue;
+    maxqueuedtexture = 0;
+}
+
+
 //
 // Spectre/Invisibility.
 //
 #define FUZZTABLE   50
-#define FUZZOFF     (SCREENWIDTH)
+#define FUZZOFF     1           // times colstep, see R_InitBuffer
 
 int fuzzoffset[FUZZTABLE] =
 {
@@ -165,7 +771,7 @@ int fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF
 };
 
-int fuzzpos = 0;
+THREADLOCAL int fuzzpos = 0;
 
 void R_DrawFuzzColumn(void)
 {
@@ -173,6 +779,7 @@ void R_DrawFuzzColumn(void)
     byte* dest;
     fixed_t     frac;
     fixed_t     fracstep;
+    int         step;
 
     if (!dc_yl)
         dc_yl = 1;
@@ -192,6 +799,7 @@ void R_DrawFuzzColumn(void)
 #endif
 
     dest = ylookup[dc_yl] + columnofs[dc_x];
+    step = colstep;
     fracstep = dc_iscale;
     frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
@@ -200,7 +808,7 @@ void R_DrawFuzzColumn(void)
         *dest = colormaps[6 * 256 + dest[fuzzoffset[fuzzpos]]];
         if (++fuzzpos == FUZZTABLE)
             fuzzpos = 0;
-        dest += SCREENWIDTH;
+        dest += step;
         frac += fracstep;
     } while (count--);
 }
@@ -209,15 +817,21 @@ void R_DrawFuzzColumn(void)
 //
 // R_DrawTranslatedColumn
 //
-byte* dc_translation;
+THREADLOCAL byte* dc_translation;
 byte* translationtables;
 
+// Each translation followed by each colormap,
+//  see R_TranslatedColormap.
+static byte* translatedcolormaps;
+static int  numcolormaps;
+
 void R_DrawTranslatedColumn(void)
 {
     int         count;
     byte* dest;
     fixed_t     frac;
     fixed_t     fracstep;
+    int         step;
 
     count = dc_yh - dc_yl;
     if (count < 0)
@@ -233,13 +847,14 @@ void R_DrawTranslatedColumn(void)
 #endif
 
     dest = ylookup[dc_yl] + columnofs[dc_x];
+    step = colstep;
     fracstep = dc_iscale;
     frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
     do
     {
         *dest = dc_colormap[dc_translation[dc_source[frac >> FRACBITS]]];
-        dest += SCREENWIDTH;
+        dest += step;
         frac += fracstep;
     } while (count--);
 }
@@ -251,6 +866,9 @@ void R_DrawTranslatedColumn(void)
 void R_InitTranslationTables(void)
 {
     int i;
+    int t;
+    int c;
+    byte* dest;
 
     translationtables = Z_Malloc(256 * 3 + 255, PU_STATIC, 0);
     translationtables = (byte*)(((uintptr_t)translationtables + 255) & ~255);
@@ -269,22 +887,52 @@ void R_InitTranslationTables(void)
                 = translationtables[i + 512] = i;
         }
     }
+
+    numcolormaps = W_LumpLength(W_GetNumForName("COLORMAP")) / 256;
+    translatedcolormaps = Z_Malloc(3 * numcolormaps * 256, PU_STATIC, 0);
+
+    dest = translatedcolormaps;
+    for (t = 0; t < 3; t++)
+        for (c = 0; c < numcolormaps; c++)
+            for (i = 0; i < 256; i++)
+                *dest++ = colormaps[c * 256 + translationtables[t * 256 + i]];
+}
+
+
+//
+// R_TranslatedColormap
+//
+lighttable_t* R_TranslatedColormap(int translation, lighttable_t* colormap)
+{
+    int c;
+
+    c = (colormap - colormaps) / 256;
+
+#ifdef RANGECHECK
+    if (translation < 1 || translation > 3
+        || c < 0 || c >= numcolormaps)
+    {
+        I_Error("R_TranslatedColormap: %i, colormap %i", translation, c);
+    }
+#endif
+
+    return translatedcolormaps + ((translation - 1) * numcolormaps + c) * 256;
 }
 
 
 //
 // R_DrawSpan
 //
-int             ds_y;
-int             ds_x1;
-int             ds_x2;
-lighttable_t* ds_colormap;
-fixed_t         ds_xfrac;
-fixed_t         ds_yfrac;
-fixed_t         ds_xstep;
-fixed_t         ds_ystep;
-byte* ds_source;
-int             dscount;
+THREADLOCAL int             ds_y;
+THREADLOCAL int             ds_x1;
+THREADLOCAL int             ds_x2;
+THREADLOCAL lighttable_t* ds_colormap;
+THREADLOCAL fixed_t         ds_xfrac;
+THREADLOCAL fixed_t         ds_yfrac;
+THREADLOCAL fixed_t         ds_xstep;
+THREADLOCAL fixed_t         ds_ystep;
+THREADLOCAL byte* ds_source;
+THREADLOCAL int             dscount;
 
 void R_DrawSpan(void)
 {
@@ -293,6 +941,7 @@ void R_DrawSpan(void)
     byte* dest;
     int         count;
     int         spot;
+    int         step;
 
 #ifdef RANGECHECK
     if (ds_x2 < ds_x1
@@ -308,11 +957,13 @@ void R_DrawSpan(void)
     yfrac = ds_yfrac;
     dest = ylookup[ds_y] + columnofs[ds_x1];
     count = ds_x2 - ds_x1;
+    step = spanstep;
 
     do
     {
         spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
-        *dest++ = ds_colormap[ds_source[spot]];
+        *dest = ds_colormap[ds_source[spot]];
+        dest += step;
         xfrac += ds_xstep;
         yfrac += ds_ystep;
     } while (count--);
@@ -326,6 +977,7 @@ void R_DrawSpanLow(void)
     byte* dest;
     int         count;
     int         spot;
+    int         step;
 
 #ifdef RANGECHECK
     if (ds_x2 < ds_x1
@@ -343,37 +995,439 @@ void R_DrawSpanLow(void)
     ds_x2 <<= 1;
     dest = ylookup[ds_y] + columnofs[ds_x1];
     count = ds_x2 - ds_x1;
+    step = spanstep;
 
     do
     {
         spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
-        *dest++ = ds_colormap[ds_source[spot]];
-        *dest++ = ds_colormap[ds_source[spot]];
+        dest[0] = dest[step] = ds_colormap[ds_source[spot]];
+        dest += 2 * step;
         xfrac += ds_xstep;
         yfrac += ds_ystep;
     } while (count--);
 }
 
 
+//
+// R_DrawSpanRow
+// R_DrawSpan with everything it reads in locals,
+//  and the pixels next to each other.
+//
+void R_DrawSpanRow(void)
+{
+    fixed_t     xfrac;
+    fixed_t     yfrac;
+    fixed_t     xstep;
+    fixed_t     ystep;
+    byte* dest;
+    byte* source;
+    lighttable_t* colormap;
+    int         count;
+    int         spot;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+        || ds_x1 < 0
+        || ds_x2 >= SCREENWIDTH
+        || (unsigned)ds_y > SCREENHEIGHT)
+    {
+        I_Error("R_DrawSpanRow: %i to %i at %i", ds_x1, ds_x2, ds_y);
+    }
+#endif
+
+    xfrac = ds_xfrac;
+    yfrac = ds_yfrac;
+    xstep = ds_xstep;
+    ystep = ds_ystep;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    source = ds_source;
+    colormap = ds_colormap;
+    count = ds_x2 - ds_x1;
+
+    do
+    {
+        spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
+        *dest++ = colormap[source[spot]];
+        xfrac += xstep;
+        yfrac += ystep;
+    } while (count--);
+}
+
+
+void R_DrawSpanLowRow(void)
+{
+    fixed_t     xfrac;
+    fixed_t     yfrac;
+    fixed_t     xstep;
+    fixed_t     ystep;
+    byte* dest;
+    byte* source;
+    lighttable_t* colormap;
+    int         count;
+    int         spot;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+        || ds_x1 < 0
+        || ds_x2 >= SCREENWIDTH
+        || (unsigned)ds_y > SCREENHEIGHT)
+    {
+        I_Error("R_DrawSpanLowRow: %i to %i at %i", ds_x1, ds_x2, ds_y);
+    }
+#endif
+
+    xfrac = ds_xfrac;
+    yfrac = ds_yfrac;
+    xstep = ds_xstep;
+    ystep = ds_ystep;
+    ds_x1 <<= 1;
+    ds_x2 <<= 1;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    source = ds_source;
+    colormap = ds_colormap;
+    count = ds_x2 - ds_x1;
+
+    do
+    {
+        spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
+        dest[0] = dest[1] = colormap[source[spot]];
+        dest += 2;
+        xfrac += xstep;
+        yfrac += ystep;
+    } while (count--);
+}
+
+
+#ifdef R_SIMD
+//
+// R_DrawSpanSSE2
+// Works out the flat offsets of eight pixels at once,
+//  the texel and colormap lookups stay scalar.
+// Only for spanstep 1, see R_ExecuteSetViewSize.
+//
+void R_DrawSpanSSE2(void)
+{
+    unsigned    xfrac;
+    unsigned    yfrac;
+    byte* dest;
+    byte* source;
+    lighttable_t* colormap;
+    int         count;
+    int         spot;
+    __m128i     vx;
+    __m128i     vy;
+    __m128i     vxstep;
+    __m128i     vystep;
+    __m128i     xmask;
+    __m128i     ymask;
+    __m128i     lo;
+    __m128i     hi;
+    __m128i     spots;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+        || ds_x1 < 0
+        || ds_x2 >= SCREENWIDTH
+        || (unsigned)ds_y > SCREENHEIGHT)
+    {
+        I_Error("R_DrawSpanSSE2: %i to %i at %i", ds_x1, ds_x2, ds_y);
+    }
+#endif
+
+    // unsigned, to wrap around the same way the scalar adds do
+    xfrac = ds_xfrac;
+    yfrac = ds_yfrac;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1 + 1;
+    source = ds_source;
+    colormap = ds_colormap;
+
+    vx = _mm_setr_epi32(xfrac, xfrac + ds_xstep,
+                        xfrac + 2u * ds_xstep, xfrac + 3u * ds_xstep);
+    vy = _mm_setr_epi32(yfrac, yfrac + ds_ystep,
+                        yfrac + 2u * ds_ystep, yfrac + 3u * ds_ystep);
+    vxstep = _mm_set1_epi32(4u * ds_xstep);
+    vystep = _mm_set1_epi32(4u * ds_ystep);
+    xmask = _mm_set1_epi32(63);
+    ymask = _mm_set1_epi32(63 * 64);
+
+    while (count >= 8)
+    {
+        lo = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(vy, 16 - 6), ymask),
+                           _mm_and_si128(_mm_srli_epi32(vx, 16), xmask));
+        vx = _mm_add_epi32(vx, vxstep);
+        vy = _mm_add_epi32(vy, vystep);
+        hi = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(vy, 16 - 6), ymask),
+                           _mm_and_si128(_mm_srli_epi32(vx, 16), xmask));
+        vx = _mm_add_epi32(vx, vxstep);
+        vy = _mm_add_epi32(vy, vystep);
+
+        // offsets are below 4096, so they pack into words
+        spots = _mm_packs_epi32(lo, hi);
+        dest[0] = colormap[source[_mm_extract_epi16(spots, 0)]];
+        dest[1] = colormap[source[_mm_extract_epi16(spots, 1)]];
+        dest[2] = colormap[source[_mm_extract_epi16(spots, 2)]];
+        dest[3] = colormap[source[_mm_extract_epi16(spots, 3)]];
+        dest[4] = colormap[source[_mm_extract_epi16(spots, 4)]];
+        dest[5] = colormap[source[_mm_extract_epi16(spots, 5)]];
+        dest[6] = colormap[source[_mm_extract_epi16(spots, 6)]];
+        dest[7] = colormap[source[_mm_extract_epi16(spots, 7)]];
+        dest += 8;
+        count -= 8;
+    }
+
+    xfrac = _mm_cvtsi128_si32(vx);
+    yfrac = _mm_cvtsi128_si32(vy);
+
+    while (count--)
+    {
+        spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
+        *dest++ = colormap[source[spot]];
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+
+
+//
+// R_DrawSpanAVX2
+// Eight pixels at a time, with gathers for the
+//  texel and colormap lookups.
+//
+AVX2FUNC void R_DrawSpanAVX2(void)
+{
+    unsigned    xfrac;
+    unsigned    yfrac;
+    byte* dest;
+    byte* source;
+    lighttable_t* colormap;
+    int         count;
+    int         spot;
+    __m256i     vx;
+    __m256i     vy;
+    __m256i     vxstep;
+    __m256i     vystep;
+    __m256i     xmask;
+    __m256i     ymask;
+    __m256i     pixels;
+    __m128i     packed;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+        || ds_x1 < 0
+        || ds_x2 >= SCREENWIDTH
+        || (unsigned)ds_y > SCREENHEIGHT)
+    {
+        I_Error("R_DrawSpanAVX2: %i to %i at %i", ds_x1, ds_x2, ds_y);
+    }
+#endif
+
+    xfrac = ds_xfrac;
+    yfrac = ds_yfrac;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1 + 1;
+    source = ds_source;
+    colormap = ds_colormap;
+
+    vx = _mm256_setr_epi32(xfrac, xfrac + ds_xstep,
+                           xfrac + 2u * ds_xstep, xfrac + 3u * ds_xstep,
+                           xfrac + 4u * ds_xstep, xfrac + 5u * ds_xstep,
+                           xfrac + 6u * ds_xstep, xfrac + 7u * ds_xstep);
+    vy = _mm256_setr_epi32(yfrac, yfrac + ds_ystep,
+                           yfrac + 2u * ds_ystep, yfrac + 3u * ds_ystep,
+                           yfrac + 4u * ds_ystep, yfrac + 5u * ds_ystep,
+                           yfrac + 6u * ds_ystep, yfrac + 7u * ds_ystep);
+    vxstep = _mm256_set1_epi32(8u * ds_xstep);
+    vystep = _mm256_set1_epi32(8u * ds_ystep);
+    xmask = _mm256_set1_epi32(63);
+    ymask = _mm256_set1_epi32(63 * 64);
+
+    while (count >= 8)
+    {
+        pixels = _mm256_add_epi32(
+            _mm256_and_si256(_mm256_srli_epi32(vy, 16 - 6), ymask),
+            _mm256_and_si256(_mm256_srli_epi32(vx, 16), xmask));
+        vx = _mm256_add_epi32(vx, vxstep);
+        vy = _mm256_add_epi32(vy, vystep);
+
+        // Each gather reads the dword that ends at the wanted
+        //  byte, so it never reads past the end of the flat or
+        //  colormap. The three bytes in front of them must be
+        //  ours: flats and colormaps are zone blocks, behind
+        //  a block header, and flat mips are behind MIPLEADPAD.
+        //  A span source from anywhere else needs such a pad.
+        pixels = _mm256_srli_epi32(
+            _mm256_i32gather_epi32((const int*)(source - 3), pixels, 1), 24);
+        pixels = _mm256_srli_epi32(
+            _mm256_i32gather_epi32((const int*)(colormap - 3), pixels, 1), 24);
+
+        packed = _mm_packs_epi32(_mm256_castsi256_si128(pixels),
+                                 _mm256_extracti128_si256(pixels, 1));
+        packed = _mm_packus_epi16(packed, packed);
+        _mm_storel_epi64((__m128i*)dest, packed);
+        dest += 8;
+        count -= 8;
+    }
+
+    xfrac = _mm256_cvtsi256_si32(vx);
+    yfrac = _mm256_cvtsi256_si32(vy);
+
+    while (count--)
+    {
+        spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
+        *dest++ = colormap[source[spot]];
+        xfrac += ds_xstep;
+        yfrac += ds_ystep;
+    }
+}
+#endif
+
+
+//
+// R_InitViewWindow
+// Places the view on the screen, centered above
+//  the status bar unless it is full screen.
+//
+void R_InitViewWindow(int blocks)
+{
+    if (blocks == 11)
+    {
+        baseviewwidth = BASE_WIDTH;
+        baseviewheight = BASE_HEIGHT;
+        baseviewy = 0;
+    }
+    else
+    {
+        baseviewwidth = blocks * 32;
+        baseviewheight = (blocks * 168 / 10) & ~7;
+        baseviewy = (BASE_HEIGHT - SBARHEIGHT - baseviewheight) >> 1;
+    }
+    baseviewx = (BASE_WIDTH - baseviewwidth) >> 1;
+
+    viewwindowx = vscalex[baseviewx];
+    viewwindowy = vscaley[baseviewy];
+    viewwindowwidth = vscalex[baseviewx + baseviewwidth] - viewwindowx;
+    viewwindowheight = vscaley[baseviewy + baseviewheight] - viewwindowy;
+}
+
+
 //
 // R_InitBuffer
+// Sets up the drawers for a width by height view,
+//  shown in the window set by R_InitViewWindow.
 //
 void R_InitBuffer(int width, int height)
 {
     int i;
+    int pitch;
+
+    viewbuffered = transposed
+        || width != viewwindowwidth
+        || height != viewwindowheight;
 
-    viewwindowx = (SCREENWIDTH - width) >> 1;
+    R_ForgetView();
 
-    for (i = 0; i < width; i++)
-        columnofs[i] = viewwindowx + i;
+    // the screen size can change after startup, see V_SetScreenSize
+    if (viewbuffered && viewbuffersize < SCREENWIDTH * SCREENHEIGHT)
+    {
+        if (viewbuffer)
+            Z_Free(viewbuffer);
+        viewbuffersize = SCREENWIDTH * SCREENHEIGHT;
+        viewbuffer = Z_Malloc(viewbuffersize, PU_STATIC, 0);
+    }
 
-    if (width == SCREENWIDTH)
-        viewwindowy = 0;
+    if (transposed)
+    {
+        // Column x of the view starts at viewbuffer
+        //  + x*SCREENHEIGHT.
+        for (i = 0; i < width; i++)
+            columnofs[i] = i * SCREENHEIGHT;
+        for (i = 0; i < height; i++)
+            ylookup[i] = viewbuffer + i;
+
+        colstep = 1;
+        spanstep = SCREENHEIGHT;
+    }
+    else if (viewbuffered)
+    {
+        for (i = 0; i < width; i++)
+            columnofs[i] = i;
+        for (i = 0; i < height; i++)
+            ylookup[i] = viewbuffer + i * SCREENWIDTH;
+
+        colstep = SCREENWIDTH;
+        spanstep = 1;
+    }
     else
-        viewwindowy = (SCREENHEIGHT - SBARHEIGHT - height) >> 1;
+    {
+        for (i = 0; i < width; i++)
+            columnofs[i] = viewwindowx + i;
+        for (i = 0; i < height; i++)
+            ylookup[i] = screens[0] + (i + viewwindowy) * SCREENWIDTH;
 
-    for (i = 0; i < height; i++)
-        ylookup[i] = screens[0] + (i + viewwindowy) * SCREENWIDTH;
+        colstep = SCREENWIDTH;
+        spanstep = 1;
+    }
+
+    // nearest pixel stretch, a straight copy at full size
+    pitch = transposed ? SCREENHEIGHT : 1;
+    for (i = 0; i < viewwindowwidth; i++)
+        viewsrccol[i] = i * width / viewwindowwidth * pitch;
+    pitch = transposed ? 1 : SCREENWIDTH;
+    for (i = 0; i < viewwindowheight; i++)
+        viewsrcrow[i] = i * height / viewwindowheight * pitch;
+
+    // the fuzz effect samples the pixels above and below
+    for (i = 0; i < FUZZTABLE; i++)
+        fuzzoffset[i] = fuzzoffset[i] > 0 ? colstep : -colstep;
+}
+
+
+//
+// R_FinishView
+// Copies columns x1 to x2-1 of the buffered view to
+//  screens[0], stretched to the window, in blocks
+//  that fit in the cache both ways.
+//
+#define FINISHBLOCK     16
+
+void R_FinishView(int x1, int x2)
+{
+    int         bx;
+    int         by;
+    int         ex;
+    int         ey;
+    int         x;
+    int         y;
+    byte* src;
+    byte* dest;
+
+    // window columns stretched from x1 to x2-1
+    x1 = (x1 * viewwindowwidth + scaledviewwidth - 1) / scaledviewwidth;
+    x2 = (x2 * viewwindowwidth + scaledviewwidth - 1) / scaledviewwidth;
+
+    for (bx = x1; bx < x2; bx += FINISHBLOCK)
+    {
+        ex = bx + FINISHBLOCK;
+        if (ex > x2)
+            ex = x2;
+
+        for (by = 0; by < viewwindowheight; by += FINISHBLOCK)
+        {
+            ey = by + FINISHBLOCK;
+            if (ey > viewwindowheight)
+                ey = viewwindowheight;
+
+            for (y = by; y < ey; y++)
+            {
+                src = viewbuffer + viewsrcrow[y];
+                dest = screens[0] + (viewwindowy + y) * SCREENWIDTH + viewwindowx;
+
+                for (x = bx; x < ex; x++)
+                    dest[x] = src[viewsrccol[x]];
+            }
+        }
+    }
 }
 
 
@@ -386,13 +1440,17 @@ void R_FillBackScreen(void)
     byte* dest;
     int     x;
     int     y;
+    int     x1;
+    int     y1;
+    int     x2;
+    int     y2;
     patch_t* patch;
 
     char name1[] = "FLOOR7_2";
     char name2[] = "GRNROCK";
     char* name;
 
-    if (scaledviewwidth == 320)
+    if (viewwindowwidth == SCREENWIDTH)
         return;
 
     name = (gamemode == commercial) ? name2 : name1;
@@ -400,7 +1458,7 @@ void R_FillBackScreen(void)
     src = W_CacheLumpName(name, PU_CACHE);
     dest = screens[1];
 
-    for (y = 0; y < SCREENHEIGHT - SBARHEIGHT; y++)
+    for (y = 0; y < vscaley[BASE_HEIGHT - SBARHEIGHT]; y++)
     {
         for (x = 0; x < SCREENWIDTH / 64; x++)
         {
@@ -414,64 +1472,82 @@ void R_FillBackScreen(void)
         }
     }
 
+    // the patches go on in BASE_WIDTH by BASE_HEIGHT units
+    x1 = baseviewx;
+    y1 = baseviewy;
+    x2 = baseviewx + baseviewwidth;
+    y2 = baseviewy + baseviewheight;
+
     patch = W_CacheLumpName("brdr_t", PU_CACHE);
-    for (x = 0; x < scaledviewwidth; x += 8)
-        V_DrawPatch(viewwindowx + x, viewwindowy - 8, 1, patch);
+    for (x = x1; x < x2; x += 8)
+        V_DrawPatch(x, y1 - 8, 1, patch);
     patch = W_CacheLumpName("brdr_b", PU_CACHE);
-    for (x = 0; x < scaledviewwidth; x += 8)
-        V_DrawPatch(viewwindowx + x, viewwindowy + viewheight, 1, patch);
+    for (x = x1; x < x2; x += 8)
+        V_DrawPatch(x, y2, 1, patch);
     patch = W_CacheLumpName("brdr_l", PU_CACHE);
-    for (y = 0; y < viewheight; y += 8)
-        V_DrawPatch(viewwindowx - 8, viewwindowy + y, 1, patch);
+    for (y = y1; y < y2; y += 8)
+        V_DrawPatch(x1 - 8, y, 1, patch);
     patch = W_CacheLumpName("brdr_r", PU_CACHE);
-    for (y = 0; y < viewheight; y += 8)
-        V_DrawPatch(viewwindowx + scaledviewwidth, viewwindowy + y, 1, patch);
+    for (y = y1; y < y2; y += 8)
+        V_DrawPatch(x2, y, 1, patch);
 
-    V_DrawPatch(viewwindowx - 8, viewwindowy - 8, 1,
+    V_DrawPatch(x1 - 8, y1 - 8, 1,
         W_CacheLumpName("brdr_tl", PU_CACHE));
-    V_DrawPatch(viewwindowx + scaledviewwidth, viewwindowy - 8, 1,
+    V_DrawPatch(x2, y1 - 8, 1,
         W_CacheLumpName("brdr_tr", PU_CACHE));
-    V_DrawPatch(viewwindowx - 8, viewwindowy + viewheight, 1,
+    V_DrawPatch(x1 - 8, y2, 1,
         W_CacheLumpName("brdr_bl", PU_CACHE));
-    V_DrawPatch(viewwindowx + scaledviewwidth, viewwindowy + viewheight, 1,
+    V_DrawPatch(x2, y2, 1,
         W_CacheLumpName("brdr_br", PU_CACHE));
 }
 
 
+void V_MarkRect(int x, int y, int width, int height);
+
 void R_VideoErase(unsigned ofs, int count)
 {
-    memcpy(screens[0] + ofs, screens[1] + ofs, count);
-}
+    int x;
+    int y;
 
+    memcpy(screens[0] + ofs, screens[1] + ofs, count);
 
-void V_MarkRect(int x, int y, int width, int height);
+    if (count <= 0)
+        return;
+    x = ofs % SCREENWIDTH;
+    y = ofs / SCREENWIDTH;
+    if (x + count <= SCREENWIDTH)
+        V_MarkRect(x, y, count, 1);
+    else
+        V_MarkRect(0, y, SCREENWIDTH,
+                   (x + count + SCREENWIDTH - 1) / SCREENWIDTH);
+}
 
 void R_DrawViewBorder(void)
 {
     int top;
+    int bottom;
     int side;
     int ofs;
     int i;
 
-    if (scaledviewwidth == SCREENWIDTH)
+    if (viewwindowwidth == SCREENWIDTH)
         return;
 
-    top = ((SCREENHEIGHT - SBARHEIGHT) - viewheight) / 2;
-    side = (SCREENWIDTH - scaledviewwidth) / 2;
-
-    R_VideoErase(0, top * SCREENWIDTH + side);
+    top = viewwindowy;
+    bottom = viewwindowy + viewwindowheight;
+    side = viewwindowx + viewwindowwidth;
 
-    ofs = (viewheight + top) * SCREENWIDTH - side;
-    R_VideoErase(ofs, top * SCREENWIDTH + side);
+    R_VideoErase(0, top * SCREENWIDTH);
 
-    ofs = top * SCREENWIDTH + SCREENWIDTH - side;
-    side <<= 1;
+    ofs = bottom * SCREENWIDTH;
+    R_VideoErase(ofs, (vscaley[BASE_HEIGHT - SBARHEIGHT] - bottom) * SCREENWIDTH);
 
-    for (i = 1; i < viewheight; i++)
+    // the sides, which may be a pixel apart in width
+    for (i = top, ofs = top * SCREENWIDTH; i < bottom; i++, ofs += SCREENWIDTH)
     {
-        R_VideoErase(ofs, side);
-        ofs += SCREENWIDTH;
+        R_VideoErase(ofs, viewwindowx);
+        R_VideoErase(ofs + side, SCREENWIDTH - side);
     }
 
-    V_MarkRect(0, 0, SCREENWIDTH, SCREENHEIGHT - SBARHEIGHT);
-}
\ No newline at end of file
+    V_MarkRect(0, 0, SCREENWIDTH, vscaley[BASE_HEIGHT - SBARHEIGHT]);
+}
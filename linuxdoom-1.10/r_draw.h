@@ -29,15 +29,18 @@
 #endif
 
 
-extern lighttable_t*	dc_colormap;
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
+extern THREADLOCAL lighttable_t*	dc_colormap;
+extern THREADLOCAL int		dc_x;
+extern THREADLOCAL int		dc_yl;
+extern THREADLOCAL int		dc_yh;
+extern THREADLOCAL fixed_t		dc_iscale;
+extern THREADLOCAL fixed_t		dc_texturemid;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern THREADLOCAL byte*		dc_source;		
+
+// column height less one, for R_DrawColumnWrap
+extern THREADLOCAL int		dc_heightmask;
 
 
 // The span blitting interface.
@@ -46,6 +49,24 @@ extern byte*		dc_source;
 void 	R_DrawColumn (void);
 void 	R_DrawColumnLow (void);
 
+// R_DrawColumn specialized for what is known about
+//  the run before it is drawn. Cleared by -novariants,
+//  which keeps the generic drawers everywhere.
+extern boolean		drawvariants;
+
+// The run stays inside the column.
+void	R_DrawColumnInside (void);
+void	R_DrawColumnLowInside (void);
+
+// The run tiles a column dc_heightmask+1 high,
+//  a power of two.
+void	R_DrawColumnWrap (void);
+void	R_DrawColumnLowWrap (void);
+
+// Sets colfunc for the run in dc_*, out of
+//  a column height texels high.
+void	R_PickColumnFunc (int height);
+
 // The Spectre/Invisibility effect.
 void 	R_DrawFuzzColumn (void);
 void 	R_DrawFuzzColumnLow (void);
@@ -56,27 +77,80 @@ void 	R_DrawFuzzColumnLow (void);
 void	R_DrawTranslatedColumn (void);
 void	R_DrawTranslatedColumnLow (void);
 
+// Translation 1 to 3, see MF_TRANSLATION, followed
+//  by colormap, as one colormap, so translated
+//  columns go to the plain drawers.
+lighttable_t*
+R_TranslatedColormap
+( int		translation,
+  lighttable_t*	colormap );
+
+// Adjacent R_DrawColumn columns, staged to be
+//  drawn four at a time.
+#define BATCHCOLUMNS	4
+
+typedef struct
+{
+    int			x;
+    int			yl;
+    int			yh;
+    fixed_t		iscale;
+    fixed_t		texturemid;
+    byte*		source;
+    lighttable_t*	colormap;
+    int			heightmask;	// -1 unless it wraps
+
+} stagedcolumn_t;
+
+typedef struct
+{
+    int			count;
+    stagedcolumn_t	columns[BATCHCOLUMNS];
+
+} colbatch_t;
+
+// Set per strip, when basecolfunc is R_DrawColumn
+//  and adjacent columns are adjacent in memory.
+extern THREADLOCAL boolean	batchcolumns;
+
+// Same as colfunc(), but R_DrawColumn columns, and
+//  their Inside and Wrap variants, are staged and only
+//  drawn by a later call or flush.
+// Whatever they draw from has to stay in memory
+//  until then, see R_StartCachePins.
+void	R_BatchColumn (colbatch_t* batch);
+void	R_FlushColumns (colbatch_t* batch);
+
+// With -sortwalls, wall columns are queued for the
+//  whole strip instead, and R_DrawQueuedColumns draws
+//  them grouped by texture, then by x.
+// texture is anything that tells the sources apart.
+extern boolean		sortwalls;
+
+void	R_QueueColumn (int texture);
+void	R_DrawQueuedColumns (void);
+
 void
 R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern THREADLOCAL int		ds_y;
+extern THREADLOCAL int		ds_x1;
+extern THREADLOCAL int		ds_x2;
 
-extern lighttable_t*	ds_colormap;
+extern THREADLOCAL lighttable_t*	ds_colormap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern THREADLOCAL fixed_t		ds_xfrac;
+extern THREADLOCAL fixed_t		ds_yfrac;
+extern THREADLOCAL fixed_t		ds_xstep;
+extern THREADLOCAL fixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern THREADLOCAL byte*		ds_source;		
 
 extern byte*		translationtables;
-extern byte*		dc_translation;
+extern THREADLOCAL byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -86,12 +160,41 @@ void 	R_DrawSpan (void);
 // Low resolution mode, 160x200?
 void 	R_DrawSpanLow (void);
 
+// The same for spans written left to right in
+//  memory, when the view is not transposed.
+void	R_DrawSpanRow (void);
+void	R_DrawSpanLowRow (void);
+
+// Vector versions of R_DrawSpan, picked at runtime
+//  by what the CPU supports. Same pixels exactly.
+#if defined(__x86_64__) || defined(_M_X64) \
+    || (defined(__i386__) && defined(__SSE2__))
+#define R_SIMD
+void	R_DrawSpanSSE2 (void);
+void	R_DrawSpanAVX2 (void);
+#endif
+
+
+// Sets viewwindowx/y/width/height, in native pixels,
+//  for the given screenblocks.
+void	R_InitViewWindow (int blocks);
 
 void
 R_InitBuffer
 ( int		width,
   int		height );
 
+// Column-major view drawing, set with -transpose.
+extern boolean		transposed;
+
+// Set by R_InitBuffer when the view is not drawn
+//  straight into its window on screens[0].
+extern boolean		viewbuffered;
+
+// Copies columns x1 to x2-1 of the view to screens[0],
+//  stretched to the window, when it was buffered.
+void	R_FinishView (int x1, int x2);
+
 
 // Initialize color translation tables,
 //  for player rendering etc.
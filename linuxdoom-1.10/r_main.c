@@ -33,12 +33,20 @@ static const char rcsid[] = "$Id: r_main.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 
 
 #include "doomdef.h"
+#include "doomstat.h"
 #include "d_net.h"
 
+#include "m_argv.h"
 #include "m_bbox.h"
 
+#include "i_system.h"
+#include "i_thread.h"
+
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_pvs.h"
+#include "r_reuse.h"
+#include "r_capture.h"
 
 
 
@@ -56,7 +64,7 @@ int			validcount = 1;
 
 
 lighttable_t*		fixedcolormap;
-extern lighttable_t**	walllights;
+extern THREADLOCAL lighttable_t**	walllights;
 
 int			centerx;
 int			centery;
@@ -68,9 +76,9 @@ fixed_t			projection;
 // just for profiling purposes
 int			framecount;	
 
-int			sscount;
-int			linecount;
-int			loopcount;
+THREADLOCAL int			sscount;
+THREADLOCAL int			linecount;
+THREADLOCAL int			loopcount;
 
 fixed_t			viewx;
 fixed_t			viewy;
@@ -100,7 +108,7 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+angle_t			xtoviewangle[MAXWIDTH+1];
 
 
 // UNUSED.
@@ -120,13 +128,26 @@ lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
 // bumped light from gun blasts
 int			extralight;			
 
+// How far between the previous and the current tic
+//  the frame is drawn, FRACUNIT for the current tic.
+fixed_t			fractionaltic = FRACUNIT;
+
+// Number of vertical strips the view is split into,
+//  each drawn by its own thread. Set with -rthreads.
+int			numrenderthreads = 1;
+
+// Columns [stripstart,stripend) of the current thread's strip.
+THREADLOCAL int		stripstart;
+THREADLOCAL int		stripend;
 
 
-void (*colfunc) (void);
+
+THREADLOCAL void (*colfunc) (void);
 void (*basecolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
 void (*spanfunc) (void);
+void (*columnfuncs[NUMCOLUMNFUNCS]) (void);
 
 
 
@@ -626,7 +647,7 @@ void R_InitLightTables (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTZ ; j++)
 	{
-	    scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
+	    scale = FixedDiv ((BASE_WIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
 	    scale >>= LIGHTSCALESHIFT;
 	    level = startmap - scale/DISTMAP;
 	    
@@ -665,6 +686,28 @@ R_SetViewSize
 }
 
 
+//
+// R_SetRenderScale
+// Same as R_SetViewSize, for the size the view
+//  is rendered at within its window.
+//
+int		renderscale = FULLRENDERSCALE;
+
+void R_SetRenderScale (int scale)
+{
+    if (scale < MINRENDERSCALE)
+	scale = MINRENDERSCALE;
+    if (scale > FULLRENDERSCALE)
+	scale = FULLRENDERSCALE;
+
+    if (scale != renderscale)
+    {
+	setsizeneeded = true;
+	renderscale = scale;
+    }
+}
+
+
 //
 // R_ExecuteSetViewSize
 //
@@ -679,18 +722,15 @@ void R_ExecuteSetViewSize (void)
 
     setsizeneeded = false;
 
-    if (setblocks == 11)
-    {
-	scaledviewwidth = SCREENWIDTH;
-	viewheight = SCREENHEIGHT;
-    }
-    else
-    {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
-    }
-    
+    // The view is drawn at renderscale eighths of the
+    //  window it shows in, then stretched to fit.
+    R_InitViewWindow (setblocks);
+    scaledviewwidth = viewwindowwidth*renderscale/FULLRENDERSCALE;
+    viewheight = viewwindowheight*renderscale/FULLRENDERSCALE;
+
     detailshift = setdetail;
+    if (detailshift)
+	scaledviewwidth &= ~1;
     viewwidth = scaledviewwidth>>detailshift;
 	
     centery = viewheight/2;
@@ -705,6 +745,10 @@ void R_ExecuteSetViewSize (void)
 	fuzzcolfunc = R_DrawFuzzColumn;
 	transcolfunc = R_DrawTranslatedColumn;
 	spanfunc = R_DrawSpan;
+	columnfuncs[COLUMN_INSIDE] = R_DrawColumnInside;
+	columnfuncs[COLUMN_WRAP] = R_DrawColumnWrap;
+	if (drawvariants && !transposed)
+	    spanfunc = R_DrawSpanRow;
     }
     else
     {
@@ -712,15 +756,34 @@ void R_ExecuteSetViewSize (void)
 	fuzzcolfunc = R_DrawFuzzColumn;
 	transcolfunc = R_DrawTranslatedColumn;
 	spanfunc = R_DrawSpanLow;
+	columnfuncs[COLUMN_INSIDE] = R_DrawColumnLowInside;
+	columnfuncs[COLUMN_WRAP] = R_DrawColumnLowWrap;
+	if (drawvariants && !transposed)
+	    spanfunc = R_DrawSpanLowRow;
+    }
+
+    if (!drawvariants)
+	columnfuncs[COLUMN_INSIDE] = columnfuncs[COLUMN_WRAP] = basecolfunc;
+
+#ifdef R_SIMD
+    // vector span drawers write contiguous pixels,
+    //  -nosimd keeps the reference R_DrawSpan
+    if (!detailshift && !transposed && !M_CheckParm ("-nosimd"))
+    {
+	if (I_CPUFeatures () & CPU_AVX2)
+	    spanfunc = R_DrawSpanAVX2;
+	else if (I_CPUFeatures () & CPU_SSE2)
+	    spanfunc = R_DrawSpanSSE2;
     }
+#endif
 
     R_InitBuffer (scaledviewwidth, viewheight);
 	
     R_InitTextureMapping ();
     
     // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    pspritescale = FRACUNIT*viewwidth/BASE_WIDTH;
+    pspriteiscale = FRACUNIT*BASE_WIDTH/viewwidth;
     
     // thing clipping
     for (i=0 ; i<viewwidth ; i++)
@@ -747,7 +810,7 @@ void R_ExecuteSetViewSize (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTSCALE ; j++)
 	{
-	    level = startmap - j*SCREENWIDTH/(viewwidth<<detailshift)/DISTMAP;
+	    level = startmap - j*BASE_WIDTH/(viewwidth<<detailshift)/DISTMAP;
 	    
 	    if (level < 0)
 		level = 0;
@@ -762,6 +825,31 @@ void R_ExecuteSetViewSize (void)
 
 
 
+//
+// R_InitThreads
+// -rthreads <n> splits the view into n strips,
+//  -rthreads 0 uses one strip per processor.
+//
+void R_InitThreads (void)
+{
+    int		p;
+
+    p = M_CheckParm ("-rthreads");
+    if (!p || p >= myargc-1)
+	return;
+
+    numrenderthreads = atoi (myargv[p+1]);
+    if (numrenderthreads < 1)
+	numrenderthreads = I_NumCPUs ();
+    if (numrenderthreads > MAXTHREADS)
+	numrenderthreads = MAXTHREADS;
+
+    I_InitThreads (numrenderthreads);
+    numrenderthreads = I_NumThreads ();
+}
+
+
+
 //
 // R_Init
 //
@@ -772,6 +860,8 @@ extern int	screenblocks;
 
 void R_Init (void)
 {
+    int		p;
+
     R_InitData ();
     printf ("\nR_InitData");
     R_InitPointToAngle ();
@@ -780,6 +870,17 @@ void R_Init (void)
     // viewwidth / viewheight / detailLevel are set by the defaults
     printf ("\nR_InitTables");
 
+    // -transpose draws the view column-major, see R_InitBuffer
+    transposed = M_CheckParm ("-transpose");
+    // -sortwalls draws wall columns grouped by texture
+    sortwalls = M_CheckParm ("-sortwalls");
+    viewreuse = !M_CheckParm ("-noreuse");
+    // -novariants keeps the generic column and span drawers
+    drawvariants = !M_CheckParm ("-novariants");
+    // -capture <tic> writes what that tic's frame is drawn from
+    p = M_CheckParm ("-capture");
+    if (p && p < myargc-1)
+	capturetic = atoi (myargv[p+1]);
     R_SetViewSize (screenblocks, detailLevel);
     R_InitPlanes ();
     printf ("\nR_InitPlanes");
@@ -789,6 +890,8 @@ void R_Init (void)
     printf ("\nR_InitSkyMap");
     R_InitTranslationTables ();
     printf ("\nR_InitTranslationsTables");
+    R_InitThreads ();
+    printf ("\nR_InitThreads");
 	
     framecount = 0;
 }
@@ -824,34 +927,132 @@ R_PointInSubsector
 
 
 
+//
+// R_Interpolate
+// Value in between the last two tics.
+//
+fixed_t
+R_Interpolate
+( fixed_t	oldvalue,
+  fixed_t	value )
+{
+    return oldvalue + FixedMul (value-oldvalue, fractionaltic);
+}
+
+
+
+//
+// R_InterpolateSectors
+// Moves the sectors that changed height in the last tic
+//  to where they were at fractionaltic, for the frame only.
+// R_RestoreSectors puts them back before the game sees them.
+//
+typedef struct
+{
+    sector_t*	sector;
+    fixed_t	floorheight;
+    fixed_t	ceilingheight;
+    
+} movedsector_t;
+
+movedsector_t*	movedsectors;
+int		nummovedsectors;
+int		maxmovedsectors;
+
+void R_InterpolateSectors (void)
+{
+    sector_t*		sec;
+    movedsector_t*	moved;
+    int			i;
+
+    nummovedsectors = 0;
+    
+    if (fractionaltic >= FRACUNIT)
+	return;
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	if (sec->floorheight == sec->oldfloorheight
+	    && sec->ceilingheight == sec->oldceilingheight)
+	    continue;
+
+	if (nummovedsectors == maxmovedsectors)
+	{
+	    maxmovedsectors = maxmovedsectors ? maxmovedsectors*2 : 64;
+	    movedsectors = realloc (movedsectors,
+				    maxmovedsectors*sizeof(*movedsectors));
+	    if (!movedsectors)
+		I_Error ("R_InterpolateSectors: no memory");
+	}
+
+	moved = &movedsectors[nummovedsectors++];
+	moved->sector = sec;
+	moved->floorheight = sec->floorheight;
+	moved->ceilingheight = sec->ceilingheight;
+	
+	sec->floorheight = R_Interpolate (sec->oldfloorheight,
+					  sec->floorheight);
+	sec->ceilingheight = R_Interpolate (sec->oldceilingheight,
+					    sec->ceilingheight);
+    }
+}
+
+void R_RestoreSectors (void)
+{
+    movedsector_t*	moved;
+    int			i;
+
+    for (i=0, moved=movedsectors ; i<nummovedsectors ; i++, moved++)
+    {
+	moved->sector->floorheight = moved->floorheight;
+	moved->sector->ceilingheight = moved->ceilingheight;
+    }
+    
+    nummovedsectors = 0;
+}
+
+
+
 //
 // R_SetupFrame
 //
 void R_SetupFrame (player_t* player)
 {		
     int		i;
+    mobj_t*	mo;
     
     viewplayer = player;
-    viewx = player->mo->x;
-    viewy = player->mo->y;
-    viewangle = player->mo->angle + viewangleoffset;
-    extralight = player->extralight;
+    mo = player->mo;
+    
+    if (fractionaltic < FRACUNIT)
+    {
+	viewx = R_Interpolate (mo->oldx, mo->x);
+	viewy = R_Interpolate (mo->oldy, mo->y);
+	viewangle = mo->oldangle + viewangleoffset
+	    + FixedMul (mo->angle-mo->oldangle, fractionaltic);
+	viewz = R_Interpolate (player->oldviewz, player->viewz);
+    }
+    else
+    {
+	viewx = mo->x;
+	viewy = mo->y;
+	viewangle = mo->angle + viewangleoffset;
+	viewz = player->viewz;
+    }
+    
+    R_SetupPVS ();
 
-    viewz = player->viewz;
+    extralight = player->extralight;
     
     viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
     viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
 	
-    sscount = 0;
-	
     if (player->fixedcolormap)
     {
 	fixedcolormap =
 	    colormaps
 	    + player->fixedcolormap*256*sizeof(lighttable_t);
 	
-	walllights = scalelightfixed;
-
 	for (i=0 ; i<MAXLIGHTSCALE ; i++)
 	    scalelightfixed[i] = fixedcolormap;
     }
@@ -864,12 +1065,155 @@ void R_SetupFrame (player_t* player)
 
 
 
+//
+// R_SetupStrip
+// Per thread part of the frame setup, for the
+//  thread local state the R_Clear* calls leave alone.
+//
+void R_SetupStrip (int start, int stop)
+{
+    stripstart = start;
+    stripend = stop;
+
+    colfunc = basecolfunc;
+    batchcolumns = basecolfunc == R_DrawColumn && !transposed;
+    
+    if (fixedcolormap)
+	walllights = scalelightfixed;
+
+    sscount = 0;
+}
+
+
+
+//
+// R_RenderStripWalls
+// The BSP walk and the walls of one strip. Its planes
+//  are left for R_DrawSharedPlanes, and the rest for
+//  R_RenderStripMasked, on the same thread.
+// The first strip is drawn by the main thread.
+//
+void R_RenderStripWalls (int strip)
+{
+    R_SetupStrip (viewwidth*strip/numrenderthreads,
+		  viewwidth*(strip+1)/numrenderthreads);
+    R_StartDrawnSubsectors (strip);
+
+    R_ClearClipSegs ();
+    R_ClearDrawSegs ();
+    R_ClearPlanes ();
+    R_ClearSprites ();
+
+    R_RenderBSPNode (numnodes-1);
+    R_FlushWallColumns ();
+    R_PublishPlanes (strip);
+    R_PublishDrawSegs (strip);
+}
+
+
+//
+// R_RenderStripMasked
+//
+void R_RenderStripMasked (int strip)
+{
+    R_DrawMasked ();
+
+    if (viewbuffered)
+	R_FinishView (stripstart<<detailshift, stripend<<detailshift);
+
+    R_FinishDrawnSubsectors (strip);
+}
+
+
+
+//
+// R_PhaseTime
+// Adds the time since the last call to phasetime[phase].
+//
+double		phasetime[NUMRENDERPHASES];
+int		phaseframes;
+
+static unsigned	phasestart;
+
+static void R_PhaseTime (int phase)
+{
+    unsigned	now;
+
+    now = I_GetTimeUS ();
+    if (phase >= 0)
+	phasetime[phase] += now - phasestart;
+    phasestart = now;
+}
+
+
+//
+// R_PrintPhaseTimes
+//
+void R_PrintPhaseTimes (void)
+{
+    int		frames;
+
+    frames = phaseframes ? phaseframes : 1;
+    printf ("R_PrintPhaseTimes: %i frames, %i strips, per frame: "
+	    "walls %.3f ms, planes %.3f ms, masked %.3f ms\n",
+	    phaseframes, numrenderthreads,
+	    phasetime[PHASE_WALLS]/1000/frames,
+	    phasetime[PHASE_PLANES]/1000/frames,
+	    phasetime[PHASE_MASKED]/1000/frames);
+}
+
+
+
 //
 // R_RenderView
 //
 void R_RenderPlayerView (player_t* player)
 {	
     R_SetupFrame (player);
+    R_InterpolateSectors ();
+
+    if (gametic == capturetic)
+	R_CaptureFrame ();
+
+    // nothing it was drawn from has changed?
+    if (R_ReuseView ())
+    {
+	R_RestoreSectors ();
+	return;
+    }
+
+    if (numrenderthreads > 1)
+    {
+	// check for new console commands.
+	NetUpdate ();
+
+	// Lumps and composites the strips cache stay
+	//  pinned in the zone until all strips are done.
+	R_StartCachePins ();
+	R_PhaseTime (-1);
+	I_RunParallel (R_RenderStripWalls, numrenderthreads);
+	R_PhaseTime (PHASE_WALLS);
+	R_MapDrawnLines (numrenderthreads);
+	R_SharePlanes (numrenderthreads);
+	I_RunParallel (R_DrawSharedPlanes, numrenderthreads);
+	R_PhaseTime (PHASE_PLANES);
+	I_RunParallel (R_RenderStripMasked, numrenderthreads);
+	R_PhaseTime (PHASE_MASKED);
+	phaseframes++;
+	R_ReleaseCachePins ();
+	R_SaveView (numrenderthreads);
+	R_RestoreSectors ();
+	
+	// Check for new console commands.
+	NetUpdate ();
+	return;
+    }
+
+    // Batched columns are drawn after other lookups,
+    //  so nothing may be purged until the frame is done.
+    R_StartCachePins ();
+    R_SetupStrip (0, viewwidth);
+    R_StartDrawnSubsectors (0);
 
     // Clear buffers.
     R_ClearClipSegs ();
@@ -881,18 +1225,36 @@ void R_RenderPlayerView (player_t* player)
     NetUpdate ();
 
     // The head node is the last node output.
+    R_PhaseTime (-1);
     R_RenderBSPNode (numnodes-1);
+    R_FlushWallColumns ();
+    R_PhaseTime (PHASE_WALLS);
+    R_PublishDrawSegs (0);
+    R_MapDrawnLines (1);
     
     // Check for new console commands.
     NetUpdate ();
     
+    R_PhaseTime (-1);
     R_DrawPlanes ();
+    R_PhaseTime (PHASE_PLANES);
     
     // Check for new console commands.
     NetUpdate ();
     
+    R_PhaseTime (-1);
     R_DrawMasked ();
 
+    if (viewbuffered)
+	R_FinishView (0, scaledviewwidth);
+    R_PhaseTime (PHASE_MASKED);
+    phaseframes++;
+
+    R_FinishDrawnSubsectors (0);
+    R_ReleaseCachePins ();
+    R_SaveView (1);
+    R_RestoreSectors ();
+
     // Check for new console commands.
     NetUpdate ();				
 }
@@ -42,6 +42,8 @@ extern int		viewwidth;
 extern int		viewheight;
 extern int		viewwindowx;
 extern int		viewwindowy;
+extern int		viewwindowwidth;
+extern int		viewwindowheight;
 
 
 
@@ -54,8 +56,21 @@ extern fixed_t		projection;
 
 extern int		validcount;
 
-extern int		linecount;
-extern int		loopcount;
+// Bumped by R_SetupFrame, for per frame caches.
+extern int		framecount;
+
+// Where in between the last two tics
+//  the frame is drawn, see D_Display.
+extern fixed_t		fractionaltic;
+
+// Render threads, and the strip of columns
+//  the calling thread is drawing.
+extern int		numrenderthreads;
+extern THREADLOCAL int	stripstart;
+extern THREADLOCAL int	stripend;
+
+extern THREADLOCAL int		linecount;
+extern THREADLOCAL int		loopcount;
 
 
 //
@@ -97,12 +112,24 @@ extern	int		detailshift;
 // Function pointers to switch refresh/drawing functions.
 // Used to select shadow mode etc.
 //
-extern void		(*colfunc) (void);
+extern THREADLOCAL void	(*colfunc) (void);
 extern void		(*basecolfunc) (void);
 extern void		(*fuzzcolfunc) (void);
 // No shadow effects on floors.
 extern void		(*spanfunc) (void);
 
+// Column drawers for what is known about a run
+//  before it is drawn, for the detail level,
+//  see R_PickColumnFunc.
+enum
+{
+    COLUMN_INSIDE,	// stays inside the column
+    COLUMN_WRAP,	// tiles a power of two high column
+    NUMCOLUMNFUNCS
+};
+
+extern void		(*columnfuncs[NUMCOLUMNFUNCS]) (void);
+
 
 //
 // Utility functions.
@@ -143,6 +170,11 @@ R_PointInSubsector
 ( fixed_t	x,
   fixed_t	y );
 
+fixed_t
+R_Interpolate
+( fixed_t	oldvalue,
+  fixed_t	value );
+
 void
 R_AddPointToBox
 ( int		x,
@@ -158,12 +190,43 @@ R_AddPointToBox
 // Called by G_Drawer.
 void R_RenderPlayerView (player_t *player);
 
+// Thread local frame setup, and the refresh of
+//  a single strip, in two parts with the planes of
+//  all strips in between. Called by R_RenderPlayerView.
+void R_SetupStrip (int start, int stop);
+void R_RenderStripWalls (int strip);
+void R_RenderStripMasked (int strip);
+
+// Time spent in each phase of the refresh, in
+//  microseconds summed over phaseframes frames.
+enum
+{
+    PHASE_WALLS,	// BSP walk and walls
+    PHASE_PLANES,
+    PHASE_MASKED,	// sprites, masked walls, weapon
+    NUMRENDERPHASES
+};
+
+extern double		phasetime[NUMRENDERPHASES];
+extern int		phaseframes;
+
+void R_PrintPhaseTimes (void);
+
 // Called by startup code.
 void R_Init (void);
 
 // Called by M_Responder.
 void R_SetViewSize (int blocks, int detail);
 
+// The view is rendered at renderscale eighths of its
+//  window and stretched to fit, see D_GovernFrame.
+#define FULLRENDERSCALE		8
+#define MINRENDERSCALE		4
+
+extern int		renderscale;
+
+void R_SetRenderScale (int scale);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -27,9 +27,11 @@
 static const char
 rcsid[] = "$Id: r_plane.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "i_system.h"
+#include "i_thread.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -49,16 +51,27 @@ planefunction_t		ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES	128
-visplane_t		visplanes[MAXVISPLANES];
-visplane_t* lastvisplane;
-visplane_t* floorplane;
-visplane_t* ceilingplane;
+// Planes are allocated one at a time and kept from
+//  frame to frame, so that pointers to them stay valid
+//  while the list grows.
+THREADLOCAL visplane_t**	visplanes;
+THREADLOCAL visplane_t**	lastvisplane;
+THREADLOCAL int			maxvisplanes;
+THREADLOCAL visplane_t* floorplane;
+THREADLOCAL visplane_t* ceilingplane;
 
-// ?
-#define MAXOPENINGS	SCREENWIDTH*64
-short			openings[MAXOPENINGS];
-short* lastopening;
+// R_FindPlane looks planes up by height, picnum
+//  and lightlevel instead of scanning the list.
+#define VISPLANEHASHSIZE	256
+#define VISPLANEHASH(h,p,l)	\
+	((unsigned)((h)>>FRACBITS) + (unsigned)(p)*37 + (unsigned)(l)*7)
+
+THREADLOCAL visplane_t*		visplanehash[VISPLANEHASHSIZE];
+
+// Grown as needed, see R_CheckOpenings.
+THREADLOCAL short*			openings;
+THREADLOCAL short* lastopening;
+THREADLOCAL int			maxopenings;
 
 
 //
@@ -66,31 +79,38 @@ short* lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+THREADLOCAL short			floorclip[MAXWIDTH];
+THREADLOCAL short			ceilingclip[MAXWIDTH];
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+THREADLOCAL int			spanstart[MAXHEIGHT];
+THREADLOCAL int			spanstop[MAXHEIGHT];
 
 //
 // texture mapping
 //
-lighttable_t** planezlight;
-fixed_t			planeheight;
+THREADLOCAL lighttable_t** planezlight;
+THREADLOCAL fixed_t			planeheight;
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
-fixed_t			basexscale;
-fixed_t			baseyscale;
+fixed_t			yslope[MAXHEIGHT];
+fixed_t			distscale[MAXWIDTH];
+THREADLOCAL fixed_t			basexscale;
+THREADLOCAL fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+THREADLOCAL fixed_t			cachedheight[MAXHEIGHT];
+THREADLOCAL fixed_t			cacheddistance[MAXHEIGHT];
+THREADLOCAL fixed_t			cachedxstep[MAXHEIGHT];
+THREADLOCAL fixed_t			cachedystep[MAXHEIGHT];
+THREADLOCAL unsigned		cachedzlight[MAXHEIGHT];
+THREADLOCAL int			cachedmiplevel[MAXHEIGHT];
+
+// The flat being drawn, and how many of its mip
+//  levels there are in planesource.
+THREADLOCAL byte*		planesource[MIPLEVELS];
+THREADLOCAL int			planemiplevels;
 
 
 
@@ -109,7 +129,7 @@ void R_InitPlanes(void)
 //
 // Uses global vars:
 //  planeheight
-//  ds_source
+//  planesource
 //  basexscale
 //  baseyscale
 //  viewx
@@ -127,6 +147,7 @@ R_MapPlane
 	fixed_t	distance;
 	fixed_t	length;
 	unsigned	index;
+	int		level;
 
 #ifdef RANGECHECK
 	if (x2 < x1
@@ -138,18 +159,31 @@ R_MapPlane
 	}
 #endif
 
+	// Everything that depends on the row only is worked
+	//  out once per row and plane height, including the
+	//  light index; only the start of the span is per span.
 	if (planeheight != cachedheight[y])
 	{
 		cachedheight[y] = planeheight;
 		distance = cacheddistance[y] = FixedMul(planeheight, yslope[y]);
 		ds_xstep = cachedxstep[y] = FixedMul(distance, basexscale);
 		ds_ystep = cachedystep[y] = FixedMul(distance, baseyscale);
+
+		index = distance >> LIGHTZSHIFT;
+		if (index >= MAXLIGHTZ)
+			index = MAXLIGHTZ - 1;
+		cachedzlight[y] = index;
+
+		// a step along the row is distance/centerx texels
+		level = cachedmiplevel[y] = R_MipLevel(distance / centerx);
 	}
 	else
 	{
 		distance = cacheddistance[y];
 		ds_xstep = cachedxstep[y];
 		ds_ystep = cachedystep[y];
+		index = cachedzlight[y];
+		level = cachedmiplevel[y];
 	}
 
 	length = FixedMul(distance, distscale[x1]);
@@ -157,17 +191,20 @@ R_MapPlane
 	ds_xfrac = viewx + FixedMul(finecosine[angle], length);
 	ds_yfrac = -viewy - FixedMul(finesine[angle], length);
 
+	// Mip levels are tiled to 64*64, so the coordinates
+	//  are just scaled down and wrap as before.
+	if (level >= planemiplevels)
+		level = planemiplevels - 1;
+	ds_source = planesource[level];
+	ds_xfrac >>= level;
+	ds_yfrac >>= level;
+	ds_xstep >>= level;
+	ds_ystep >>= level;
+
 	if (fixedcolormap)
 		ds_colormap = fixedcolormap;
 	else
-	{
-		index = distance >> LIGHTZSHIFT;
-
-		if (index >= MAXLIGHTZ)
-			index = MAXLIGHTZ - 1;
-
 		ds_colormap = planezlight[index];
-	}
 
 	ds_y = y;
 	ds_x1 = x1;
@@ -178,6 +215,58 @@ R_MapPlane
 }
 
 
+//
+// R_MoveOpening
+// The same place in the new openings as p in the
+//  old array, which started at address old.
+//
+static short* R_MoveOpening(short* p, intptr_t old)
+{
+	return openings + ((intptr_t)p - old) / (intptr_t)sizeof(short);
+}
+
+
+//
+// R_CheckOpenings
+// Makes room for count more openings. The drawsegs
+//  of this frame that point into the old array are
+//  moved along with it.
+//
+void R_CheckOpenings(int count)
+{
+	intptr_t	old;
+	drawseg_t*	ds;
+	int			used;
+
+	used = lastopening - openings;
+	if (used + count <= maxopenings)
+		return;
+
+	// the old array is gone after the realloc, so only
+	//  its address is kept, to find the offsets from it
+	old = (intptr_t)openings;
+	while (used + count > maxopenings)
+		maxopenings = maxopenings ? maxopenings * 2 : SCREENWIDTH * 64;
+	openings = realloc(openings, maxopenings * sizeof(*openings));
+	if (!openings)
+		I_Error("R_CheckOpenings: no memory for %i openings", maxopenings);
+	lastopening = openings + used;
+
+	if (!old || (intptr_t)openings == old)
+		return;
+
+	for (ds = drawsegs; ds < ds_p; ds++)
+	{
+		if (ds->maskedtexturecol)
+			ds->maskedtexturecol = R_MoveOpening(ds->maskedtexturecol, old);
+		if (ds->sprtopclip && ds->sprtopclip != screenheightarray)
+			ds->sprtopclip = R_MoveOpening(ds->sprtopclip, old);
+		if (ds->sprbottomclip && ds->sprbottomclip != negonearray)
+			ds->sprbottomclip = R_MoveOpening(ds->sprbottomclip, old);
+	}
+}
+
+
 //
 // R_ClearPlanes
 // At begining of frame.
@@ -195,6 +284,7 @@ void R_ClearPlanes(void)
 	}
 
 	lastvisplane = visplanes;
+	memset(visplanehash, 0, sizeof(visplanehash));
 	lastopening = openings;
 
 	// texture calculation
@@ -211,6 +301,46 @@ void R_ClearPlanes(void)
 
 
 
+//
+// R_NewPlane
+// Takes the next free plane, growing the list if needed.
+//
+static visplane_t* R_NewPlane(void)
+{
+	int		count;
+
+	if (lastvisplane == visplanes + maxvisplanes)
+	{
+		count = maxvisplanes;
+		maxvisplanes = maxvisplanes ? maxvisplanes * 2 : 128;
+		visplanes = realloc(visplanes, maxvisplanes * sizeof(*visplanes));
+		if (!visplanes)
+			I_Error("R_NewPlane: no memory for %i visplanes", maxvisplanes);
+		memset(visplanes + count, 0, (maxvisplanes - count) * sizeof(*visplanes));
+		lastvisplane = visplanes + count;
+	}
+
+	// top and bottom follow the plane, with a pad
+	//  on either side of each, for the widest screen
+	//  as the frame server changes the size.
+	// Zeroed, as the static visplanes were, since only
+	//  top is cleared for each new plane: a bottom left
+	//  at 0xffff next to an empty top makes R_MakeSpans
+	//  map row 65535.
+	if (!*lastvisplane)
+	{
+		*lastvisplane = calloc(1, sizeof(visplane_t)
+			+ 2 * (MAXWIDTH + 2) * sizeof(unsigned short));
+		if (!*lastvisplane)
+			I_Error("R_NewPlane: no memory for visplane");
+		(*lastvisplane)->top = (unsigned short*)(*lastvisplane + 1) + 1;
+		(*lastvisplane)->bottom = (*lastvisplane)->top + MAXWIDTH + 2;
+	}
+
+	return *lastvisplane++;
+}
+
+
 //
 // R_FindPlane
 //
@@ -221,6 +351,7 @@ R_FindPlane
 	int		lightlevel)
 {
 	visplane_t* check;
+	unsigned	hash;
 
 	if (picnum == skyflatnum)
 	{
@@ -228,32 +359,31 @@ R_FindPlane
 		lightlevel = 0;
 	}
 
-	for (check = visplanes; check < lastvisplane; check++)
+	// Only planes made here are hashed: the ones split
+	//  off by R_CheckPlane share the key of an older plane,
+	//  which is the one the lookup has to return.
+	hash = VISPLANEHASH(height, picnum, lightlevel) & (VISPLANEHASHSIZE - 1);
+	for (check = visplanehash[hash]; check; check = check->next)
 	{
 		if (height == check->height
 			&& picnum == check->picnum
 			&& lightlevel == check->lightlevel)
 		{
-			break;
+			return check;
 		}
 	}
 
-
-	if (check < lastvisplane)
-		return check;
-
-	if (lastvisplane - visplanes == MAXVISPLANES)
-		I_Error("R_FindPlane: no more visplanes");
-
-	lastvisplane++;
+	check = R_NewPlane();
 
 	check->height = height;
 	check->picnum = picnum;
 	check->lightlevel = lightlevel;
 	check->minx = SCREENWIDTH;
 	check->maxx = -1;
+	check->next = visplanehash[hash];
+	visplanehash[hash] = check;
 
-	memset(check->top, 0xff, sizeof(check->top));
+	memset(check->top, 0xff, SCREENWIDTH * sizeof(*check->top));
 
 	return check;
 }
@@ -268,6 +398,7 @@ R_CheckPlane
 	int		start,
 	int		stop)
 {
+	visplane_t* check;
 	int		intrl;
 	int		intrh;
 	int		unionl;
@@ -297,7 +428,7 @@ R_CheckPlane
 	}
 
 	for (x = intrl; x <= intrh; x++)
-		if (pl->top[x] != 0xff)
+		if (pl->top[x] != 0xffff)
 			break;
 
 	if (x > intrh)
@@ -310,15 +441,17 @@ R_CheckPlane
 	}
 
 	// make a new visplane
-	lastvisplane->height = pl->height;
-	lastvisplane->picnum = pl->picnum;
-	lastvisplane->lightlevel = pl->lightlevel;
+	check = R_NewPlane();
+	check->height = pl->height;
+	check->picnum = pl->picnum;
+	check->lightlevel = pl->lightlevel;
+	check->next = NULL;
 
-	pl = lastvisplane++;
+	pl = check;
 	pl->minx = start;
 	pl->maxx = stop;
 
-	memset(pl->top, 0xff, sizeof(pl->top));
+	memset(pl->top, 0xff, SCREENWIDTH * sizeof(*pl->top));
 
 	return pl;
 }
@@ -361,95 +494,165 @@ R_MakeSpans
 
 
 //
-// R_DrawPlanes
-// At the end of each frame.
+// R_DrawPlane
 //
-void R_DrawPlanes(void)
+static void R_DrawPlane(visplane_t* pl)
 {
-	visplane_t* pl;
 	int			light;
 	int			x;
 	int			stop;
 	int			angle;
 
-#ifdef RANGECHECK
-	if (ds_p - drawsegs > MAXDRAWSEGS)
-		I_Error("R_DrawPlanes: drawsegs overflow (%i)",
-			ds_p - drawsegs);
-
-	if (lastvisplane - visplanes > MAXVISPLANES)
-		I_Error("R_DrawPlanes: visplane overflow (%i)",
-			lastvisplane - visplanes);
-
-	if (lastopening - openings > MAXOPENINGS)
-		I_Error("R_DrawPlanes: opening overflow (%i)",
-			lastopening - openings);
-#endif
+	if (pl->minx > pl->maxx)
+		return;
 
-	for (pl = visplanes; pl < lastvisplane; pl++)
+	// sky flat
+	if (pl->picnum == skyflatnum)
 	{
-		if (pl->minx > pl->maxx)
-			continue;
-
-
-		// sky flat
-		if (pl->picnum == skyflatnum)
+		dc_iscale = pspriteiscale >> detailshift;
+
+		// Sky is allways drawn full bright,
+		//  i.e. colormaps[0] is used.
+		// Because of this hack, sky is not affected
+		//  by INVUL inverse mapping.
+		dc_colormap = colormaps;
+		dc_texturemid = skytexturemid;
+		for (x = pl->minx; x <= pl->maxx; x++)
 		{
-			dc_iscale = pspriteiscale >> detailshift;
-
-			// Sky is allways drawn full bright,
-			//  i.e. colormaps[0] is used.
-			// Because of this hack, sky is not affected
-			//  by INVUL inverse mapping.
-			dc_colormap = colormaps;
-			dc_texturemid = skytexturemid;
-			for (x = pl->minx; x <= pl->maxx; x++)
+			dc_yl = pl->top[x];
+			dc_yh = pl->bottom[x];
+
+			if (dc_yl <= dc_yh)
 			{
-				dc_yl = pl->top[x];
-				dc_yh = pl->bottom[x];
-
-				if (dc_yl <= dc_yh)
-				{
-					angle = (viewangle + xtoviewangle[x]) >> ANGLETOSKYSHIFT;
-					dc_x = x;
-					dc_source = R_GetColumn(skytexture, angle);
-					colfunc();
-				}
+				angle = (viewangle + xtoviewangle[x]) >> ANGLETOSKYSHIFT;
+				dc_x = x;
+				dc_source = R_GetColumn(skytexture, angle);
+				R_PickColumnFunc(textureheight[skytexture] >> FRACBITS);
+				colfunc();
 			}
-			continue;
 		}
+		return;
+	}
+
+	// regular flat - FIXED: Use PU_CACHE instead of PU_STATIC
+	// so it can be re-tagged later without causing Z_CT error
+	planesource[0] = R_CacheLumpNum(firstflat +
+		flattranslation[pl->picnum]);
+	for (planemiplevels = 1; planemiplevels < MIPLEVELS; planemiplevels++)
+	{
+		planesource[planemiplevels] =
+			R_GetFlatMip(flattranslation[pl->picnum], planemiplevels);
+		if (!planesource[planemiplevels])
+			break;
+	}
+
+	planeheight = abs(pl->height - viewz);
+	light = (pl->lightlevel >> LIGHTSEGSHIFT) + extralight;
+
+	if (light >= LIGHTLEVELS)
+		light = LIGHTLEVELS - 1;
+
+	if (light < 0)
+		light = 0;
+
+	planezlight = zlight[light];
+
+	// The pads may be columns of a wider screen the
+	//  frame server drew before, so bottom is set too.
+	pl->top[pl->maxx + 1] = 0xffff;
+	pl->top[pl->minx - 1] = 0xffff;
+	pl->bottom[pl->maxx + 1] = 0;
+	pl->bottom[pl->minx - 1] = 0;
+
+	stop = pl->maxx + 1;
+
+	for (x = pl->minx; x <= stop; x++)
+	{
+		R_MakeSpans(x, pl->top[x - 1],
+			pl->bottom[x - 1],
+			pl->top[x],
+			pl->bottom[x]);
+	}
+
+	// NOTE: Z_ChangeTag call removed - ds_source is already PU_CACHE
+	// and may have been loaded as PU_STATIC by other code
+}
+
+
+//
+// R_DrawPlanes
+// At the end of each frame.
+//
+void R_DrawPlanes(void)
+{
+	int			i;
 
-		// regular flat - FIXED: Use PU_CACHE instead of PU_STATIC
-		// so it can be re-tagged later without causing Z_CT error
-		ds_source = W_CacheLumpNum(firstflat +
-			flattranslation[pl->picnum],
-			PU_CACHE);
+	for (i = 0; i < lastvisplane - visplanes; i++)
+		R_DrawPlane(visplanes[i]);
+}
 
-		planeheight = abs(pl->height - viewz);
-		light = (pl->lightlevel >> LIGHTSEGSHIFT) + extralight;
 
-		if (light >= LIGHTLEVELS)
-			light = LIGHTLEVELS - 1;
+//
+// Shared plane drawing.
+// Once the walls of all strips are done, the planes
+//  of every strip go to whichever thread is free, so
+//  a strip full of floor doesn't hold up the others.
+// Planes never overlap, so any thread may draw any of
+//  them; the view dependent state every thread set up
+//  for its own strip is the same for all.
+//
+static visplane_t** stripplanes[MAXTHREADS];
+static int			numstripplanes[MAXTHREADS];
+static int			numsharedstrips;
+static int			sharedstrip;
+static int			sharedplane;
+
+
+//
+// R_PublishPlanes
+//
+void R_PublishPlanes(int strip)
+{
+	stripplanes[strip] = visplanes;
+	numstripplanes[strip] = lastvisplane - visplanes;
+}
 
-		if (light < 0)
-			light = 0;
 
-		planezlight = zlight[light];
+//
+// R_SharePlanes
+//
+void R_SharePlanes(int strips)
+{
+	numsharedstrips = strips;
+	sharedstrip = 0;
+	sharedplane = 0;
+}
 
-		pl->top[pl->maxx + 1] = 0xff;
-		pl->top[pl->minx - 1] = 0xff;
 
-		stop = pl->maxx + 1;
+//
+// R_DrawSharedPlanes
+//
+void R_DrawSharedPlanes(int thread)
+{
+	visplane_t* pl;
 
-		for (x = pl->minx; x <= stop; x++)
+	for (;;)
+	{
+		I_Lock();
+		while (sharedstrip < numsharedstrips
+			&& sharedplane == numstripplanes[sharedstrip])
 		{
-			R_MakeSpans(x, pl->top[x - 1],
-				pl->bottom[x - 1],
-				pl->top[x],
-				pl->bottom[x]);
+			sharedstrip++;
+			sharedplane = 0;
 		}
+		if (sharedstrip == numsharedstrips)
+		{
+			I_Unlock();
+			return;
+		}
+		pl = stripplanes[sharedstrip][sharedplane++];
+		I_Unlock();
 
-		// NOTE: Z_ChangeTag call removed - ds_source is already PU_CACHE
-		// and may have been loaded as PU_STATIC by other code
+		R_DrawPlane(pl);
 	}
-}
\ No newline at end of file
+}
@@ -32,7 +32,7 @@
 
 
 // Visplane related.
-extern  short*		lastopening;
+extern THREADLOCAL short*		lastopening;
 
 
 typedef void (*planefunction_t) (int top, int bottom);
@@ -40,14 +40,15 @@ typedef void (*planefunction_t) (int top, int bottom);
 extern planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern short		floorclip[SCREENWIDTH];
-extern short		ceilingclip[SCREENWIDTH];
+extern THREADLOCAL short		floorclip[MAXWIDTH];
+extern THREADLOCAL short		ceilingclip[MAXWIDTH];
 
-extern fixed_t		yslope[SCREENHEIGHT];
-extern fixed_t		distscale[SCREENWIDTH];
+extern fixed_t		yslope[MAXHEIGHT];
+extern fixed_t		distscale[MAXWIDTH];
 
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
+void R_CheckOpenings (int count);
 
 void
 R_MapPlane
@@ -65,6 +66,13 @@ R_MakeSpans
 
 void R_DrawPlanes (void);
 
+// The same spread over threads: each strip publishes
+//  its planes, R_SharePlanes starts the phase and every
+//  thread calls R_DrawSharedPlanes until none are left.
+void R_PublishPlanes (int strip);
+void R_SharePlanes (int strips);
+void R_DrawSharedPlanes (int thread);
+
 visplane_t*
 R_FindPlane
 ( fixed_t	height,
@@ -0,0 +1,1122 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Potentially visible sets. For every subsector, the
+//	 subsectors that can be seen from anywhere inside it,
+//	 so R_RenderBSPNode can skip whole subtrees.
+//	The sets are built at level load: each subsector gets
+//	 its convex outline from the nodes, the open parts of
+//	 the outlines become portals, and sight is flowed
+//	 through chains of portals a straight line can pass.
+//	That is done twice: with the closed doors and lifts as
+//	 walls, and with them open, which holds however they
+//	 move. A view uses the first unless one of them is
+//	 open or moving where the second says it can be seen.
+//
+//-----------------------------------------------------------------------------
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
+#include "m_bbox.h"
+
+#include "r_local.h"
+#include "r_state.h"
+
+#ifdef __GNUG__
+#pragma implementation "r_pvs.h"
+#endif
+#include "r_pvs.h"
+
+
+
+// Distances below this, in map units, count as on the line.
+#define PVS_EPSILON		(1.0/64)
+
+// How far past an outline edge to look for
+//  the subsector on the other side.
+#define PVS_NUDGE		(1.0/256)
+
+#define MAXPVSPOINTS		128
+#define MAXPVSDEPTH		256
+
+// Flow steps allowed from one subsector before it
+//  gives up and just sees everything.
+#define PVSWORKLIMIT		(1<<18)
+
+// Milliseconds allowed for all of the flows of a level;
+//  subsectors not reached by then see everything.
+#define PVSBUILDTIME		2000
+
+// No sets for maps that would need more than this
+//  for the portal bits while building.
+#define MAXPVSMEMORY		(64*1024*1024)
+
+#define PVSTEST(bits,num)	((bits)[(num)>>5] & (1u<<((num)&31)))
+#define PVSSET(bits,num)	((bits)[(num)>>5] |= (1u<<((num)&31)))
+
+
+typedef struct
+{
+    double	x;
+    double	y;
+
+} pvspoint_t;
+
+typedef struct
+{
+    int		numpoints;
+    pvspoint_t*	points;
+
+} pvspoly_t;
+
+//
+// An opening from one subsector into the next.
+// The far side is on the left going from p1 to p2,
+//  the side nx,ny,dist gives positive distances for.
+//
+typedef struct
+{
+    pvspoint_t	p1;
+    pvspoint_t	p2;
+    double	nx;
+    double	ny;
+    double	dist;
+
+    // Subsector on the far side.
+    int		sub;
+
+    // Subsectors a chain of portals starting
+    //  with this one could lead into at all.
+    unsigned*	mightsee;
+
+} pvsportal_t;
+
+//
+// Per thread state of the flow from one subsector.
+//
+typedef struct
+{
+    pvsportal_t*	source;
+    unsigned*		vis;
+    unsigned*		might;		// MAXPVSDEPTH+1 sets
+    int			work;
+
+} pvsflow_t;
+
+
+//
+// A seg of a two sided line that was closed when the
+//  sets were built, and so counts as a wall in pvsrows.
+//
+typedef struct
+{
+    line_t*	line;
+    int		sub;
+
+} pvsclosed_t;
+
+
+boolean			pvsactive;
+unsigned*		pvsrow;
+byte*			pvsnodes;
+
+// With the closed lines as walls, and with them open.
+// The same rows if there are no closed lines.
+static unsigned*	pvsrows;
+static unsigned*	pvsopenrows;
+static int		pvsrowwords;
+static unsigned*	pvsviewrow;
+
+static pvsclosed_t*	pvsclosed;
+static int		numpvsclosed;
+
+// Only around while building.
+static pvspoly_t*	pvspolys;
+static pvsportal_t*	pvsportals;
+static int		numpvsportals;
+static int		maxpvsportals;
+static int*		pvssubportals;
+
+// The outline edge the portals are being found for.
+static int		edgesub;
+static pvspoint_t	edgestart;
+static pvspoint_t	edgedelta;
+static double		edgenx;
+static double		edgeny;
+static double		edgelength;
+
+static unsigned*	pvsflowmight;
+static int		pvsflowthreads;
+static unsigned*	pvsflowrows;
+static int		pvsdeadline;
+
+// Closed lines are portals too, for pvsopenrows.
+static boolean		pvsopenall;
+
+
+
+//
+// R_ClosedLine
+// The same test R_AddLine uses for closed doors.
+//
+static boolean R_ClosedLine (sector_t* front, sector_t* back)
+{
+    return back->ceilingheight <= front->floorheight
+	|| back->floorheight >= front->ceilingheight;
+}
+
+
+//
+// R_ClipPolygon
+// Keeps the part of in on the right of the line through
+//  x,y going along dx,dy, which is the front side of
+//  nodes and segs. Returns the new number of points.
+//
+static int
+R_ClipPolygon
+( pvspoint_t*	in,
+  int		numin,
+  pvspoint_t*	out,
+  double	x,
+  double	y,
+  double	dx,
+  double	dy )
+{
+    double	side[MAXPVSPOINTS];
+    double	frac;
+    int		numout;
+    int		i;
+    int		j;
+
+    // Leaving it unclipped only makes the outline
+    //  larger, which errs on the seen side.
+    if (numin >= MAXPVSPOINTS-1)
+    {
+	memcpy (out, in, numin*sizeof(*in));
+	return numin;
+    }
+
+    for (i=0 ; i<numin ; i++)
+	side[i] = dx*(in[i].y-y) - dy*(in[i].x-x);
+
+    numout = 0;
+    for (i=0 ; i<numin ; i++)
+    {
+	j = i+1 == numin ? 0 : i+1;
+
+	if (side[i] <= 0)
+	    out[numout++] = in[i];
+
+	if ((side[i] < 0 && side[j] > 0)
+	    || (side[i] > 0 && side[j] < 0))
+	{
+	    frac = side[i] / (side[i]-side[j]);
+	    out[numout].x = in[i].x + frac*(in[j].x-in[i].x);
+	    out[numout].y = in[i].y + frac*(in[j].y-in[i].y);
+	    numout++;
+	}
+    }
+
+    return numout;
+}
+
+
+//
+// R_PolygonArea
+// Signed, positive when the points go counterclockwise.
+//
+static double R_PolygonArea (pvspoint_t* points, int numpoints)
+{
+    double	area;
+    int		i;
+    int		j;
+
+    area = 0;
+    for (i=0 ; i<numpoints ; i++)
+    {
+	j = i+1 == numpoints ? 0 : i+1;
+	area += points[i].x*points[j].y - points[j].x*points[i].y;
+    }
+    return area/2;
+}
+
+
+//
+// R_SubsectorPolygon
+// The leaf outline the nodes give, cut down by the
+//  segs, which all face into a convex subsector.
+//
+static void
+R_SubsectorPolygon
+( int		num,
+  pvspoint_t*	leaf,
+  int		numleaf )
+{
+    pvspoint_t	clipped[2][MAXPVSPOINTS];
+    pvspoint_t*	points;
+    subsector_t*	sub;
+    seg_t*	seg;
+    int		numpoints;
+    int		i;
+
+    sub = &subsectors[num];
+    seg = &segs[sub->firstline];
+    points = leaf;
+    numpoints = numleaf;
+
+    for (i=0 ; i<sub->numlines && numpoints>=3 ; i++, seg++)
+    {
+	numpoints = R_ClipPolygon (points, numpoints, clipped[i&1],
+				   (double)seg->v1->x/FRACUNIT,
+				   (double)seg->v1->y/FRACUNIT,
+				   (double)(seg->v2->x-seg->v1->x)/FRACUNIT,
+				   (double)(seg->v2->y-seg->v1->y)/FRACUNIT);
+	points = clipped[i&1];
+    }
+
+    // Badly built nodes can leave segs that don't
+    //  bound the leaf; the bare leaf is still safe.
+    if (numpoints < 3
+	|| fabs (R_PolygonArea (points, numpoints)) < PVS_EPSILON)
+    {
+	points = leaf;
+	numpoints = numleaf;
+    }
+
+    // left without points, R_BuildPVS gives up
+    if (numpoints < 3)
+	return;
+
+    pvspolys[num].numpoints = numpoints;
+    pvspolys[num].points = malloc (numpoints*sizeof(*points));
+    if (!pvspolys[num].points)
+	I_Error ("R_SubsectorPolygon: no memory");
+    memcpy (pvspolys[num].points, points, numpoints*sizeof(*points));
+}
+
+
+//
+// R_LeafPolygons
+// Splits the outline down the nodes to every leaf.
+//
+static void
+R_LeafPolygons
+( int		bspnum,
+  pvspoint_t*	points,
+  int		numpoints )
+{
+    pvspoint_t	split[MAXPVSPOINTS];
+    node_t*	bsp;
+    double	x;
+    double	y;
+    double	dx;
+    double	dy;
+    int		num;
+
+    if (bspnum & NF_SUBSECTOR)
+    {
+	if (bspnum == -1)
+	    R_SubsectorPolygon (0, points, numpoints);
+	else
+	    R_SubsectorPolygon (bspnum&(~NF_SUBSECTOR), points, numpoints);
+	return;
+    }
+
+    bsp = &nodes[bspnum];
+    x = (double)bsp->x/FRACUNIT;
+    y = (double)bsp->y/FRACUNIT;
+    dx = (double)bsp->dx/FRACUNIT;
+    dy = (double)bsp->dy/FRACUNIT;
+
+    num = R_ClipPolygon (points, numpoints, split, x, y, dx, dy);
+    R_LeafPolygons (bsp->children[0], split, num);
+
+    num = R_ClipPolygon (points, numpoints, split, x, y, -dx, -dy);
+    R_LeafPolygons (bsp->children[1], split, num);
+}
+
+
+//
+// R_AddPortal
+// From edgesub into sub, over u1 to u2 along the edge.
+//
+static void R_AddPortal (int sub, double u1, double u2)
+{
+    pvsportal_t*	portal;
+    pvspoint_t		swap;
+    double		dx;
+    double		dy;
+    double		length;
+
+    if (sub == edgesub || (u2-u1)*edgelength < PVS_EPSILON)
+	return;
+
+    if (numpvsportals == maxpvsportals)
+    {
+	maxpvsportals = maxpvsportals ? maxpvsportals*2 : 1024;
+	pvsportals = realloc (pvsportals,
+			      maxpvsportals*sizeof(*pvsportals));
+	if (!pvsportals)
+	    I_Error ("R_AddPortal: no memory");
+    }
+
+    portal = &pvsportals[numpvsportals++];
+    portal->sub = sub;
+    portal->mightsee = NULL;
+
+    portal->p1.x = edgestart.x + u1*edgedelta.x;
+    portal->p1.y = edgestart.y + u1*edgedelta.y;
+    portal->p2.x = edgestart.x + u2*edgedelta.x;
+    portal->p2.y = edgestart.y + u2*edgedelta.y;
+
+    // Far side on the left.
+    if (edgedelta.x*edgeny - edgedelta.y*edgenx < 0)
+    {
+	swap = portal->p1;
+	portal->p1 = portal->p2;
+	portal->p2 = swap;
+    }
+
+    dx = portal->p2.x - portal->p1.x;
+    dy = portal->p2.y - portal->p1.y;
+    length = sqrt (dx*dx + dy*dy);
+    portal->nx = -dy/length;
+    portal->ny = dx/length;
+    portal->dist = portal->nx*portal->p1.x + portal->ny*portal->p1.y;
+}
+
+
+//
+// R_FindPortals
+// Walks u1 to u2 of the current edge, pushed just past
+//  it, down the nodes to the subsectors on the far side.
+//
+static void R_FindPortals (int bspnum, double u1, double u2)
+{
+    node_t*	bsp;
+    double	x1;
+    double	y1;
+    double	x2;
+    double	y2;
+    double	side1;
+    double	side2;
+    double	um;
+
+    if (bspnum & NF_SUBSECTOR)
+    {
+	R_AddPortal (bspnum == -1 ? 0 : bspnum&(~NF_SUBSECTOR), u1, u2);
+	return;
+    }
+
+    bsp = &nodes[bspnum];
+    x1 = edgestart.x + u1*edgedelta.x + edgenx*PVS_NUDGE;
+    y1 = edgestart.y + u1*edgedelta.y + edgeny*PVS_NUDGE;
+    x2 = edgestart.x + u2*edgedelta.x + edgenx*PVS_NUDGE;
+    y2 = edgestart.y + u2*edgedelta.y + edgeny*PVS_NUDGE;
+
+    // Negative on the front side, as in R_PointOnSide.
+    side1 = (double)bsp->dx/FRACUNIT*(y1 - (double)bsp->y/FRACUNIT)
+	- (double)bsp->dy/FRACUNIT*(x1 - (double)bsp->x/FRACUNIT);
+    side2 = (double)bsp->dx/FRACUNIT*(y2 - (double)bsp->y/FRACUNIT)
+	- (double)bsp->dy/FRACUNIT*(x2 - (double)bsp->x/FRACUNIT);
+
+    if (side1 < 0 && side2 < 0)
+	R_FindPortals (bsp->children[0], u1, u2);
+    else if (side1 >= 0 && side2 >= 0)
+	R_FindPortals (bsp->children[1], u1, u2);
+    else
+    {
+	um = u1 + (u2-u1)*side1/(side1-side2);
+	R_FindPortals (bsp->children[side1 >= 0], u1, um);
+	R_FindPortals (bsp->children[side2 >= 0], um, u2);
+    }
+}
+
+
+//
+// R_SubsectorPortals
+// Every part of the outline that no wall or closed
+//  door covers opens into whatever lies beyond it.
+//
+static void R_SubsectorPortals (int num)
+{
+    double	covered[MAXPVSPOINTS][2];
+    pvspoly_t*	poly;
+    subsector_t*	sub;
+    seg_t*	seg;
+    pvspoint_t*	a;
+    pvspoint_t*	b;
+    double	area;
+    double	t1;
+    double	t2;
+    double	swap;
+    double	d1;
+    double	d2;
+    double	open;
+    int		numcovered;
+    int		i;
+    int		j;
+    int		k;
+
+    poly = &pvspolys[num];
+    sub = &subsectors[num];
+    area = R_PolygonArea (poly->points, poly->numpoints);
+    edgesub = num;
+
+    for (i=0 ; i<poly->numpoints ; i++)
+    {
+	a = &poly->points[i];
+	b = &poly->points[i+1 == poly->numpoints ? 0 : i+1];
+	edgestart = *a;
+	edgedelta.x = b->x - a->x;
+	edgedelta.y = b->y - a->y;
+	edgelength = sqrt (edgedelta.x*edgedelta.x
+			   + edgedelta.y*edgedelta.y);
+	if (edgelength < PVS_EPSILON)
+	    continue;
+
+	// Outward normal; the inside is on the left
+	//  of counterclockwise outlines.
+	edgenx = edgedelta.y/edgelength;
+	edgeny = -edgedelta.x/edgelength;
+	if (area < 0)
+	{
+	    edgenx = -edgenx;
+	    edgeny = -edgeny;
+	}
+
+	// Collect the walls lying along the edge.
+	numcovered = 0;
+	seg = &segs[sub->firstline];
+	for (j=0 ; j<sub->numlines && numcovered<MAXPVSPOINTS ; j++, seg++)
+	{
+	    if (seg->backsector
+		&& (pvsopenall
+		    || !R_ClosedLine (seg->frontsector, seg->backsector)))
+		continue;
+
+	    d1 = ((double)seg->v1->x/FRACUNIT - a->x)*edgenx
+		+ ((double)seg->v1->y/FRACUNIT - a->y)*edgeny;
+	    d2 = ((double)seg->v2->x/FRACUNIT - a->x)*edgenx
+		+ ((double)seg->v2->y/FRACUNIT - a->y)*edgeny;
+	    if (fabs(d1) > PVS_EPSILON || fabs(d2) > PVS_EPSILON)
+		continue;
+
+	    t1 = (((double)seg->v1->x/FRACUNIT - a->x)*edgedelta.x
+		  + ((double)seg->v1->y/FRACUNIT - a->y)*edgedelta.y)
+		/ (edgelength*edgelength);
+	    t2 = (((double)seg->v2->x/FRACUNIT - a->x)*edgedelta.x
+		  + ((double)seg->v2->y/FRACUNIT - a->y)*edgedelta.y)
+		/ (edgelength*edgelength);
+	    if (t1 > t2)
+	    {
+		swap = t1;
+		t1 = t2;
+		t2 = swap;
+	    }
+
+	    // Insertion sort by start.
+	    for (k=numcovered ; k>0 && covered[k-1][0]>t1 ; k--)
+	    {
+		covered[k][0] = covered[k-1][0];
+		covered[k][1] = covered[k-1][1];
+	    }
+	    covered[k][0] = t1;
+	    covered[k][1] = t2;
+	    numcovered++;
+	}
+
+	// Whatever is left over opens up.
+	open = 0;
+	for (j=0 ; j<numcovered ; j++)
+	{
+	    if ((covered[j][0]-open)*edgelength > PVS_EPSILON)
+		R_FindPortals (numnodes-1, open, covered[j][0]);
+	    if (covered[j][1] > open)
+		open = covered[j][1];
+	}
+	if ((1-open)*edgelength > PVS_EPSILON)
+	    R_FindPortals (numnodes-1, open, 1);
+    }
+}
+
+
+//
+// R_PortalSide
+// Positive on the far side of the portal.
+//
+static double R_PortalSide (pvsportal_t* portal, pvspoint_t* point)
+{
+    return portal->nx*point->x + portal->ny*point->y - portal->dist;
+}
+
+
+//
+// R_MightSee
+// Floods out from the far side of a portal through every
+//  portal that is partly in front of it, and that it is
+//  partly behind. A superset of what R_FlowPortals finds.
+//
+static void R_MightSee (pvsportal_t* portal, int* stack)
+{
+    pvsportal_t*	next;
+    int			sp;
+    int			sub;
+    int			i;
+
+    memset (portal->mightsee, 0, pvsrowwords*sizeof(unsigned));
+    PVSSET (portal->mightsee, portal->sub);
+    stack[0] = portal->sub;
+    sp = 1;
+
+    while (sp)
+    {
+	sub = stack[--sp];
+	for (i=pvssubportals[sub] ; i<pvssubportals[sub+1] ; i++)
+	{
+	    next = &pvsportals[i];
+	    if (PVSTEST (portal->mightsee, next->sub))
+		continue;
+	    if (R_PortalSide (portal, &next->p1) <= PVS_EPSILON
+		&& R_PortalSide (portal, &next->p2) <= PVS_EPSILON)
+		continue;
+	    if (R_PortalSide (next, &portal->p1) >= -PVS_EPSILON
+		&& R_PortalSide (next, &portal->p2) >= -PVS_EPSILON)
+		continue;
+	    PVSSET (portal->mightsee, next->sub);
+	    stack[sp++] = next->sub;
+	}
+    }
+}
+
+
+//
+// R_ClipPortal
+// Keeps the part of the portal on the positive side
+//  of the line. False if nothing is strictly past it.
+//
+static boolean
+R_ClipPortal
+( pvsportal_t*	portal,
+  double	nx,
+  double	ny,
+  double	dist )
+{
+    double	d1;
+    double	d2;
+    double	frac;
+
+    d1 = nx*portal->p1.x + ny*portal->p1.y - dist;
+    d2 = nx*portal->p2.x + ny*portal->p2.y - dist;
+
+    if (d1 <= PVS_EPSILON && d2 <= PVS_EPSILON)
+	return false;
+
+    if (d1 < 0)
+    {
+	frac = d1 / (d1-d2);
+	portal->p1.x += frac*(portal->p2.x-portal->p1.x);
+	portal->p1.y += frac*(portal->p2.y-portal->p1.y);
+    }
+    else if (d2 < 0)
+    {
+	frac = d2 / (d2-d1);
+	portal->p2.x += frac*(portal->p1.x-portal->p2.x);
+	portal->p2.y += frac*(portal->p1.y-portal->p2.y);
+    }
+    return true;
+}
+
+
+//
+// R_ClipToSeparators
+// Lines of sight through both source and pass fan out
+//  between the two lines that join an end of one to the
+//  opposite end of the other. Keeps what lies between.
+//
+static boolean
+R_ClipToSeparators
+( pvsportal_t*	portal,
+  pvsportal_t*	source,
+  pvsportal_t*	pass )
+{
+    pvspoint_t*	s[2];
+    pvspoint_t*	p[2];
+    double	dx;
+    double	dy;
+    double	length;
+    double	nx;
+    double	ny;
+    double	dist;
+    double	ds;
+    double	dp;
+    int		i;
+    int		j;
+
+    s[0] = &source->p1;
+    s[1] = &source->p2;
+    p[0] = &pass->p1;
+    p[1] = &pass->p2;
+
+    for (i=0 ; i<2 ; i++)
+    {
+	for (j=0 ; j<2 ; j++)
+	{
+	    dx = p[j]->x - s[i]->x;
+	    dy = p[j]->y - s[i]->y;
+	    length = sqrt (dx*dx + dy*dy);
+	    if (length < PVS_EPSILON)
+		continue;
+
+	    nx = -dy/length;
+	    ny = dx/length;
+	    dist = nx*s[i]->x + ny*s[i]->y;
+
+	    // A separator has the source and the pass
+	    //  on opposite sides.
+	    ds = nx*s[!i]->x + ny*s[!i]->y - dist;
+	    dp = nx*p[!j]->x + ny*p[!j]->y - dist;
+	    if (ds > PVS_EPSILON && dp < -PVS_EPSILON)
+	    {
+		nx = -nx;
+		ny = -ny;
+		dist = -dist;
+	    }
+	    else if (!(ds < -PVS_EPSILON && dp > PVS_EPSILON))
+		continue;
+
+	    if (!R_ClipPortal (portal, nx, ny, dist))
+		return false;
+	}
+    }
+    return true;
+}
+
+
+//
+// R_FlowPortals
+// Follows sight from the source portal on through the
+//  portals out of sub, pass being the last one it went
+//  through. Returns false if the work ran out.
+//
+static boolean
+R_FlowPortals
+( pvsflow_t*	flow,
+  int		sub,
+  pvsportal_t*	pass,
+  int		depth )
+{
+    pvsportal_t*	portal;
+    pvsportal_t		clipped;
+    unsigned*		might;
+    unsigned*		newmight;
+    unsigned		more;
+    int			i;
+    int			j;
+
+    if (++flow->work > PVSWORKLIMIT)
+	return false;
+
+    might = flow->might + depth*pvsrowwords;
+    newmight = might + pvsrowwords;
+
+    for (i=pvssubportals[sub] ; i<pvssubportals[sub+1] ; i++)
+    {
+	portal = &pvsportals[i];
+	if (!PVSTEST (might, portal->sub))
+	    continue;
+
+	// Nothing new can be found past here.
+	more = 0;
+	for (j=0 ; j<pvsrowwords ; j++)
+	{
+	    newmight[j] = might[j] & portal->mightsee[j];
+	    more |= newmight[j] & ~flow->vis[j];
+	}
+	if (!more && PVSTEST (flow->vis, portal->sub))
+	    continue;
+
+	clipped = *portal;
+	if (!R_ClipPortal (&clipped, flow->source->nx,
+			   flow->source->ny, flow->source->dist)
+	    || !R_ClipPortal (&clipped, pass->nx, pass->ny, pass->dist))
+	    continue;
+	if (pass != flow->source
+	    && !R_ClipToSeparators (&clipped, flow->source, pass))
+	    continue;
+
+	PVSSET (flow->vis, portal->sub);
+
+	if (depth+1 == MAXPVSDEPTH)
+	{
+	    for (j=0 ; j<pvsrowwords ; j++)
+		flow->vis[j] |= newmight[j];
+	    continue;
+	}
+
+	if (!R_FlowPortals (flow, portal->sub, &clipped, depth+1))
+	    return false;
+    }
+    return true;
+}
+
+
+//
+// R_FlowSubsector
+// Fills in the set of one subsector.
+//
+static void R_FlowSubsector (pvsflow_t* flow, int num)
+{
+    pvsportal_t*	portal;
+    int			i;
+
+    flow->vis = pvsflowrows + num*pvsrowwords;
+    flow->work = 0;
+    memset (flow->vis, 0, pvsrowwords*sizeof(unsigned));
+    PVSSET (flow->vis, num);
+
+    for (i=pvssubportals[num] ; i<pvssubportals[num+1] ; i++)
+    {
+	portal = &pvsportals[i];
+	PVSSET (flow->vis, portal->sub);
+	memcpy (flow->might, portal->mightsee,
+		pvsrowwords*sizeof(unsigned));
+	flow->source = portal;
+
+	if (!R_FlowPortals (flow, portal->sub, portal, 0))
+	{
+	    memset (flow->vis, 0xff, pvsrowwords*sizeof(unsigned));
+	    return;
+	}
+    }
+}
+
+
+//
+// R_MightSeeThread
+// R_FlowThread
+// Thread index takes every pvsflowthreads'th portal,
+//  then every pvsflowthreads'th subsector.
+//
+static void R_MightSeeThread (int index)
+{
+    int*	stack;
+    int		i;
+
+    // The flood stack borrows the flow scratch, which
+    //  has room for more than numsubsectors entries.
+    stack = (int *)(pvsflowmight
+		    + index*(MAXPVSDEPTH+1)*pvsrowwords);
+
+    for (i=index ; i<numpvsportals ; i+=pvsflowthreads)
+	R_MightSee (&pvsportals[i], stack);
+}
+
+static void R_FlowThread (int index)
+{
+    pvsflow_t	flow;
+    int		i;
+
+    flow.might = pvsflowmight + index*(MAXPVSDEPTH+1)*pvsrowwords;
+
+    for (i=index ; i<numsubsectors ; i+=pvsflowthreads)
+    {
+	// out of time, sees everything
+	if (I_GetTimeMS () > pvsdeadline)
+	    memset (pvsflowrows + i*pvsrowwords, 0xff,
+		    pvsrowwords*sizeof(unsigned));
+	else
+	    R_FlowSubsector (&flow, i);
+    }
+}
+
+
+//
+// R_FreePVS
+//
+static void R_FreePVS (void)
+{
+    int		i;
+
+    if (pvspolys)
+    {
+	for (i=0 ; i<numsubsectors ; i++)
+	    free (pvspolys[i].points);
+	free (pvspolys);
+    }
+    free (pvsportals);
+    free (pvssubportals);
+    free (pvsflowmight);
+
+    pvspolys = NULL;
+    pvsportals = NULL;
+    pvssubportals = NULL;
+    pvsflowmight = NULL;
+    numpvsportals = maxpvsportals = 0;
+}
+
+
+//
+// R_FlowSets
+// Finds the portals, with the closed lines as walls or
+//  not as pvsopenall says, and flows sight through them
+//  into new rows. NULL if there would be too many portals.
+//
+static unsigned* R_FlowSets (void)
+{
+    unsigned*	mightsee;
+    double	size;
+    int		i;
+
+    numpvsportals = 0;
+    for (i=0 ; i<numsubsectors ; i++)
+    {
+	pvssubportals[i] = numpvsportals;
+	R_SubsectorPortals (i);
+    }
+    pvssubportals[numsubsectors] = numpvsportals;
+
+    size = (double)numpvsportals*pvsrowwords*sizeof(unsigned);
+    if (!numpvsportals || size > MAXPVSMEMORY)
+	return NULL;
+
+    // Everything a portal might lead into, all in one block.
+    mightsee = malloc (numpvsportals*pvsrowwords*sizeof(unsigned));
+    pvsflowrows = malloc (numsubsectors*pvsrowwords*sizeof(unsigned));
+    if (!mightsee || !pvsflowrows)
+	I_Error ("R_FlowSets: no memory");
+
+    for (i=0 ; i<numpvsportals ; i++)
+	pvsportals[i].mightsee = mightsee + i*pvsrowwords;
+
+    I_RunParallel (R_MightSeeThread, pvsflowthreads);
+    I_RunParallel (R_FlowThread, pvsflowthreads);
+
+    free (mightsee);
+    return pvsflowrows;
+}
+
+
+//
+// R_FindClosedLines
+// Remembers what the closed sets take to be walls.
+//
+static void R_FindClosedLines (void)
+{
+    subsector_t*	sub;
+    seg_t*	seg;
+    int		i;
+    int		j;
+
+    pvsclosed = malloc (numsegs*sizeof(*pvsclosed));
+    if (!pvsclosed)
+	I_Error ("R_FindClosedLines: no memory");
+
+    for (i=0, sub=subsectors ; i<numsubsectors ; i++, sub++)
+    {
+	seg = &segs[sub->firstline];
+	for (j=0 ; j<sub->numlines ; j++, seg++)
+	{
+	    if (!seg->backsector
+		|| !R_ClosedLine (seg->frontsector, seg->backsector))
+		continue;
+	    pvsclosed[numpvsclosed].line = seg->linedef;
+	    pvsclosed[numpvsclosed].sub = i;
+	    numpvsclosed++;
+	}
+    }
+}
+
+
+//
+// R_BuildPVS
+//
+void R_BuildPVS (void)
+{
+    pvspoint_t	box[4];
+    fixed_t	bbox[4];
+    int		i;
+
+    if (pvsopenrows != pvsrows)
+	free (pvsopenrows);
+    free (pvsrows);
+    free (pvsnodes);
+    free (pvsclosed);
+    pvsrows = NULL;
+    pvsopenrows = NULL;
+    pvsnodes = NULL;
+    pvsclosed = NULL;
+    numpvsclosed = 0;
+    pvsviewrow = NULL;
+    pvsactive = false;
+
+    if (M_CheckParm ("-nopvs") || !numnodes)
+	return;
+
+    pvsrowwords = (numsubsectors+31)>>5;
+    pvsdeadline = I_GetTimeMS () + PVSBUILDTIME;
+
+    // Outlines start out from a box around the map.
+    M_ClearBox (bbox);
+    for (i=0 ; i<numvertexes ; i++)
+	M_AddToBox (bbox, vertexes[i].x, vertexes[i].y);
+
+    box[0].x = box[3].x = (double)bbox[BOXLEFT]/FRACUNIT - 64;
+    box[1].x = box[2].x = (double)bbox[BOXRIGHT]/FRACUNIT + 64;
+    box[0].y = box[1].y = (double)bbox[BOXBOTTOM]/FRACUNIT - 64;
+    box[2].y = box[3].y = (double)bbox[BOXTOP]/FRACUNIT + 64;
+
+    pvspolys = calloc (numsubsectors, sizeof(*pvspolys));
+    pvssubportals = malloc ((numsubsectors+1)*sizeof(*pvssubportals));
+    if (!pvspolys || !pvssubportals)
+	I_Error ("R_BuildPVS: no memory");
+
+    R_LeafPolygons (numnodes-1, box, 4);
+
+    for (i=0 ; i<numsubsectors ; i++)
+	if (!pvspolys[i].numpoints)
+	{
+	    R_FreePVS ();
+	    return;
+	}
+
+    pvsflowthreads = I_NumThreads ();
+    pvsflowmight = malloc (pvsflowthreads*(MAXPVSDEPTH+1)
+			   *pvsrowwords*sizeof(unsigned));
+    pvsnodes = malloc (numnodes);
+    if (!pvsflowmight || !pvsnodes)
+	I_Error ("R_BuildPVS: no memory");
+
+    R_FindClosedLines ();
+
+    // The open sets first, as the ones that always hold,
+    //  then the closed ones if there is time left.
+    if (numpvsclosed)
+    {
+	pvsopenall = true;
+	pvsopenrows = R_FlowSets ();
+    }
+    if (!pvsopenrows || I_GetTimeMS () <= pvsdeadline)
+    {
+	pvsopenall = false;
+	pvsrows = R_FlowSets ();
+    }
+    if (!pvsrows)
+	pvsrows = pvsopenrows;
+    if (!numpvsclosed)
+	pvsopenrows = pvsrows;
+
+    R_FreePVS ();
+
+    if (!pvsrows)
+    {
+	free (pvsnodes);
+	free (pvsclosed);
+	pvsnodes = NULL;
+	pvsclosed = NULL;
+	numpvsclosed = 0;
+    }
+}
+
+
+
+//
+// R_MarkPVSNodes
+// Returns true if anything under bspnum is in pvsrow.
+//
+static boolean R_MarkPVSNodes (int bspnum)
+{
+    boolean	front;
+    boolean	back;
+
+    if (bspnum & NF_SUBSECTOR)
+	return R_PVSSubsector (bspnum&(~NF_SUBSECTOR)) != 0;
+
+    front = R_MarkPVSNodes (nodes[bspnum].children[0]);
+    back = R_MarkPVSNodes (nodes[bspnum].children[1]);
+    pvsnodes[bspnum] = front || back;
+
+    return pvsnodes[bspnum];
+}
+
+
+//
+// R_SetupPVS
+//
+void R_SetupPVS (void)
+{
+    pvsclosed_t*	closed;
+    sector_t*	front;
+    sector_t*	back;
+    unsigned*	openrow;
+    int		sub;
+    int		i;
+
+    pvsactive = false;
+
+    if (!pvsrows)
+	return;
+
+    sub = R_PointInSubsector (viewx, viewy) - subsectors;
+    pvsrow = pvsrows + sub*pvsrowwords;
+    openrow = pvsopenrows ? pvsopenrows + sub*pvsrowwords : NULL;
+
+    // The closed sets count the closed lines as walls. One
+    //  that moves or stays open only matters from here if
+    //  sight could reach it with everything open.
+    for (i=0, closed=pvsclosed ; i<numpvsclosed ; i++, closed++)
+    {
+	front = closed->line->frontsector;
+	back = closed->line->backsector;
+
+	if (front->floorheight == front->oldfloorheight
+	    && front->ceilingheight == front->oldceilingheight
+	    && back->floorheight == back->oldfloorheight
+	    && back->ceilingheight == back->oldceilingheight
+	    && R_ClosedLine (front, back))
+	    continue;
+
+	// the open sets ran out of room
+	if (!openrow)
+	    return;
+
+	if (PVSTEST (openrow, closed->sub))
+	{
+	    pvsrow = openrow;
+	    break;
+	}
+    }
+
+    if (pvsrow != pvsviewrow)
+    {
+	R_MarkPVSNodes (numnodes-1);
+	pvsviewrow = pvsrow;
+    }
+
+    pvsactive = true;
+}
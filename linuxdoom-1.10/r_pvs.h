@@ -0,0 +1,61 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Potentially visible sets, used to prune the BSP walk.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __R_PVS__
+#define __R_PVS__
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// True when the sets can be used for this frame,
+//  set up by R_SetupPVS.
+extern boolean		pvsactive;
+
+// The set of the subsector the view point is in,
+//  one bit per subsector.
+extern unsigned*	pvsrow;
+
+// For each node, true if any subsector under it
+//  is in pvsrow.
+extern byte*		pvsnodes;
+
+#define R_PVSSubsector(num) \
+    (pvsrow[(num)>>5] & (1u<<((num)&31)))
+
+
+// Called by P_SetupLevel once the map is loaded, taking
+//  at most a couple of seconds. -nopvs leaves the sets out.
+void R_BuildPVS (void);
+
+// Called by R_SetupFrame once the view point is known.
+void R_SetupPVS (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
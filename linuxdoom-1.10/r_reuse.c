@@ -0,0 +1,389 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Reuse of the last view. After each frame, everything
+//	 it was drawn from is written down: the view, the
+//	 sectors of the subsectors the strips drew, the things
+//	 in them, the sides of their segs and the sectors
+//	 behind those. When the next frame would be drawn from
+//	 exactly the same, the saved view is put back instead.
+//
+//-----------------------------------------------------------------------------
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+
+#include "z_zone.h"
+#include "i_system.h"
+#include "i_thread.h"
+
+#include "r_local.h"
+#include "r_sky.h"
+#include "r_state.h"
+#include "v_video.h"
+
+#ifdef __GNUG__
+#pragma implementation "r_reuse.h"
+#endif
+#include "r_reuse.h"
+
+
+
+typedef struct
+{
+    int*	data;
+    int		length;
+    int		size;
+
+} snapshot_t;
+
+
+boolean			viewreuse = true;
+int			reusedframes;
+
+// The subsectors each strip drew.
+static int*		stripsubs[MAXTHREADS];
+static int		numstripsubs[MAXTHREADS];
+static int		maxstripsubs[MAXTHREADS];
+static THREADLOCAL int*	stripsub_p;
+
+// The subsectors of the saved view, each once.
+static int*		viewsubs;
+static int		numviewsubs;
+static int		maxviewsubs;
+static int*		viewsubframe;
+
+// What the saved view was drawn from, and the same now.
+static snapshot_t	drawnstate;
+static snapshot_t	nowstate;
+static snapshot_t*	snap;
+
+// The window as drawn, unless the view is buffered,
+//  see R_InitBuffer.
+static byte*		savedview;
+static int		savedviewsize;
+
+static boolean		viewsaved;
+
+
+
+//
+// R_StartDrawnSubsectors
+//
+void R_StartDrawnSubsectors (int strip)
+{
+    if (!viewreuse)
+	return;
+
+    // every subsector is drawn at most once per strip
+    if (maxstripsubs[strip] < numsubsectors)
+    {
+	free (stripsubs[strip]);
+	stripsubs[strip] = malloc (numsubsectors*sizeof(*stripsubs[strip]));
+	if (!stripsubs[strip])
+	    I_Error ("R_StartDrawnSubsectors: no memory for %i subsectors",
+		     numsubsectors);
+	maxstripsubs[strip] = numsubsectors;
+    }
+    stripsub_p = stripsubs[strip];
+}
+
+
+//
+// R_DrawnSubsector
+//
+void R_DrawnSubsector (int num)
+{
+    if (viewreuse)
+	*stripsub_p++ = num;
+}
+
+
+//
+// R_FinishDrawnSubsectors
+//
+void R_FinishDrawnSubsectors (int strip)
+{
+    if (viewreuse)
+	numstripsubs[strip] = stripsub_p - stripsubs[strip];
+}
+
+
+
+//
+// R_Snap
+//
+static void R_Snap (int value)
+{
+    if (snap->length == snap->size)
+    {
+	snap->size = snap->size ? snap->size*2 : 1024;
+	snap->data = realloc (snap->data, snap->size*sizeof(*snap->data));
+	if (!snap->data)
+	    I_Error ("R_Snap: no memory");
+    }
+    snap->data[snap->length++] = value;
+}
+
+
+//
+// R_SnapSector
+// Things are only drawn from the sectors of drawn
+//  subsectors, sectors behind their segs only matter
+//  for their heights and flats.
+//
+static void R_SnapSector (sector_t* sec)
+{
+    R_Snap (sec->floorheight);
+    R_Snap (sec->ceilingheight);
+    R_Snap (flattranslation[sec->floorpic]);
+    R_Snap (flattranslation[sec->ceilingpic]);
+    R_Snap (sec->lightlevel);
+}
+
+
+//
+// R_SnapThings
+// Returns true when one of them is drawn with
+//  the fuzz effect, which differs every frame.
+//
+static boolean R_SnapThings (sector_t* sec)
+{
+    mobj_t*	thing;
+    boolean	fuzzy;
+
+    fuzzy = false;
+
+    for (thing = sec->thinglist ; thing ; thing = thing->snext)
+    {
+	// as R_ProjectSprite has it
+	if (fractionaltic < FRACUNIT)
+	{
+	    R_Snap (R_Interpolate (thing->oldx, thing->x));
+	    R_Snap (R_Interpolate (thing->oldy, thing->y));
+	    R_Snap (R_Interpolate (thing->oldz, thing->z));
+	}
+	else
+	{
+	    R_Snap (thing->x);
+	    R_Snap (thing->y);
+	    R_Snap (thing->z);
+	}
+	R_Snap (thing->angle);
+	R_Snap (thing->sprite);
+	R_Snap (thing->frame);
+	R_Snap (thing->flags & (MF_SHADOW|MF_TRANSLATION));
+
+	if (thing->flags & MF_SHADOW)
+	    fuzzy = true;
+    }
+
+    // end of the list
+    R_Snap (-1);
+    return fuzzy;
+}
+
+
+//
+// R_TakeSnapshot
+// Writes down what the view in viewsubs is drawn from.
+// Returns true when it can't be reused anyway.
+//
+static boolean R_TakeSnapshot (snapshot_t* to)
+{
+    subsector_t*	sub;
+    seg_t*		seg;
+    side_t*		side;
+    pspdef_t*		psp;
+    boolean		fuzzy;
+    int			i;
+    int			j;
+
+    snap = to;
+    snap->length = 0;
+
+    R_Snap (viewx);
+    R_Snap (viewy);
+    R_Snap (viewz);
+    R_Snap (viewangle);
+    R_Snap (extralight);
+    R_Snap (viewplayer->fixedcolormap);
+    R_Snap (skytexture);
+    R_Snap (viewplayer->mo->subsector->sector->lightlevel);
+
+    // the weapon, drawn with the fuzz effect while invisible
+    fuzzy = viewplayer->powers[pw_invisibility] != 0;
+    for (i=0, psp=viewplayer->psprites ; i<NUMPSPRITES ; i++, psp++)
+    {
+	R_Snap (psp->state ? psp->state - states : -1);
+	R_Snap (psp->sx);
+	R_Snap (psp->sy);
+    }
+
+    validcount++;
+
+    for (i=0 ; i<numviewsubs ; i++)
+    {
+	sub = &subsectors[viewsubs[i]];
+	if (sub->sector->validcount == validcount)
+	    continue;
+	sub->sector->validcount = validcount;
+
+	R_SnapSector (sub->sector);
+	if (R_SnapThings (sub->sector))
+	    fuzzy = true;
+    }
+
+    for (i=0 ; i<numviewsubs ; i++)
+    {
+	sub = &subsectors[viewsubs[i]];
+	seg = &segs[sub->firstline];
+
+	for (j=0 ; j<sub->numlines ; j++, seg++)
+	{
+	    side = seg->sidedef;
+	    R_Snap (side->textureoffset);
+	    R_Snap (side->rowoffset);
+	    R_Snap (texturetranslation[side->toptexture]);
+	    R_Snap (texturetranslation[side->midtexture]);
+	    R_Snap (texturetranslation[side->bottomtexture]);
+
+	    if (seg->backsector
+		&& seg->backsector->validcount != validcount)
+	    {
+		seg->backsector->validcount = validcount;
+		R_SnapSector (seg->backsector);
+	    }
+	}
+    }
+
+    return fuzzy;
+}
+
+
+
+//
+// R_ReuseView
+//
+boolean R_ReuseView (void)
+{
+    byte*	dest;
+    int		y;
+
+    if (!viewsaved)
+	return false;
+
+    R_TakeSnapshot (&nowstate);
+
+    if (nowstate.length != drawnstate.length
+	|| memcmp (nowstate.data, drawnstate.data,
+		   drawnstate.length*sizeof(*drawnstate.data)))
+	return false;
+
+    // the menu and messages may have been drawn over it
+    if (viewbuffered)
+	R_FinishView (0, scaledviewwidth);
+    else
+    {
+	dest = screens[0] + viewwindowy*SCREENWIDTH + viewwindowx;
+	for (y=0 ; y<viewwindowheight ; y++, dest += SCREENWIDTH)
+	    memcpy (dest, savedview + y*viewwindowwidth, viewwindowwidth);
+    }
+
+    reusedframes++;
+    return true;
+}
+
+
+//
+// R_SaveView
+//
+void R_SaveView (int strips)
+{
+    byte*	src;
+    int*	sub;
+    int		size;
+    int		i;
+    int		j;
+
+    viewsaved = false;
+
+    if (!viewreuse)
+	return;
+
+    if (maxviewsubs < numsubsectors)
+    {
+	free (viewsubs);
+	free (viewsubframe);
+	viewsubs = malloc (numsubsectors*sizeof(*viewsubs));
+	viewsubframe = calloc (numsubsectors, sizeof(*viewsubframe));
+	if (!viewsubs || !viewsubframe)
+	    I_Error ("R_SaveView: no memory for %i subsectors",
+		     numsubsectors);
+	maxviewsubs = numsubsectors;
+    }
+
+    // the strips overlap at their edges
+    numviewsubs = 0;
+    for (i=0 ; i<strips ; i++)
+    {
+	for (j=0, sub=stripsubs[i] ; j<numstripsubs[i] ; j++, sub++)
+	{
+	    if (viewsubframe[*sub] == framecount)
+		continue;
+	    viewsubframe[*sub] = framecount;
+	    viewsubs[numviewsubs++] = *sub;
+	}
+    }
+
+    if (R_TakeSnapshot (&drawnstate))
+	return;
+
+    // a buffered view is still in viewbuffer
+    if (!viewbuffered)
+    {
+	size = viewwindowwidth*viewwindowheight;
+	if (savedviewsize < size)
+	{
+	    if (savedview)
+		Z_Free (savedview);
+	    savedview = Z_Malloc (size, PU_STATIC, 0);
+	    savedviewsize = size;
+	}
+
+	src = screens[0] + viewwindowy*SCREENWIDTH + viewwindowx;
+	for (i=0 ; i<viewwindowheight ; i++, src += SCREENWIDTH)
+	    memcpy (savedview + i*viewwindowwidth, src, viewwindowwidth);
+    }
+
+    viewsaved = true;
+}
+
+
+//
+// R_ForgetView
+//
+void R_ForgetView (void)
+{
+    viewsaved = false;
+}
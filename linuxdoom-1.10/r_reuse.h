@@ -0,0 +1,68 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Reuse of the last view while nothing it was drawn
+//	 from has changed, e.g. paused or behind a menu.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __R_REUSE__
+#define __R_REUSE__
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// False with -noreuse, every frame is rendered.
+extern boolean		viewreuse;
+
+// Frames that were put back instead of rendered.
+extern int		reusedframes;
+
+
+// Each strip lists the subsectors it drew,
+//  called by the R_RenderStrip* functions
+//  and R_RenderPlayerView.
+void R_StartDrawnSubsectors (int strip);
+void R_FinishDrawnSubsectors (int strip);
+
+// Called by R_Subsector.
+void R_DrawnSubsector (int num);
+
+// Called by R_RenderPlayerView once the view is set up.
+// Puts the saved view back into the window and returns
+//  true when nothing it was drawn from has changed.
+boolean R_ReuseView (void);
+
+// Called by R_RenderPlayerView after a frame is drawn,
+//  before R_RestoreSectors.
+void R_SaveView (int strips);
+
+// The saved view can't be used anymore. Called by
+//  R_InitBuffer and P_SetupLevel.
+void R_ForgetView (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -39,60 +39,71 @@ rcsid[] = "$Id: r_segs.c,v 1.3 1997/01/29 20:10:19 b1 Exp $";
 #include "r_local.h"
 #include "r_sky.h"
 
+#ifdef R_SIMD
+#include <emmintrin.h>
+#endif
+
 
 // OPTIMIZE: closed two sided lines as single sided
 
 // True if any of the segs textures might be visible.
-boolean		segtextured;	
+THREADLOCAL boolean		segtextured;	
 
 // False if the back side is the same plane.
-boolean		markfloor;	
-boolean		markceiling;
+THREADLOCAL boolean		markfloor;	
+THREADLOCAL boolean		markceiling;
 
-boolean		maskedtexture;
-int		toptexture;
-int		bottomtexture;
-int		midtexture;
+THREADLOCAL boolean		maskedtexture;
+THREADLOCAL int		toptexture;
+THREADLOCAL int		bottomtexture;
+THREADLOCAL int		midtexture;
 
 
-angle_t		rw_normalangle;
+THREADLOCAL angle_t		rw_normalangle;
 // angle to line origin
-int		rw_angle1;	
+THREADLOCAL int		rw_angle1;	
 
 //
 // regular wall
 //
-int		rw_x;
-int		rw_stopx;
-angle_t		rw_centerangle;
-fixed_t		rw_offset;
-fixed_t		rw_distance;
-fixed_t		rw_scale;
-fixed_t		rw_scalestep;
-fixed_t		rw_midtexturemid;
-fixed_t		rw_toptexturemid;
-fixed_t		rw_bottomtexturemid;
+THREADLOCAL int		rw_x;
+THREADLOCAL int		rw_stopx;
+THREADLOCAL angle_t		rw_centerangle;
+THREADLOCAL fixed_t		rw_offset;
+THREADLOCAL fixed_t		rw_distance;
+THREADLOCAL fixed_t		rw_scale;
+THREADLOCAL fixed_t		rw_scalestep;
+THREADLOCAL fixed_t		rw_midtexturemid;
+THREADLOCAL fixed_t		rw_toptexturemid;
+THREADLOCAL fixed_t		rw_bottomtexturemid;
+
+THREADLOCAL int		worldtop;
+THREADLOCAL int		worldbottom;
+THREADLOCAL int		worldhigh;
+THREADLOCAL int		worldlow;
+
+THREADLOCAL fixed_t		pixhigh;
+THREADLOCAL fixed_t		pixlow;
+THREADLOCAL fixed_t		pixhighstep;
+THREADLOCAL fixed_t		pixlowstep;
 
-int		worldtop;
-int		worldbottom;
-int		worldhigh;
-int		worldlow;
+THREADLOCAL fixed_t		topfrac;
+THREADLOCAL fixed_t		topstep;
 
-fixed_t		pixhigh;
-fixed_t		pixlow;
-fixed_t		pixhighstep;
-fixed_t		pixlowstep;
+THREADLOCAL fixed_t		bottomfrac;
+THREADLOCAL fixed_t		bottomstep;
 
-fixed_t		topfrac;
-fixed_t		topstep;
 
-fixed_t		bottomfrac;
-fixed_t		bottomstep;
+THREADLOCAL lighttable_t**	walllights;
 
+THREADLOCAL short*		maskedtexturecol;
 
-lighttable_t**	walllights;
 
-short*		maskedtexturecol;
+
+// Wall columns are batched per tier, see R_BatchColumn.
+THREADLOCAL colbatch_t		topbatch;
+THREADLOCAL colbatch_t		midbatch;
+THREADLOCAL colbatch_t		bottombatch;
 
 
 
@@ -106,7 +117,7 @@ R_RenderMaskedSegRange
   int		x2 )
 {
     unsigned	index;
-    column_t*	col;
+    cpatch_t*	patch;
     int		lightnum;
     int		texnum;
     
@@ -118,6 +129,7 @@ R_RenderMaskedSegRange
     frontsector = curline->frontsector;
     backsector = curline->backsector;
     texnum = texturetranslation[curline->sidedef->midtexture];
+    patch = R_CacheMaskedTexture (texnum);
 	
     lightnum = (frontsector->lightlevel >> LIGHTSEGSHIFT)+extralight;
 
@@ -157,6 +169,9 @@ R_RenderMaskedSegRange
 			
     if (fixedcolormap)
 	dc_colormap = fixedcolormap;
+
+    // posts are drawn within themselves
+    colfunc = columnfuncs[COLUMN_INSIDE];
     
     // draw the columns
     for (dc_x = x1 ; dc_x <= x2 ; dc_x++)
@@ -178,15 +193,14 @@ R_RenderMaskedSegRange
 	    dc_iscale = 0xffffffffu / (unsigned)spryscale;
 	    
 	    // draw the texture
-	    col = (column_t *)( 
-		(byte *)R_GetColumn(texnum,maskedtexturecol[dc_x]) -3);
-			
-	    R_DrawMaskedColumn (col);
+	    R_DrawMaskedColumn (patch, maskedtexturecol[dc_x]
+				& texturewidthmask[texnum]);
 	    maskedtexturecol[dc_x] = MAXSHORT;
 	}
 	spryscale += rw_scalestep;
     }
-	
+
+    R_FlushMaskedColumns ();
 }
 
 
@@ -203,168 +217,381 @@ R_RenderMaskedSegRange
 #define HEIGHTBITS		12
 #define HEIGHTUNIT		(1<<HEIGHTBITS)
 
-void R_RenderSegLoop (void)
+//
+// R_SetWallColumn
+// Sets up the column drawer for column col of tex,
+//  from mip level miplevel or the nearest one it has.
+//
+// The texture and mip level of the last one,
+//  for R_QueueColumn.
+THREADLOCAL int			walltexture;
+
+static void
+R_SetWallColumn
+( int		tex,
+  int		col,
+  fixed_t	texturemid,
+  fixed_t	iscale,
+  int		miplevel )
+{
+    dc_source = R_GetMipColumn (tex, col, &miplevel);
+    dc_texturemid = texturemid >> miplevel;
+    dc_iscale = iscale >> miplevel;
+    walltexture = tex*MIPLEVELS + miplevel;
+
+    // mip levels are halved the same way
+    R_PickColumnFunc ((textureheight[tex]>>FRACBITS) >> miplevel);
+}
+
+
+//
+// R_WallColumn
+//
+static void R_WallColumn (colbatch_t* batch)
+{
+    if (sortwalls)
+	R_QueueColumn (walltexture);
+    else
+	R_BatchColumn (batch);
+}
+
+//
+// Per column values for the wall range being drawn,
+//  indexed by x. R_SetupSegColumns works all of them
+//  out before R_RenderSegLoop draws anything.
+// Padded so the vector loop can run over the end.
+//
+#define SEGCOLPAD		4
+
+THREADLOCAL fixed_t		segscale[MAXWIDTH+SEGCOLPAD];
+THREADLOCAL int			segtop[MAXWIDTH+SEGCOLPAD];
+THREADLOCAL int			segbottom[MAXWIDTH+SEGCOLPAD];
+THREADLOCAL int			seghigh[MAXWIDTH+SEGCOLPAD];
+THREADLOCAL int			seglow[MAXWIDTH+SEGCOLPAD];
+THREADLOCAL int			segtexturecol[MAXWIDTH];
+THREADLOCAL lighttable_t*	segcolormap[MAXWIDTH];
+THREADLOCAL fixed_t		segiscale[MAXWIDTH];
+THREADLOCAL int			segmiplevel[MAXWIDTH];
+
+
+//
+// R_StepSegColumns
+// Fills in the stepped values: the scale, the rows the
+//  wall spans, and the rows the upper and lower textures
+//  end and start on, all before any clipping.
+// start + i*step wraps the same as adding step i times.
+//
+static void R_StepSegColumns (void)
+{
+    int		x;
+    unsigned	i;
+#ifdef R_SIMD
+    __m128i	scale;
+    __m128i	top;
+    __m128i	bottom;
+    __m128i	high;
+    __m128i	low;
+    __m128i	scalestep;
+    __m128i	topstep4;
+    __m128i	bottomstep4;
+    __m128i	highstep;
+    __m128i	lowstep;
+    __m128i	round;
+
+    round = _mm_set1_epi32 (HEIGHTUNIT-1);
+
+    // lane n starts n steps in
+#define R_LaneStart(start,step) \
+    _mm_setr_epi32 ((start), (unsigned)(start) + (step), \
+		    (unsigned)(start) + 2u*(step), \
+		    (unsigned)(start) + 3u*(step))
+
+    scale = R_LaneStart (rw_scale, rw_scalestep);
+    top = R_LaneStart (topfrac, topstep);
+    bottom = R_LaneStart (bottomfrac, bottomstep);
+    high = R_LaneStart (pixhigh, pixhighstep);
+    low = R_LaneStart (pixlow, pixlowstep);
+#undef R_LaneStart
+
+    scalestep = _mm_set1_epi32 ((unsigned)rw_scalestep*4);
+    topstep4 = _mm_set1_epi32 ((unsigned)topstep*4);
+    bottomstep4 = _mm_set1_epi32 ((unsigned)bottomstep*4);
+    highstep = _mm_set1_epi32 ((unsigned)pixhighstep*4);
+    lowstep = _mm_set1_epi32 ((unsigned)pixlowstep*4);
+
+    for (x=rw_x ; x<rw_stopx ; x+=4)
+    {
+	_mm_storeu_si128 ((__m128i *)&segscale[x], scale);
+	_mm_storeu_si128 ((__m128i *)&segtop[x],
+			  _mm_srai_epi32 (_mm_add_epi32 (top, round),
+					  HEIGHTBITS));
+	_mm_storeu_si128 ((__m128i *)&segbottom[x],
+			  _mm_srai_epi32 (bottom, HEIGHTBITS));
+	_mm_storeu_si128 ((__m128i *)&seghigh[x],
+			  _mm_srai_epi32 (high, HEIGHTBITS));
+	_mm_storeu_si128 ((__m128i *)&seglow[x],
+			  _mm_srai_epi32 (_mm_add_epi32 (low, round),
+					  HEIGHTBITS));
+
+	scale = _mm_add_epi32 (scale, scalestep);
+	top = _mm_add_epi32 (top, topstep4);
+	bottom = _mm_add_epi32 (bottom, bottomstep4);
+	high = _mm_add_epi32 (high, highstep);
+	low = _mm_add_epi32 (low, lowstep);
+    }
+#else
+    for (x=rw_x, i=0 ; x<rw_stopx ; x++, i++)
+    {
+	segscale[x] = (unsigned)rw_scale + i*rw_scalestep;
+	segtop[x] = (fixed_t)((unsigned)topfrac + i*topstep
+			      + HEIGHTUNIT-1) >> HEIGHTBITS;
+	segbottom[x] = (fixed_t)((unsigned)bottomfrac
+				 + i*bottomstep) >> HEIGHTBITS;
+	seghigh[x] = (fixed_t)((unsigned)pixhigh
+			       + i*pixhighstep) >> HEIGHTBITS;
+	seglow[x] = (fixed_t)((unsigned)pixlow + i*pixlowstep
+			      + HEIGHTUNIT-1) >> HEIGHTBITS;
+    }
+#endif
+
+    // leave the steppers where the old loop did
+    i = rw_stopx - rw_x;
+    rw_scale = (unsigned)rw_scale + i*rw_scalestep;
+    topfrac = (unsigned)topfrac + i*topstep;
+    bottomfrac = (unsigned)bottomfrac + i*bottomstep;
+    if (toptexture)
+	pixhigh = (unsigned)pixhigh + i*pixhighstep;
+    if (bottomtexture)
+	pixlow = (unsigned)pixlow + i*pixlowstep;
+}
+
+
+//
+// R_SetupSegColumns
+// Everything R_RenderSegLoop needs per column: the
+//  texture column, lighting and mip level, and the
+//  tier ranges after clipping. Marks the floor and
+//  ceiling planes and updates the clip arrays.
+// On return segtop/segbottom hold the clipped wall,
+//  seghigh the last row of the upper texture and
+//  seglow the first row of the lower one; either
+//  is outside the wall when there is none.
+//
+static void R_SetupSegColumns (void)
 {
     angle_t		angle;
     unsigned		index;
+    int			x;
     int			yl;
     int			yh;
     int			mid;
-    fixed_t		texturecolumn;
     int			top;
     int			bottom;
 
-    //texturecolumn = 0;				// shut up compiler warning
+    R_StepSegColumns ();
 	
-    for ( ; rw_x < rw_stopx ; rw_x++)
+    // texturecolumn and lighting are independent of wall tiers
+    if (segtextured)
+    {
+	for (x=rw_x ; x<rw_stopx ; x++)
+	{
+	    // calculate texture offset
+	    angle = (rw_centerangle + xtoviewangle[x])>>ANGLETOFINESHIFT;
+	    segtexturecol[x] = (rw_offset
+				- FixedMul(finetangent[angle],rw_distance))
+		>> FRACBITS;
+	    
+	    // calculate lighting
+	    index = segscale[x]>>LIGHTSCALESHIFT;
+
+	    if (index >=  MAXLIGHTSCALE )
+		index = MAXLIGHTSCALE-1;
+
+	    segcolormap[x] = walllights[index];
+	    segiscale[x] = 0xffffffffu / (unsigned)segscale[x];
+	    segmiplevel[x] = R_MipLevel (segiscale[x]);
+	}
+    }
+
+    for (x=rw_x ; x<rw_stopx ; x++)
     {
 	// mark floor / ceiling areas
-	yl = (topfrac+HEIGHTUNIT-1)>>HEIGHTBITS;
+	yl = segtop[x];
 
 	// no space above wall?
-	if (yl < ceilingclip[rw_x]+1)
-	    yl = ceilingclip[rw_x]+1;
+	if (yl < ceilingclip[x]+1)
+	    yl = ceilingclip[x]+1;
 	
 	if (markceiling)
 	{
-	    top = ceilingclip[rw_x]+1;
+	    top = ceilingclip[x]+1;
 	    bottom = yl-1;
 
-	    if (bottom >= floorclip[rw_x])
-		bottom = floorclip[rw_x]-1;
+	    if (bottom >= floorclip[x])
+		bottom = floorclip[x]-1;
 
 	    if (top <= bottom)
 	    {
-		ceilingplane->top[rw_x] = top;
-		ceilingplane->bottom[rw_x] = bottom;
+		ceilingplane->top[x] = top;
+		ceilingplane->bottom[x] = bottom;
 	    }
 	}
 		
-	yh = bottomfrac>>HEIGHTBITS;
+	yh = segbottom[x];
 
-	if (yh >= floorclip[rw_x])
-	    yh = floorclip[rw_x]-1;
+	if (yh >= floorclip[x])
+	    yh = floorclip[x]-1;
 
 	if (markfloor)
 	{
 	    top = yh+1;
-	    bottom = floorclip[rw_x]-1;
-	    if (top <= ceilingclip[rw_x])
-		top = ceilingclip[rw_x]+1;
+	    bottom = floorclip[x]-1;
+	    if (top <= ceilingclip[x])
+		top = ceilingclip[x]+1;
 	    if (top <= bottom)
 	    {
-		floorplane->top[rw_x] = top;
-		floorplane->bottom[rw_x] = bottom;
+		floorplane->top[x] = top;
+		floorplane->bottom[x] = bottom;
 	    }
 	}
-	
-	// texturecolumn and lighting are independent of wall tiers
-	if (segtextured)
-	{
-	    // calculate texture offset
-	    angle = (rw_centerangle + xtoviewangle[rw_x])>>ANGLETOFINESHIFT;
-	    texturecolumn = rw_offset-FixedMul(finetangent[angle],rw_distance);
-	    texturecolumn >>= FRACBITS;
-	    // calculate lighting
-	    index = rw_scale>>LIGHTSCALESHIFT;
-
-	    if (index >=  MAXLIGHTSCALE )
-		index = MAXLIGHTSCALE-1;
 
-	    dc_colormap = walllights[index];
-	    dc_x = rw_x;
-	    dc_iscale = 0xffffffffu / (unsigned)rw_scale;
-	}
+	segtop[x] = yl;
+	segbottom[x] = yh;
 	
-	// draw the wall tiers
 	if (midtexture)
 	{
 	    // single sided line
-	    dc_yl = yl;
-	    dc_yh = yh;
-	    dc_texturemid = rw_midtexturemid;
-	    dc_source = R_GetColumn(midtexture,texturecolumn);
-	    colfunc ();
-	    ceilingclip[rw_x] = viewheight;
-	    floorclip[rw_x] = -1;
+	    ceilingclip[x] = viewheight;
+	    floorclip[x] = -1;
+	    continue;
 	}
-	else
+
+	// two sided line
+	if (toptexture)
 	{
-	    // two sided line
-	    if (toptexture)
-	    {
-		// top wall
-		mid = pixhigh>>HEIGHTBITS;
-		pixhigh += pixhighstep;
-
-		if (mid >= floorclip[rw_x])
-		    mid = floorclip[rw_x]-1;
-
-		if (mid >= yl)
-		{
-		    dc_yl = yl;
-		    dc_yh = mid;
-		    dc_texturemid = rw_toptexturemid;
-		    dc_source = R_GetColumn(toptexture,texturecolumn);
-		    colfunc ();
-		    ceilingclip[rw_x] = mid;
-		}
-		else
-		    ceilingclip[rw_x] = yl-1;
-	    }
+	    // top wall
+	    mid = seghigh[x];
+
+	    if (mid >= floorclip[x])
+		mid = floorclip[x]-1;
+
+	    if (mid >= yl)
+		ceilingclip[x] = mid;
 	    else
-	    {
-		// no top wall
-		if (markceiling)
-		    ceilingclip[rw_x] = yl-1;
-	    }
+		ceilingclip[x] = yl-1;
+	    seghigh[x] = mid;
+	}
+	else
+	{
+	    // no top wall
+	    if (markceiling)
+		ceilingclip[x] = yl-1;
+	    seghigh[x] = yl-1;
+	}
 			
-	    if (bottomtexture)
-	    {
-		// bottom wall
-		mid = (pixlow+HEIGHTUNIT-1)>>HEIGHTBITS;
-		pixlow += pixlowstep;
+	if (bottomtexture)
+	{
+	    // bottom wall
+	    mid = seglow[x];
 
-		// no space above wall?
-		if (mid <= ceilingclip[rw_x])
-		    mid = ceilingclip[rw_x]+1;
+	    // no space above wall?
+	    if (mid <= ceilingclip[x])
+		mid = ceilingclip[x]+1;
 		
-		if (mid <= yh)
-		{
-		    dc_yl = mid;
-		    dc_yh = yh;
-		    dc_texturemid = rw_bottomtexturemid;
-		    dc_source = R_GetColumn(bottomtexture,
-					    texturecolumn);
-		    colfunc ();
-		    floorclip[rw_x] = mid;
-		}
-		else
-		    floorclip[rw_x] = yh+1;
-	    }
+	    if (mid <= yh)
+		floorclip[x] = mid;
 	    else
-	    {
-		// no bottom wall
-		if (markfloor)
-		    floorclip[rw_x] = yh+1;
-	    }
+		floorclip[x] = yh+1;
+	    seglow[x] = mid;
+	}
+	else
+	{
+	    // no bottom wall
+	    if (markfloor)
+		floorclip[x] = yh+1;
+	    seglow[x] = yh+1;
+	}
+	
+	if (maskedtexture)
+	{
+	    // save texturecol
+	    //  for backdrawing of masked mid texture
+	    maskedtexturecol[x] = segtexturecol[x];
+	}
+    }
+}
+
+
+void R_RenderSegLoop (void)
+{
+    R_SetupSegColumns ();
+
+    if (!segtextured)
+    {
+	rw_x = rw_stopx;
+	return;
+    }
+
+    for ( ; rw_x < rw_stopx ; rw_x++)
+    {
+	dc_colormap = segcolormap[rw_x];
+	dc_x = rw_x;
+	
+	// draw the wall tiers
+	if (midtexture)
+	{
+	    // single sided line
+	    dc_yl = segtop[rw_x];
+	    dc_yh = segbottom[rw_x];
+	    R_SetWallColumn (midtexture, segtexturecol[rw_x],
+			     rw_midtexturemid, segiscale[rw_x],
+			     segmiplevel[rw_x]);
+	    R_WallColumn (&midbatch);
+	    continue;
+	}
+
+	// two sided line
+	if (toptexture && seghigh[rw_x] >= segtop[rw_x])
+	{
+	    // top wall
+	    dc_yl = segtop[rw_x];
+	    dc_yh = seghigh[rw_x];
+	    R_SetWallColumn (toptexture, segtexturecol[rw_x],
+			     rw_toptexturemid, segiscale[rw_x],
+			     segmiplevel[rw_x]);
+	    R_WallColumn (&topbatch);
+	}
 			
-	    if (maskedtexture)
-	    {
-		// save texturecol
-		//  for backdrawing of masked mid texture
-		maskedtexturecol[rw_x] = texturecolumn;
-	    }
+	if (bottomtexture && seglow[rw_x] <= segbottom[rw_x])
+	{
+	    // bottom wall
+	    dc_yl = seglow[rw_x];
+	    dc_yh = segbottom[rw_x];
+	    R_SetWallColumn (bottomtexture, segtexturecol[rw_x],
+			     rw_bottomtexturemid, segiscale[rw_x],
+			     segmiplevel[rw_x]);
+	    R_WallColumn (&bottombatch);
 	}
-		
-	rw_scale += rw_scalestep;
-	topfrac += topstep;
-	bottomfrac += bottomstep;
     }
 }
 
 
 
+//
+// R_FlushWallColumns
+// Walls are batched or queued across segs, so whatever
+//  is still staged is drawn after the BSP walk.
+//
+void R_FlushWallColumns (void)
+{
+    R_DrawQueuedColumns ();
+    R_FlushColumns (&topbatch);
+    R_FlushColumns (&midbatch);
+    R_FlushColumns (&bottombatch);
+}
+
+
+
 
 //
 // R_StoreWallRange
@@ -382,20 +609,21 @@ R_StoreWallRange
     fixed_t		vtop;
     int			lightnum;
 
-    // don't overflow and crash
-    if (ds_p == &drawsegs[MAXDRAWSEGS])
-	return;		
-		
 #ifdef RANGECHECK
     if (start >=viewwidth || start > stop)
 	I_Error ("Bad R_RenderWallRange: %i to %i", start , stop);
 #endif
+
+    // make room for the drawseg and its three
+    //  opening ranges (masked, top and bottom clip)
+    R_CheckDrawSegs ();
+    R_CheckOpenings (3*(stop-start+1));
     
     sidedef = curline->sidedef;
     linedef = curline->linedef;
 
-    // mark the segment as visible for auto map
-    linedef->flags |= ML_MAPPED;
+    // the segment is marked visible for the auto map
+    //  by R_MapDrawnLines, after all strips are done
     
     // calculate rw_distance for scale calculation
     rw_normalangle = curline->angle + ANG90;
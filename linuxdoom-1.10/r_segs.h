@@ -35,6 +35,8 @@ R_RenderMaskedSegRange
   int		x1,
   int		x2 );
 
+void R_FlushWallColumns (void);
+
 
 #endif
 //-----------------------------------------------------------------------------
@@ -74,12 +74,12 @@ typedef struct
 fixed_t		pspritescale;
 fixed_t		pspriteiscale;
 
-lighttable_t**	spritelights;
+THREADLOCAL lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+short		negonearray[MAXWIDTH];
+short		screenheightarray[MAXWIDTH];
 
 
 //
@@ -302,9 +302,15 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
-vissprite_t*	vissprite_p;
-int		newvissprite;
+// Grown as needed, see R_NewVisSprite.
+THREADLOCAL vissprite_t*	vissprites;
+THREADLOCAL vissprite_t*	vissprite_p;
+THREADLOCAL int		maxvissprites;
+THREADLOCAL int		newvissprite;
+
+THREADLOCAL int*	spritesectors;
+THREADLOCAL int		numspritesectors;
+THREADLOCAL int		spritevalidcount;
 
 
 
@@ -316,7 +322,7 @@ void R_InitSprites (char** namelist)
 {
     int		i;
 	
-    for (i=0 ; i<SCREENWIDTH ; i++)
+    for (i=0 ; i<MAXWIDTH ; i++)
     {
 	negonearray[i] = -1;
     }
@@ -333,18 +339,40 @@ void R_InitSprites (char** namelist)
 void R_ClearSprites (void)
 {
     vissprite_p = vissprites;
+
+    // Sectors whose things were added are marked in a
+    //  thread local array instead of sector_t.validcount,
+    //  as every strip visits the same sectors.
+    if (numspritesectors < numsectors)
+    {
+	spritesectors = realloc (spritesectors,
+				 numsectors*sizeof(*spritesectors));
+	if (!spritesectors)
+	    I_Error ("R_ClearSprites: no memory for %i sectors", numsectors);
+	memset (spritesectors, 0, numsectors*sizeof(*spritesectors));
+	numspritesectors = numsectors;
+    }
+    spritevalidcount++;
 }
 
 
 //
 // R_NewVisSprite
 //
-vissprite_t	overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
-	return &overflowsprite;
+    int		count;
+
+    if (vissprite_p == vissprites + maxvissprites)
+    {
+	count = vissprite_p - vissprites;
+	maxvissprites = maxvissprites ? maxvissprites*2 : 128;
+	vissprites = realloc (vissprites, maxvissprites*sizeof(*vissprites));
+	if (!vissprites)
+	    I_Error ("R_NewVisSprite: no memory for %i vissprites",
+		     maxvissprites);
+	vissprite_p = vissprites + count;
+    }
     
     vissprite_p++;
     return vissprite_p-1;
@@ -358,29 +386,37 @@ vissprite_t* R_NewVisSprite (void)
 // Masked means: partly transparent, i.e. stored
 //  in posts/runs of opaque pixels.
 //
-short*		mfloorclip;
-short*		mceilingclip;
+THREADLOCAL short*		mfloorclip;
+THREADLOCAL short*		mceilingclip;
+
+THREADLOCAL fixed_t		spryscale;
+THREADLOCAL fixed_t		sprtopscreen;
 
-fixed_t		spryscale;
-fixed_t		sprtopscreen;
+// Masked columns are batched as well, and flushed
+//  after each sprite or masked seg range.
+THREADLOCAL colbatch_t		maskedbatch;
 
-void R_DrawMaskedColumn (column_t* column)
+void
+R_DrawMaskedColumn
+( cpatch_t*	patch,
+  int		col )
 {
     int		topscreen;
     int 	bottomscreen;
     fixed_t	basetexturemid;
+    cpost_t*	post;
+    cpost_t*	end;
 	
     basetexturemid = dc_texturemid;
-	
 
-    // Defensive: skip if column is NULL or dummy
-    if (!column || column == (column_t*)0xff || column == (column_t*)0x0) return;
-    for ( ; column->topdelta != 0xff ; ) 
+    post = patch->posts + patch->columns[col];
+    end = patch->posts + patch->columns[col+1];
+    for ( ; post < end ; post++) 
     {
         // calculate unclipped screen coordinates
         //  for post
-        topscreen = sprtopscreen + spryscale*column->topdelta;
-        bottomscreen = topscreen + spryscale*column->length;
+        topscreen = sprtopscreen + spryscale*post->topdelta;
+        bottomscreen = topscreen + spryscale*post->length;
 
         dc_yl = (topscreen+FRACUNIT-1)>>FRACBITS;
         dc_yh = (bottomscreen-1)>>FRACBITS;
@@ -392,21 +428,28 @@ void R_DrawMaskedColumn (column_t* column)
 
         if (dc_yl <= dc_yh)
         {
-            dc_source = (byte *)column + 3;
-            dc_texturemid = basetexturemid - (column->topdelta<<FRACBITS);
-            // dc_source = (byte *)column + 3 - column->topdelta;
+            dc_source = patch->pixels + post->offset;
+            dc_texturemid = basetexturemid - (post->topdelta<<FRACBITS);
 
             // Drawn by either R_DrawColumn
             //  or (SHADOW) R_DrawFuzzColumn.
-            colfunc ();    
+            R_BatchColumn (&maskedbatch);
         }
-        column = (column_t *)(  (byte *)column + column->length + 4);
     }
 	
     dc_texturemid = basetexturemid;
 }
 
 
+//
+// R_FlushMaskedColumns
+//
+void R_FlushMaskedColumns (void)
+{
+    R_FlushColumns (&maskedbatch);
+}
+
+
 
 //
 // R_DrawVisSprite
@@ -418,13 +461,12 @@ R_DrawVisSprite
   int			x1,
   int			x2 )
 {
-    column_t*		column;
     int			texturecolumn;
     fixed_t		frac;
-    patch_t*		patch;
+    cpatch_t*		patch;
 	
 	
-    patch = W_CacheLumpNum (vis->patch+firstspritelump, PU_CACHE);
+    patch = R_CachePatchNum (vis->patch+firstspritelump);
 
     dc_colormap = vis->colormap;
     
@@ -433,12 +475,24 @@ R_DrawVisSprite
 	// NULL colormap = shadow draw
 	colfunc = fuzzcolfunc;
     }
+    else if ((vis->mobjflags & MF_TRANSLATION) && drawvariants)
+    {
+	// translated by the colormap itself
+	dc_colormap = R_TranslatedColormap
+	    ((vis->mobjflags & MF_TRANSLATION) >> MF_TRANSSHIFT, dc_colormap);
+	colfunc = columnfuncs[COLUMN_INSIDE];
+    }
     else if (vis->mobjflags & MF_TRANSLATION)
     {
 	colfunc = R_DrawTranslatedColumn;
 	dc_translation = translationtables - 256 +
 	    ( (vis->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT-8) );
     }
+    else
+    {
+	// posts are drawn within themselves
+	colfunc = columnfuncs[COLUMN_INSIDE];
+    }
 	
     dc_iscale = abs(vis->xiscale)>>detailshift;
     dc_texturemid = vis->texturemid;
@@ -450,14 +504,13 @@ R_DrawVisSprite
     {
 	texturecolumn = frac>>FRACBITS;
 #ifdef RANGECHECK
-	if (texturecolumn < 0 || texturecolumn >= SHORT(patch->width))
+	if (texturecolumn < 0 || texturecolumn >= patch->width)
 	    I_Error ("R_DrawSpriteRange: bad texturecolumn");
 #endif
-	column = (column_t *) ((byte *)patch +
-			       LONG(patch->columnofs[texturecolumn]));
-	R_DrawMaskedColumn (column);
+	R_DrawMaskedColumn (patch, texturecolumn);
     }
 
+    R_FlushMaskedColumns ();
     colfunc = basecolfunc;
 }
 
@@ -497,10 +550,28 @@ void R_ProjectSprite (mobj_t* thing)
     
     angle_t		ang;
     fixed_t		iscale;
+
+    fixed_t		thingx;
+    fixed_t		thingy;
+    fixed_t		thingz;
+
+    // where it is in between tics
+    if (fractionaltic < FRACUNIT)
+    {
+	thingx = R_Interpolate (thing->oldx, thing->x);
+	thingy = R_Interpolate (thing->oldy, thing->y);
+	thingz = R_Interpolate (thing->oldz, thing->z);
+    }
+    else
+    {
+	thingx = thing->x;
+	thingy = thing->y;
+	thingz = thing->z;
+    }
     
     // transform the origin point
-    tr_x = thing->x - viewx;
-    tr_y = thing->y - viewy;
+    tr_x = thingx - viewx;
+    tr_y = thingy - viewy;
 	
     gxt = FixedMul(tr_x,viewcos); 
     gyt = -FixedMul(tr_y,viewsin);
@@ -538,7 +609,7 @@ void R_ProjectSprite (mobj_t* thing)
     if (sprframe->rotate)
     {
 	// choose a different rotation based on player view
-	ang = R_PointToAngle (thing->x, thing->y);
+	ang = R_PointToAngle (thingx, thingy);
 	rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
 	lump = sprframe->lump[rot];
 	flip = (boolean)sprframe->flip[rot];
@@ -555,27 +626,27 @@ void R_ProjectSprite (mobj_t* thing)
     x1 = (centerxfrac + FixedMul (tx,xscale) ) >>FRACBITS;
 
     // off the right side?
-    if (x1 > viewwidth)
+    if (x1 > stripend)
 	return;
     
     tx +=  spritewidth[lump];
     x2 = ((centerxfrac + FixedMul (tx,xscale) ) >>FRACBITS) - 1;
 
     // off the left side
-    if (x2 < 0)
+    if (x2 < stripstart)
 	return;
     
     // store information in a vissprite
     vis = R_NewVisSprite ();
     vis->mobjflags = thing->flags;
     vis->scale = xscale<<detailshift;
-    vis->gx = thing->x;
-    vis->gy = thing->y;
-    vis->gz = thing->z;
-    vis->gzt = thing->z + spritetopoffset[lump];
+    vis->gx = thingx;
+    vis->gy = thingy;
+    vis->gz = thingz;
+    vis->gzt = thingz + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
-    vis->x1 = x1 < 0 ? 0 : x1;
-    vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
+    vis->x1 = x1 < stripstart ? stripstart : x1;
+    vis->x2 = x2 >= stripend ? stripend-1 : x2;	
     iscale = FixedDiv (FRACUNIT, xscale);
 
     if (flip)
@@ -638,11 +709,11 @@ void R_AddSprites (sector_t* sec)
     // A sector might have been split into several
     //  subsectors during BSP building.
     // Thus we check whether its already added.
-    if (sec->validcount == validcount)
+    if (spritesectors[sec-sectors] == spritevalidcount)
 	return;			
 
     // Well, now it will be done.
-    sec->validcount = validcount;
+    spritesectors[sec-sectors] = spritevalidcount;
 	
     lightnum = (sec->lightlevel >> LIGHTSEGSHIFT)+extralight;
 
@@ -698,22 +769,22 @@ void R_DrawPSprite (pspdef_t* psp)
     x1 = (centerxfrac + FixedMul (tx,pspritescale) ) >>FRACBITS;
 
     // off the right side
-    if (x1 > viewwidth)
+    if (x1 > stripend)
 	return;		
 
     tx +=  spritewidth[lump];
     x2 = ((centerxfrac + FixedMul (tx, pspritescale) ) >>FRACBITS) - 1;
 
     // off the left side
-    if (x2 < 0)
+    if (x2 < stripstart)
 	return;
     
     // store information in a vissprite
     vis = &avis;
     vis->mobjflags = 0;
     vis->texturemid = (BASEYCENTER<<FRACBITS)+FRACUNIT/2-(psp->sy-spritetopoffset[lump]);
-    vis->x1 = x1 < 0 ? 0 : x1;
-    vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
+    vis->x1 = x1 < stripstart ? stripstart : x1;
+    vis->x2 = x2 >= stripend ? stripend-1 : x2;	
     vis->scale = pspritescale<<detailshift;
     
     if (flip)
@@ -799,156 +870,301 @@ void R_DrawPlayerSprites (void)
 
 //
 // R_SortVisSprites
+// Bottom up merge sort on scale. It is stable, so
+//  sprites of equal scale come out in the order they
+//  were added, as with the old selection sort.
 //
-vissprite_t	vsprsortedhead;
+THREADLOCAL vissprite_t	vsprsortedhead;
+
+THREADLOCAL vissprite_t**	vsprsort;
+THREADLOCAL int			maxvsprsort;
 
 
 void R_SortVisSprites (void)
 {
-    int			i;
     int			count;
-    vissprite_t*	ds;
-    vissprite_t*	best;
-    vissprite_t		unsorted;
-    fixed_t		bestscale;
+    int			width;
+    int			lo;
+    int			mid;
+    int			hi;
+    int			a;
+    int			b;
+    int			i;
+    vissprite_t**	src;
+    vissprite_t**	dest;
+    vissprite_t**	swap;
+    vissprite_t*	spr;
 
     count = vissprite_p - vissprites;
 	
-    unsorted.next = unsorted.prev = &unsorted;
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
 
     if (!count)
 	return;
-		
-    for (ds = vissprites ; ds < vissprite_p ; ds++)
+
+    if (maxvsprsort < count*2)
     {
-	ds->next = ds+1;
-	ds->prev = ds-1;
+	maxvsprsort = maxvissprites*2;
+	vsprsort = realloc (vsprsort, maxvsprsort*sizeof(*vsprsort));
+	if (!vsprsort)
+	    I_Error ("R_SortVisSprites: no memory for %i vissprites", count);
     }
+
+    src = vsprsort;
+    dest = vsprsort + count;
     
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
-    
-    // pull the vissprites out by scale
-    //best = 0;		// shut up the compiler warning
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
     for (i=0 ; i<count ; i++)
+	src[i] = &vissprites[i];
+
+    for (width=1 ; width<count ; width*=2)
     {
-	bestscale = MAXINT;
-	for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
+	for (lo=0 ; lo<count ; lo+=width*2)
 	{
-	    if (ds->scale < bestscale)
-	    {
-		bestscale = ds->scale;
-		best = ds;
-	    }
+	    mid = lo+width < count ? lo+width : count;
+	    hi = lo+width*2 < count ? lo+width*2 : count;
+
+	    // ties go to the first run
+	    for (i=a=lo, b=mid ; a<mid && b<hi ; i++)
+		dest[i] = src[b]->scale < src[a]->scale ? src[b++] : src[a++];
+	    while (a<mid)
+		dest[i++] = src[a++];
+	    while (b<hi)
+		dest[i++] = src[b++];
 	}
-	best->next->prev = best->prev;
-	best->prev->next = best->next;
-	best->next = &vsprsortedhead;
-	best->prev = vsprsortedhead.prev;
-	vsprsortedhead.prev->next = best;
-	vsprsortedhead.prev = best;
+	swap = src;
+	src = dest;
+	dest = swap;
+    }
+
+    // link them up back to front
+    for (i=0 ; i<count ; i++)
+    {
+	spr = src[i];
+	spr->next = &vsprsortedhead;
+	spr->prev = vsprsortedhead.prev;
+	vsprsortedhead.prev->next = spr;
+	vsprsortedhead.prev = spr;
     }
 }
 
 
 
 //
-// R_DrawSprite
+// R_BinDrawSegs
+// The drawsegs that can clip sprites, binned by groups
+//  of columns, each bin in drawseg order. R_DrawSprite
+//  then only looks at the ones in its own bins.
 //
-void R_DrawSprite (vissprite_t* spr)
+#define DSBINSHIFT		4
+#define NUMDSBINS		((MAXWIDTH>>DSBINSHIFT)+1)
+
+THREADLOCAL int		dsbinstart[NUMDSBINS+1];
+THREADLOCAL int*	dsbins;
+THREADLOCAL int		maxdsbins;
+
+// For gathering drawsegs from several bins, each once.
+THREADLOCAL byte*	dsmarks;
+THREADLOCAL int		maxdsmarks;
+
+void R_BinDrawSegs (void)
+{
+    drawseg_t*	ds;
+    int		count;
+    int		bin;
+    int		i;
+
+    count = ds_p - drawsegs;
+    
+    if (maxdsmarks < count)
+    {
+	maxdsmarks = count*2;
+	dsmarks = realloc (dsmarks, maxdsmarks);
+	if (!dsmarks)
+	    I_Error ("R_BinDrawSegs: no memory for %i drawsegs", count);
+	memset (dsmarks, 0, maxdsmarks);
+    }
+
+    memset (dsbinstart, 0, sizeof(dsbinstart));
+    for (ds=drawsegs ; ds<ds_p ; ds++)
+    {
+	if (!ds->silhouette && !ds->maskedtexturecol)
+	    continue;
+	for (bin=ds->x1>>DSBINSHIFT ; bin<=ds->x2>>DSBINSHIFT ; bin++)
+	    dsbinstart[bin+1]++;
+    }
+
+    for (bin=0 ; bin<NUMDSBINS ; bin++)
+	dsbinstart[bin+1] += dsbinstart[bin];
+
+    if (maxdsbins < dsbinstart[NUMDSBINS])
+    {
+	maxdsbins = dsbinstart[NUMDSBINS]*2;
+	dsbins = realloc (dsbins, maxdsbins*sizeof(*dsbins));
+	if (!dsbins)
+	    I_Error ("R_BinDrawSegs: no memory for %i drawsegs", count);
+    }
+
+    // fill in, using the starts as cursors
+    for (i=0, ds=drawsegs ; ds<ds_p ; i++, ds++)
+    {
+	if (!ds->silhouette && !ds->maskedtexturecol)
+	    continue;
+	for (bin=ds->x1>>DSBINSHIFT ; bin<=ds->x2>>DSBINSHIFT ; bin++)
+	    dsbins[dsbinstart[bin]++] = i;
+    }
+
+    // and shift them back
+    for (bin=NUMDSBINS ; bin>0 ; bin--)
+	dsbinstart[bin] = dsbinstart[bin-1];
+    dsbinstart[0] = 0;
+}
+
+
+
+//
+// R_ClipSpriteSeg
+// One drawseg's part in clipping a sprite: draws its
+//  masked mid texture first if the seg is behind.
+//
+void
+R_ClipSpriteSeg
+( vissprite_t*	spr,
+  drawseg_t*	ds,
+  short*	clipbot,
+  short*	cliptop )
 {
-    drawseg_t*		ds;
-    short		clipbot[SCREENWIDTH];
-    short		cliptop[SCREENWIDTH];
     int			x;
     int			r1;
     int			r2;
     fixed_t		scale;
     fixed_t		lowscale;
     int			silhouette;
-		
-    for (x = spr->x1 ; x<=spr->x2 ; x++)
-	clipbot[x] = cliptop[x] = -2;
-    
-    // Scan drawsegs from end to start for obscuring segs.
-    // The first drawseg that has a greater scale
-    //  is the clip seg.
-    for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
+
+    // determine if the drawseg obscures the sprite
+    if (ds->x1 > spr->x2
+	|| ds->x2 < spr->x1
+	|| (!ds->silhouette
+	    && !ds->maskedtexturecol) )
     {
-	// determine if the drawseg obscures the sprite
-	if (ds->x1 > spr->x2
-	    || ds->x2 < spr->x1
-	    || (!ds->silhouette
-		&& !ds->maskedtexturecol) )
-	{
-	    // does not cover sprite
-	    continue;
-	}
+	// does not cover sprite
+	return;
+    }
 			
-	r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-	r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+    r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
+    r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
 
-	if (ds->scale1 > ds->scale2)
-	{
-	    lowscale = ds->scale2;
-	    scale = ds->scale1;
-	}
-	else
-	{
-	    lowscale = ds->scale1;
-	    scale = ds->scale2;
-	}
+    if (ds->scale1 > ds->scale2)
+    {
+	lowscale = ds->scale2;
+	scale = ds->scale1;
+    }
+    else
+    {
+	lowscale = ds->scale1;
+	scale = ds->scale2;
+    }
 		
-	if (scale < spr->scale
-	    || ( lowscale < spr->scale
-		 && !R_PointOnSegSide (spr->gx, spr->gy, ds->curline) ) )
-	{
-	    // masked mid texture?
-	    if (ds->maskedtexturecol)	
-		R_RenderMaskedSegRange (ds, r1, r2);
-	    // seg is behind sprite
-	    continue;			
-	}
+    if (scale < spr->scale
+	|| ( lowscale < spr->scale
+	     && !R_PointOnSegSide (spr->gx, spr->gy, ds->curline) ) )
+    {
+	// masked mid texture?
+	if (ds->maskedtexturecol)	
+	    R_RenderMaskedSegRange (ds, r1, r2);
+	// seg is behind sprite
+	return;			
+    }
 
 	
-	// clip this piece of the sprite
-	silhouette = ds->silhouette;
+    // clip this piece of the sprite
+    silhouette = ds->silhouette;
 	
-	if (spr->gz >= ds->bsilheight)
-	    silhouette &= ~SIL_BOTTOM;
+    if (spr->gz >= ds->bsilheight)
+	silhouette &= ~SIL_BOTTOM;
 
-	if (spr->gzt <= ds->tsilheight)
-	    silhouette &= ~SIL_TOP;
+    if (spr->gzt <= ds->tsilheight)
+	silhouette &= ~SIL_TOP;
 			
-	if (silhouette == 1)
-	{
-	    // bottom sil
-	    for (x=r1 ; x<=r2 ; x++)
-		if (clipbot[x] == -2)
-		    clipbot[x] = ds->sprbottomclip[x];
-	}
-	else if (silhouette == 2)
+    if (silhouette == 1)
+    {
+	// bottom sil
+	for (x=r1 ; x<=r2 ; x++)
+	    if (clipbot[x] == -2)
+		clipbot[x] = ds->sprbottomclip[x];
+    }
+    else if (silhouette == 2)
+    {
+	// top sil
+	for (x=r1 ; x<=r2 ; x++)
+	    if (cliptop[x] == -2)
+		cliptop[x] = ds->sprtopclip[x];
+    }
+    else if (silhouette == 3)
+    {
+	// both
+	for (x=r1 ; x<=r2 ; x++)
 	{
-	    // top sil
-	    for (x=r1 ; x<=r2 ; x++)
-		if (cliptop[x] == -2)
-		    cliptop[x] = ds->sprtopclip[x];
+	    if (clipbot[x] == -2)
+		clipbot[x] = ds->sprbottomclip[x];
+	    if (cliptop[x] == -2)
+		cliptop[x] = ds->sprtopclip[x];
 	}
-	else if (silhouette == 3)
+    }
+}
+
+
+
+//
+// R_DrawSprite
+//
+void R_DrawSprite (vissprite_t* spr)
+{
+    short		clipbot[MAXWIDTH];
+    short		cliptop[MAXWIDTH];
+    int			x;
+    int			bin;
+    int			i;
+    int			lo;
+    int			hi;
+		
+    for (x = spr->x1 ; x<=spr->x2 ; x++)
+	clipbot[x] = cliptop[x] = -2;
+    
+    // Scan drawsegs from end to start for obscuring segs.
+    // The first drawseg that has a greater scale
+    //  is the clip seg.
+    // Only the ones in the sprite's bins can overlap it,
+    //  see R_BinDrawSegs.
+    if (spr->x1>>DSBINSHIFT == spr->x2>>DSBINSHIFT)
+    {
+	bin = spr->x1>>DSBINSHIFT;
+	for (i=dsbinstart[bin+1]-1 ; i>=dsbinstart[bin] ; i--)
+	    R_ClipSpriteSeg (spr, &drawsegs[dsbins[i]], clipbot, cliptop);
+    }
+    else
+    {
+	// a drawseg can be in more than one bin
+	lo = ds_p - drawsegs;
+	hi = -1;
+	for (bin=spr->x1>>DSBINSHIFT ; bin<=spr->x2>>DSBINSHIFT ; bin++)
 	{
-	    // both
-	    for (x=r1 ; x<=r2 ; x++)
+	    for (i=dsbinstart[bin] ; i<dsbinstart[bin+1] ; i++)
 	    {
-		if (clipbot[x] == -2)
-		    clipbot[x] = ds->sprbottomclip[x];
-		if (cliptop[x] == -2)
-		    cliptop[x] = ds->sprtopclip[x];
+		dsmarks[dsbins[i]] = 1;
+		if (dsbins[i] < lo)
+		    lo = dsbins[i];
+		if (dsbins[i] > hi)
+		    hi = dsbins[i];
 	    }
 	}
-		
+
+	for (i=hi ; i>=lo ; i--)
+	{
+	    if (!dsmarks[i])
+		continue;
+	    dsmarks[i] = 0;
+	    R_ClipSpriteSeg (spr, &drawsegs[i], clipbot, cliptop);
+	}
     }
     
     // all clipping has been performed, so draw the sprite
@@ -979,6 +1195,7 @@ void R_DrawMasked (void)
     drawseg_t*		ds;
 	
     R_SortVisSprites ();
+    R_BinDrawSegs ();
 
     if (vissprite_p > vissprites)
     {
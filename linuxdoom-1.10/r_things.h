@@ -28,28 +28,30 @@
 #pragma interface
 #endif
 
-#define MAXVISSPRITES  	128
-
-extern vissprite_t	vissprites[MAXVISSPRITES];
-extern vissprite_t*	vissprite_p;
-extern vissprite_t	vsprsortedhead;
+extern THREADLOCAL vissprite_t*	vissprites;
+extern THREADLOCAL vissprite_t*	vissprite_p;
+extern THREADLOCAL vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern short		negonearray[MAXWIDTH];
+extern short		screenheightarray[MAXWIDTH];
 
 // vars for R_DrawMaskedColumn
-extern short*		mfloorclip;
-extern short*		mceilingclip;
-extern fixed_t		spryscale;
-extern fixed_t		sprtopscreen;
+extern THREADLOCAL short*		mfloorclip;
+extern THREADLOCAL short*		mceilingclip;
+extern THREADLOCAL fixed_t		spryscale;
+extern THREADLOCAL fixed_t		sprtopscreen;
 
 extern fixed_t		pspritescale;
 extern fixed_t		pspriteiscale;
 
 
-void R_DrawMaskedColumn (column_t* column);
+void
+R_DrawMaskedColumn
+( cpatch_t*	patch,
+  int		col );
+void R_FlushMaskedColumns (void);
 
 
 void R_SortVisSprites (void);
@@ -260,7 +260,7 @@ rcsid[] = "$Id: st_stuff.c,v 1.6 1997/02/03 22:45:13 b1 Exp $";
     (strlen(mapnames[(gameepisode-1)*9+(gamemap-1)]))
 
 #define ST_MAPTITLEX \
-    (SCREENWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
+    (BASE_WIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
 
 #define ST_MAPTITLEY		0
 #define ST_MAPHEIGHT		1
@@ -501,12 +501,15 @@ void ST_refreshBackground(void)
 
     if (st_statusbaron)
     {
-	V_DrawPatch(ST_X, 0, BG, sbar);
+	// The background screen is full size and the bar
+	//  sits at ST_Y in it too, so that the native
+	//  pixels of a copied rect line up on both sides.
+	V_DrawPatch(ST_X, ST_Y, BG, sbar);
 
 	if (netgame)
-	    V_DrawPatch(ST_FX, 0, BG, faceback);
+	    V_DrawPatch(ST_FX, ST_Y, BG, faceback);
 
-	V_CopyRect(ST_X, 0, BG, ST_WIDTH, ST_HEIGHT, ST_X, ST_Y, FG);
+	V_CopyRect(ST_X, ST_Y, BG, ST_WIDTH, ST_HEIGHT, ST_X, ST_Y, FG);
     }
 
 }
@@ -1467,5 +1470,4 @@ void ST_Init (void)
 {
     veryfirsttime = 0;
     ST_loadData();
-    screens[4] = (byte *) Z_Malloc(ST_WIDTH*ST_HEIGHT, PU_STATIC, 0);
 }
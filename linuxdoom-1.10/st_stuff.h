@@ -30,8 +30,8 @@
 // Size of statusbar.
 // Now sensitive for scaling.
 #define ST_HEIGHT	32*SCREEN_MUL
-#define ST_WIDTH	SCREENWIDTH
-#define ST_Y		(SCREENHEIGHT - ST_HEIGHT)
+#define ST_WIDTH	BASE_WIDTH
+#define ST_Y		(BASE_HEIGHT - ST_HEIGHT)
 
 
 //
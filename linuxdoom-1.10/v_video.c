@@ -28,20 +28,32 @@ static const char
 rcsid[] = "$Id: v_video.c,v 1.5 1997/02/03 22:45:13 b1 Exp $";
 
 
+#include <stdlib.h>
+
 #include "i_system.h"
 #include "r_local.h"
 
 #include "doomdef.h"
 #include "doomdata.h"
 
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_swap.h"
 
 #include "v_video.h"
 
 
+// Picked in V_Init, see doomdef.h.
+int				screenwidth = BASE_WIDTH;
+int				screenheight = BASE_HEIGHT;
+
 // Each screen is [SCREENWIDTH*SCREENHEIGHT]; 
 byte*				screens[5];	
+
+// Native column/row where each BASE_WIDTH by BASE_HEIGHT
+//  unit starts; one more entry for the right/bottom edge.
+int				vscalex[BASE_WIDTH+1];
+int				vscaley[BASE_HEIGHT+1];
  
 int				dirtybox[4]; 
 
@@ -170,22 +182,26 @@ V_CopyRect
 	 
 #ifdef RANGECHECK 
     if (srcx<0
-	||srcx+width >SCREENWIDTH
+	||srcx+width >BASE_WIDTH
 	|| srcy<0
-	|| srcy+height>SCREENHEIGHT 
-	||destx<0||destx+width >SCREENWIDTH
+	|| srcy+height>BASE_HEIGHT 
+	||destx<0||destx+width >BASE_WIDTH
 	|| desty<0
-	|| desty+height>SCREENHEIGHT 
+	|| desty+height>BASE_HEIGHT 
 	|| (unsigned)srcscrn>4
 	|| (unsigned)destscrn>4)
     {
 	I_Error ("Bad V_CopyRect");
     }
 #endif 
-    V_MarkRect (destx, desty, width, height); 
-	 
-    src = screens[srcscrn]+SCREENWIDTH*srcy+srcx; 
-    dest = screens[destscrn]+SCREENWIDTH*desty+destx; 
+    src = screens[srcscrn]+SCREENWIDTH*vscaley[srcy]+vscalex[srcx]; 
+    dest = screens[destscrn]+SCREENWIDTH*vscaley[desty]+vscalex[destx]; 
+
+    // native size of the destination rect
+    width = vscalex[destx+width] - vscalex[destx];
+    height = vscaley[desty+height] - vscaley[desty];
+
+    V_MarkRect (vscalex[destx], vscaley[desty], width, height); 
 
     for ( ; height>0 ; height--) 
     { 
@@ -196,6 +212,89 @@ V_CopyRect
 } 
  
 
+//
+// V_DrawPatchColumn
+// Draws one column of a patch at x,y, each texel
+//  stretched over the native pixels it covers.
+//
+static void
+V_DrawPatchColumn
+( int		x,
+  int		y,
+  int		scrn,
+  cpatch_t*	patch,
+  int		col ) 
+{ 
+    int		count;
+    int		x1;
+    int		w;
+    int		h;
+    int		i;
+    int		row;
+    byte*	dest;
+    byte*	source; 
+    byte	pixel;
+    cpost_t*	post;
+    cpost_t*	end;
+
+    x1 = vscalex[x];
+    w = vscalex[x+1] - x1;
+
+    // step through the runs in a column 
+    post = patch->posts + patch->columns[col];
+    end = patch->posts + patch->columns[col+1];
+    for ( ; post < end ; post++)
+    { 
+	source = patch->pixels + post->offset; 
+	row = y + post->topdelta;
+	dest = screens[scrn] + vscaley[row]*SCREENWIDTH + x1; 
+	count = post->length; 
+			 
+	while (count--) 
+	{ 
+	    pixel = *source++;
+	    for (h = vscaley[row+1] - vscaley[row] ; h>0 ; h--)
+	    {
+		for (i=0 ; i<w ; i++)
+		    dest[i] = pixel;
+		dest += SCREENWIDTH; 
+	    }
+	    row++;
+	} 
+    } 
+}
+
+
+//
+// V_DrawPatchCol
+// Draws column col of a patch at x,y,
+//  ignoring the patch offsets.
+//
+void
+V_DrawPatchCol
+( int		x,
+  int		y,
+  int		scrn,
+  patch_t*	patch,
+  int		col ) 
+{ 
+    cpatch_t*	cpatch;
+
+    cpatch = R_CachePatch (patch);
+
+#ifdef RANGECHECK 
+    if ((unsigned)x >= BASE_WIDTH
+	|| y<0
+	|| y+cpatch->height>BASE_HEIGHT 
+	|| (unsigned)scrn>4)
+    {
+	I_Error ("Bad V_DrawPatchCol");
+    }
+#endif 
+    V_DrawPatchColumn (x, y, scrn, cpatch, col);
+}
+
+
 //
 // V_DrawPatch
 // Masks a column based masked pic to the screen. 
@@ -208,21 +307,18 @@ V_DrawPatch
   patch_t*	patch ) 
 { 
 
-    int		count;
     int		col; 
-    column_t*	column; 
-    byte*	desttop;
-    byte*	dest;
-    byte*	source; 
+    cpatch_t*	cpatch;
     int		w; 
 	 
-    y -= SHORT(patch->topoffset); 
-    x -= SHORT(patch->leftoffset); 
+    cpatch = R_CachePatch (patch);
+    y -= cpatch->topoffset; 
+    x -= cpatch->leftoffset; 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+cpatch->width >BASE_WIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+cpatch->height>BASE_HEIGHT 
 	|| (unsigned)scrn>4)
     {
       fprintf( stderr, "Patch at %d,%d exceeds LFB\n", x,y );
@@ -232,34 +328,17 @@ V_DrawPatch
     }
 #endif 
  
-    if (!scrn)
-	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
+    w = cpatch->width; 
 
-    col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
-	 
-    w = SHORT(patch->width); 
+    if (!scrn)
+	V_MarkRect (vscalex[x], vscaley[y],
+		    vscalex[x+w] - vscalex[x],
+		    vscaley[y+cpatch->height] - vscaley[y]); 
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for (col=0 ; col<w ; x++, col++)
     { 
-	column = (column_t *)((byte *)patch + LONG(patch->columnofs[col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
-    }			 
+	V_DrawPatchColumn (x, y, scrn, cpatch, col);
+    }
 } 
  
 //
@@ -275,21 +354,18 @@ V_DrawPatchFlipped
   patch_t*	patch ) 
 { 
 
-    int		count;
     int		col; 
-    column_t*	column; 
-    byte*	desttop;
-    byte*	dest;
-    byte*	source; 
+    cpatch_t*	cpatch;
     int		w; 
 	 
-    y -= SHORT(patch->topoffset); 
-    x -= SHORT(patch->leftoffset); 
+    cpatch = R_CachePatch (patch);
+    y -= cpatch->topoffset; 
+    x -= cpatch->leftoffset; 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+cpatch->width >BASE_WIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+cpatch->height>BASE_HEIGHT 
 	|| (unsigned)scrn>4)
     {
       fprintf( stderr, "Patch origin %d,%d exceeds LFB\n", x,y );
@@ -297,34 +373,17 @@ V_DrawPatchFlipped
     }
 #endif 
  
-    if (!scrn)
-	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
+    w = cpatch->width; 
 
-    col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
-	 
-    w = SHORT(patch->width); 
+    if (!scrn)
+	V_MarkRect (vscalex[x], vscaley[y],
+		    vscalex[x+w] - vscalex[x],
+		    vscaley[y+cpatch->height] - vscaley[y]); 
 
-    for ( ; col<w ; x++, col++, desttop++) 
+    for (col=0 ; col<w ; x++, col++)
     { 
-	column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
-    }			 
+	V_DrawPatchColumn (x, y, scrn, cpatch, w-1-col);
+    }
 } 
  
 
@@ -400,6 +459,8 @@ V_DrawPatchDirect
 //
 // V_DrawBlock
 // Draw a linear block of pixels into the view buffer.
+// Unlike the patch functions, x, y and the size
+//  are native pixels.
 //
 void
 V_DrawBlock
@@ -440,6 +501,7 @@ V_DrawBlock
 //
 // V_GetBlock
 // Gets a linear block of pixels from the view buffer.
+// Native pixels, like V_DrawBlock.
 //
 void
 V_GetBlock
@@ -476,18 +538,72 @@ V_GetBlock
 
 
 
+//
+// V_SetScreenSize
+// Changes SCREENWIDTH/SCREENHEIGHT and the tables
+//  that go with them, without touching the screens.
+//
+void
+V_SetScreenSize
+( int		width,
+  int		height )
+{
+    int		i;
+
+    screenwidth = width;
+    screenheight = height;
+    
+    for (i=0 ; i<=BASE_WIDTH ; i++)
+	vscalex[i] = i*SCREENWIDTH/BASE_WIDTH;
+    for (i=0 ; i<=BASE_HEIGHT ; i++)
+	vscaley[i] = i*SCREENHEIGHT/BASE_HEIGHT;
+}
+
+
+// Keeps the screens 16 byte aligned.
+#define SCREENLEADPAD	16
+
 //
 // V_Init
+// Picks the screen size from -width and -height,
+//  clamped to BASE_WIDTH..MAXWIDTH and BASE_HEIGHT..MAXHEIGHT.
+// The width is kept a multiple of 4 for the blitters.
 // 
 void V_Init (void) 
 { 
     int		i;
+    int		p;
     byte*	base;
-		
-    // stick these in low dos memory on PCs
 
-    base = I_AllocLow (SCREENWIDTH*SCREENHEIGHT*4);
+    p = M_CheckParm ("-width");
+    if (p && p < myargc-1)
+	screenwidth = atoi (myargv[p+1]) & ~3;
+    p = M_CheckParm ("-height");
+    if (p && p < myargc-1)
+	screenheight = atoi (myargv[p+1]);
+
+    if (screenwidth < BASE_WIDTH)
+	screenwidth = BASE_WIDTH;
+    if (screenwidth > MAXWIDTH)
+	screenwidth = MAXWIDTH & ~3;
+    if (screenheight < BASE_HEIGHT)
+	screenheight = BASE_HEIGHT;
+    if (screenheight > MAXHEIGHT)
+	screenheight = MAXHEIGHT;
 
-    for (i=0 ; i<4 ; i++)
+    if (screenwidth != BASE_WIDTH || screenheight != BASE_HEIGHT)
+	printf ("V_Init: %ix%i screen\n", screenwidth, screenheight);
+
+    V_SetScreenSize (screenwidth, screenheight);
+
+    // stick these in low dos memory on PCs
+    // Screen 4 is the status bar background,
+    //  kept full size so V_CopyRect can work on it.
+    // The AVX2 scaler reads 3 bytes in front of
+    //  screens[0], so there is a pad before it.
+    base = I_AllocLow (SCREENLEADPAD + SCREENWIDTH*SCREENHEIGHT*5)
+	+ SCREENLEADPAD;
+
+    for (i=0 ; i<5 ; i++)
 	screens[i] = base + i*SCREENWIDTH*SCREENHEIGHT;
 }
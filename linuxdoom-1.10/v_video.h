@@ -36,7 +36,7 @@
 // VIDEO
 //
 
-#define CENTERY			(SCREENHEIGHT/2)
+#define CENTERY			(BASE_HEIGHT/2)
 
 
 // Screen 0 is the screen updated by I_Update screen.
@@ -46,6 +46,14 @@
 
 extern	byte*		screens[5];
 
+// Native start of each BASE_WIDTH/BASE_HEIGHT unit.
+// The patch and rect functions below take x,y
+//  in those units and scale through these.
+extern	int		vscalex[BASE_WIDTH+1];
+extern	int		vscaley[BASE_HEIGHT+1];
+
+// What was drawn to screens[0] since the video backend
+//  last showed it, in native pixels, as V_MarkRect adds.
 extern  int	dirtybox[4];
 
 extern	byte	gammatable[5][256];
@@ -56,6 +64,13 @@ extern	int	usegamma;
 // Allocates buffer screens, call before R_Init.
 void V_Init (void);
 
+// Changes the screen size the V_ functions scale to.
+// The caller sees to it that the screens are big enough.
+void
+V_SetScreenSize
+( int		width,
+  int		height );
+
 
 void
 V_CopyRect
@@ -82,6 +97,15 @@ V_DrawPatchDirect
   int		scrn,
   patch_t*	patch );
 
+// Draws a single column of a patch, without offsets.
+void
+V_DrawPatchCol
+( int		x,
+  int		y,
+  int		scrn,
+  patch_t*	patch,
+  int		col );
+
 
 // Draw a linear block of pixels into the view buffer.
 void